@@ -82,6 +82,11 @@ class dconcatenation_t {
 public:
   virtual ~dconcatenation_t() {}
   virtual int dim() const = 0;
+  // Total number of elements, and starting position of each box
+  virtual long long size() const = 0;
+  virtual vector<long long> positions() const = 0;
+  // Number of boxes
+  virtual long long count() const = 0;
   static shared_ptr<dconcatenation_t> make(int dim);
   virtual unique_ptr<dlinearization_t>
   push_back(const RegionCalculus::box_t &box) = 0;
@@ -99,6 +104,15 @@ private:
 
 public:
   virtual int dim() const { return D; }
+  virtual long long size() const { return next; }
+  virtual vector<long long> positions() const {
+    vector<long long> poss;
+    poss.reserve(linearizations.size());
+    for (const auto &linearization : linearizations)
+      poss.push_back(linearization.pos());
+    return poss;
+  }
+  virtual long long count() const { return linearizations.size(); }
 
   concatenation_t() : next(0) {}
   concatenation_t(const concatenation_t &) = default;
@@ -1,19 +1,41 @@
 #include "DataBlock.hpp"
 
+#include "H5Filters.hpp"
+
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <future>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <type_traits>
 
+#if defined __SSE2__ && defined __x86_64__
+#include <emmintrin.h>
+#endif
+
+#ifdef SIMULATIONIO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef SIMULATIONIO_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace SimulationIO {
 using namespace std;
 
-#ifdef SIMULATIONIO_HAVE_HDF5
-namespace {
-vector<hsize_t> choose_chunksize(const vector<hsize_t> &size,
-                                 hsize_t typesize) {
+point_t WriteOptions::chunk_shape(const point_t &shape,
+                                  long long type_size) const {
   // Guess a good chunk size:
   // - chunk should not be larger than the dataset size
   // - chunk should fit in L3 cache
@@ -27,85 +49,115 @@ vector<hsize_t> choose_chunksize(const vector<hsize_t> &size,
   //    BW * L = 600 kByte
   // We choose a chunk size of 64^3:
   //    64^3 * 8 B = 2 MByte
-  int dim = size.size();
-  hsize_t length = 1;
-  for (int d = 0; d < dim; ++d)
-    length *= size.at(d);
+  // Reading single points should read as little as possible, so we then
+  // choose a chunk size of a typical page size, 4 kByte.
+  assert(type_size > 0);
+  const int rank = shape.rank();
+  const long long length = shape.prod();
   if (length == 0)
-    return size;
-  hsize_t target_bytes = 2 * 1024 * 2014;
-  hsize_t target_chunklength =
-      min(length, max(hsize_t(1), target_bytes / typesize));
-  vector<hsize_t> chunksize(dim, 1);
-  hsize_t chunklength = 1;
-  assert(chunklength <= target_chunklength);
+    return shape;
+  long long target_bytes = chunk_bytes;
+  if (target_bytes <= 0)
+    target_bytes =
+        access_pattern == access_pattern_t::point ? 4 * 1024 : 2 * 1024 * 1024;
+  const long long target_chunklength =
+      min(length, max(1LL, target_bytes / type_size));
+  // Slices are read most efficiently if chunks contain no points outside
+  // the slice
+  vector<bool> can_grow(rank, true);
+  if (access_pattern == access_pattern_t::slice && rank > 1) {
+    const int dir = slice_dir < 0 ? rank - 1 : slice_dir;
+    assert(dir < rank);
+    can_grow.at(dir) = false;
+  }
+  point_t chunkshape(rank, 1);
   for (;;) {
-    hsize_t old_chunklength = chunklength;
-    // Loop in C index order
-    for (int dir = dim - 1; dir >= 0; --dir) {
-      vector<hsize_t> new_chunksize(chunksize);
-      new_chunksize.at(dir) = min(2 * chunksize.at(dir), size.at(dir));
-      hsize_t new_chunklength = 1;
-      for (int d = 0; d < dim; ++d)
-        new_chunklength *= new_chunksize.at(d);
-      if (new_chunklength > target_chunklength)
-        return chunksize;
-      chunksize = new_chunksize;
-      chunklength = new_chunklength;
+    bool did_grow = false;
+    // Grow the fastest direction first, keeping chunks compact
+    for (int dir = 0; dir < rank; ++dir) {
+      if (!can_grow.at(dir) || chunkshape[dir] == shape[dir])
+        continue;
+      point_t new_chunkshape(chunkshape);
+      new_chunkshape[dir] = min(2 * chunkshape[dir], shape[dir]);
+      if (new_chunkshape.prod() > target_chunklength) {
+        can_grow.at(dir) = false;
+        continue;
+      }
+      chunkshape = new_chunkshape;
+      did_grow = true;
     }
-    // Ensure progress
-    if (chunklength == old_chunklength)
-      return chunksize;
+    if (!did_grow)
+      return chunkshape;
   }
 }
-} // namespace
-#endif
 
-#ifdef SIMULATIONIO_HAVE_TILEDB
+#ifdef SIMULATIONIO_HAVE_HDF5
 namespace {
-point_t choose_tilesize(const point_t &size, long long typesize) {
-  // Guess a good tile size:
-  // - chunk should not be larger than the dataset size
-  // - chunk should fit in L3 cache
-  // - chunk should be larger than stripe size
-  // - chunk should be larger than bandwidth-latency product
-  // A typical L3 cache size is several MByte
-  // A typical stripe size is 128 kByte
-  // A typical disk latency-bandwidth product is
-  //    L = 1 / (10,000/min) / 2 = 0.006 sec
-  //    BW = 100 MByte/sec
-  //    BW * L = 600 kByte
-  // We choose a chunk size of 64^3:
-  //    64^3 * 8 B = 2 MByte
-  auto rank = size.rank();
-  auto length = size.prod();
-  if (length == 0)
-    return size;
-  long long target_bytes = 2 * 1024 * 2014;
-  long long target_chunklength = min(length, max(1LL, target_bytes / typesize));
-  point_t chunksize(rank, 1);
-  long long chunklength = 1;
-  assert(chunklength <= target_chunklength);
-  for (;;) {
-    long long old_chunklength = chunklength;
-    // Loop in C index order
-    for (int dir = rank - 1; dir >= 0; --dir) {
-      point_t new_chunksize(chunksize);
-      new_chunksize[dir] = min(2 * chunksize[dir], size[dir]);
-      auto new_chunklength = new_chunksize.prod();
-      if (new_chunklength > target_chunklength)
-        return chunksize;
-      chunksize = new_chunksize;
-      chunklength = new_chunklength;
+// HDF5 uses C index order, the reverse of our index order
+vector<hsize_t> choose_chunksize(const WriteOptions &write_options,
+                                 const vector<hsize_t> &size,
+                                 hsize_t typesize) {
+  const int dim = size.size();
+  point_t shape(dim, 0);
+  for (int d = 0; d < dim; ++d)
+    shape[d] = size.at(dim - 1 - d);
+  const auto chunkshape = write_options.chunk_shape(shape, typesize);
+  vector<hsize_t> chunksize(dim);
+  for (int d = 0; d < dim; ++d)
+    chunksize.at(d) = chunkshape[dim - 1 - d];
+  return chunksize;
+}
+
+// Add the compression filter chosen by the user to a chunked dataset. Methods
+// that are not available, or cannot handle this datatype, fall back to
+// deflate.
+void set_compression(H5::DSetCreatPropList &proplist,
+                     const WriteOptions &write_options,
+                     const H5::DataType &datatype) {
+  // Level 1 is fast, but still offers good compression
+  const int level = write_options.compression_level;
+  switch (write_options.compression_method) {
+  case WriteOptions::compression_method_t::bzip2:
+    if (H5::filterCanEncode(H5::H5Z_FILTER_BZIP2)) {
+      H5::setBZip2(proplist, max(1, min(9, level)));
+      return;
     }
-    // Ensure progress
-    if (chunklength == old_chunklength)
-      return chunksize;
+    break;
+  case WriteOptions::compression_method_t::lz4:
+    if (H5::filterCanEncode(H5::H5Z_FILTER_LZ4)) {
+      H5::setLZ4(proplist);
+      return;
+    }
+    break;
+  case WriteOptions::compression_method_t::szip: {
+    const auto cls = datatype.getClass();
+    if ((cls == H5T_INTEGER || cls == H5T_FLOAT) &&
+        H5::filterCanEncode(H5Z_FILTER_SZIP)) {
+      const int dim = proplist.getChunk(0, nullptr);
+      vector<hsize_t> chunksize(dim);
+      proplist.getChunk(dim, chunksize.data());
+      hsize_t npoints = 1;
+      for (int d = 0; d < dim; ++d)
+        npoints *= chunksize[d];
+      // szip needs an even number of pixels per block, at most 32, and at
+      // least one block per chunk
+      const unsigned pixels_per_block = min(hsize_t(32), npoints) & ~1U;
+      if (pixels_per_block >= 2) {
+        proplist.setSzip(H5_SZIP_NN_OPTION_MASK, pixels_per_block);
+        return;
+      }
+    }
+    break;
+  }
+  case WriteOptions::compression_method_t::zlib:
+    break;
   }
+  proplist.setDeflate(level);
 }
 } // namespace
 #endif
 
+
 namespace HyperSlab {
 
 template <int D, typename T> array<T, D> mkarray(const vector<T> &xs) {
@@ -124,36 +176,97 @@ template <int D> array<ptrdiff_t, D> mkarray(const point_t &xs) {
   return rs;
 }
 
+copy_settings_t &copy_settings() {
+  static copy_settings_t settings{
+      size_t(1) << 20, max(1, int(thread::hardware_concurrency())),
+      size_t(1) << 25};
+  return settings;
+}
+
+namespace {
+thread_local bool copies_are_serial = false;
+}
+
+int copy_nthreads() {
+  return copies_are_serial ? 1 : copy_settings().nthreads;
+}
+
+serial_copies::serial_copies() : m_was_serial(copies_are_serial) {
+  copies_are_serial = true;
+}
+serial_copies::~serial_copies() { copies_are_serial = m_was_serial; }
+
+namespace {
+// Copy one element of N bytes (or of type_size bytes if N < 0)
+template <ptrdiff_t N>
+inline void copy_elt(unsigned char *const outptr,
+                     const unsigned char *const inptr,
+                     const ptrdiff_t type_size) {
+  memcpy(outptr, inptr, N >= 0 ? N : type_size);
+}
+
+// Copy one element, bypassing the cache for the output where supported. The
+// output must be aligned to N bytes.
+template <ptrdiff_t N>
+inline void stream_elt(unsigned char *const outptr,
+                       const unsigned char *const inptr,
+                       const ptrdiff_t type_size) {
+  copy_elt<N>(outptr, inptr, type_size);
+}
+template <ptrdiff_t N> constexpr bool have_stream_elt() { return false; }
+#if defined __SSE2__ && defined __x86_64__
+template <>
+inline void stream_elt<4>(unsigned char *const outptr,
+                          const unsigned char *const inptr,
+                          const ptrdiff_t type_size) {
+  int x;
+  memcpy(&x, inptr, 4);
+  _mm_stream_si32(reinterpret_cast<int *>(outptr), x);
+}
+template <>
+inline void stream_elt<8>(unsigned char *const outptr,
+                          const unsigned char *const inptr,
+                          const ptrdiff_t type_size) {
+  long long x;
+  memcpy(&x, inptr, 8);
+  _mm_stream_si64(reinterpret_cast<long long *>(outptr), x);
+}
+template <>
+inline void stream_elt<16>(unsigned char *const outptr,
+                           const unsigned char *const inptr,
+                           const ptrdiff_t type_size) {
+  stream_elt<8>(outptr, inptr, 8);
+  stream_elt<8>(outptr + 8, inptr + 8, 8);
+}
+template <> constexpr bool have_stream_elt<4>() { return true; }
+template <> constexpr bool have_stream_elt<8>() { return true; }
+template <> constexpr bool have_stream_elt<16>() { return true; }
+#endif
+} // namespace
+
 template <int D> class copy_t {
   array<ptrdiff_t, D> outstrides;
   array<ptrdiff_t, D> instrides;
   array<ptrdiff_t, D> shape;
   ptrdiff_t type_size;
-  unsigned char *outptr_min;
-  unsigned char *outptr_max;
-  const unsigned char *inptr_min;
-  const unsigned char *inptr_max;
-
-  bool outcheck(unsigned char *const outptr, size_t nbytes) const {
-    return outptr_min <= outptr && outptr + nbytes <= outptr_max;
-  }
-  bool incheck(const unsigned char *const inptr, size_t nbytes) const {
-    return inptr_min <= inptr && inptr + nbytes <= inptr_max;
-  }
+  bool nontemporal;
 
   // This implementation is efficient for Fortran array order
 
   template <ptrdiff_t N, int DD, typename enable_if<DD == 0>::type * = nullptr>
   void copy_nd_f(unsigned char *const outptr, const unsigned char *const inptr,
                  const ptrdiff_t type_size) const {
-    const ptrdiff_t n = N >= 0 ? N : type_size;
-    // assert(outcheck(outptr, n));
-    // assert(incheck(inptr, n));
-    memcpy(outptr, inptr, n);
+    copy_elt<N>(outptr, inptr, type_size);
+  }
+
+  template <ptrdiff_t N, int DD, typename enable_if<DD == 1>::type * = nullptr>
+  void copy_nd_f(unsigned char *const outptr, const unsigned char *const inptr,
+                 const ptrdiff_t type_size) const {
+    copy_row<N>(outptr, outstrides[0], inptr, instrides[0], shape[0]);
   }
 
   template <ptrdiff_t N, int DD,
-            typename enable_if<(DD > 0 && DD <= D)>::type * = nullptr>
+            typename enable_if<(DD > 1 && DD <= D)>::type * = nullptr>
   void copy_nd_f(unsigned char *const outptr, const unsigned char *const inptr,
                  const ptrdiff_t type_size) const {
     const ptrdiff_t outdi = outstrides[DD - 1];
@@ -168,14 +281,18 @@ template <int D> class copy_t {
   template <ptrdiff_t N, int DD, typename enable_if<DD == D>::type * = nullptr>
   void copy_nd_c(unsigned char *const outptr, const unsigned char *const inptr,
                  const ptrdiff_t type_size) const {
-    const ptrdiff_t n = N >= 0 ? N : type_size;
-    // assert(outcheck(outptr, n));
-    // assert(incheck(inptr, n));
-    memcpy(outptr, inptr, n);
+    copy_elt<N>(outptr, inptr, type_size);
   }
 
   template <ptrdiff_t N, int DD,
-            typename enable_if<(DD >= 0 && DD < D)>::type * = nullptr>
+            typename enable_if<(DD >= 0 && DD == D - 1)>::type * = nullptr>
+  void copy_nd_c(unsigned char *const outptr, const unsigned char *const inptr,
+                 const ptrdiff_t type_size) const {
+    copy_row<N>(outptr, outstrides[DD], inptr, instrides[DD], shape[DD]);
+  }
+
+  template <ptrdiff_t N, int DD,
+            typename enable_if<(DD >= 0 && DD < D - 1)>::type * = nullptr>
   void copy_nd_c(unsigned char *const outptr, const unsigned char *const inptr,
                  const ptrdiff_t type_size) const {
     const ptrdiff_t outdi = outstrides[DD];
@@ -185,20 +302,39 @@ template <int D> class copy_t {
       copy_nd_c<N, DD + 1>(outptr + i * outdi, inptr + i * indi, type_size);
   }
 
-public:
-  copy_t(unsigned char *const outptr, const ptrdiff_t outnbytes,
-         const ptrdiff_t outoffset, const array<ptrdiff_t, D> &outstrides,
-         const unsigned char *const inptr, const ptrdiff_t innbytes,
-         const ptrdiff_t inoffset, const array<ptrdiff_t, D> &instrides,
-         const array<ptrdiff_t, D> &shape, const ptrdiff_t type_size)
-      : outstrides(outstrides), instrides(instrides), shape(shape),
-        type_size(type_size), outptr_min(outptr),
-        outptr_max(outptr + outnbytes), inptr_min(inptr),
-        inptr_max(inptr + innbytes) {
-    unsigned char *const outptr1 = outptr + outoffset;
-    const unsigned char *const inptr1 = inptr + inoffset;
-    if (D == 0 || outstrides[0] <= outstrides[D - 1]) {
-      // prefer Fortran order
+  // Copy the innermost dimension. Known element sizes become single loads and
+  // stores that the compiler can vectorize.
+  template <ptrdiff_t N>
+  void copy_row(unsigned char *const outptr, const ptrdiff_t outdi,
+                const unsigned char *const inptr, const ptrdiff_t indi,
+                const ptrdiff_t ni) const {
+    if (have_stream_elt<N>() && nontemporal && outdi == N &&
+        uintptr_t(outptr) % N == 0) {
+      for (ptrdiff_t i = 0; i < ni; ++i)
+        stream_elt<N>(outptr + i * N, inptr + i * indi, type_size);
+      return;
+    }
+    if (indi == N) {
+      // Contiguous input (scatter)
+      for (ptrdiff_t i = 0; i < ni; ++i)
+        copy_elt<N>(outptr + i * outdi, inptr + i * N, type_size);
+    } else if (outdi == N) {
+      // Contiguous output (gather)
+      for (ptrdiff_t i = 0; i < ni; ++i)
+        copy_elt<N>(outptr + i * N, inptr + i * indi, type_size);
+    } else {
+      for (ptrdiff_t i = 0; i < ni; ++i)
+        copy_elt<N>(outptr + i * outdi, inptr + i * indi, type_size);
+    }
+  }
+
+  bool prefer_fortran_order() const {
+    return D == 0 || outstrides[0] <= outstrides[D - 1];
+  }
+
+  void run(unsigned char *const outptr1,
+           const unsigned char *const inptr1) const {
+    if (prefer_fortran_order()) {
       switch (type_size) {
       case 1:
         copy_nd_f<1, D>(outptr1, inptr1, type_size);
@@ -220,7 +356,6 @@ public:
         break;
       }
     } else {
-      // prefer C order
       switch (type_size) {
       case 1:
         copy_nd_c<1, 0>(outptr1, inptr1, type_size);
@@ -242,6 +377,56 @@ public:
         break;
       }
     }
+#if defined __SSE2__ && defined __x86_64__
+    // Make non-temporal stores visible to the thread waiting for this copy
+    if (nontemporal)
+      _mm_sfence();
+#endif
+  }
+
+public:
+  copy_t(unsigned char *const outptr, const ptrdiff_t outoffset,
+         const array<ptrdiff_t, D> &outstrides,
+         const unsigned char *const inptr, const ptrdiff_t inoffset,
+         const array<ptrdiff_t, D> &instrides,
+         const array<ptrdiff_t, D> &shape, const ptrdiff_t type_size)
+      : outstrides(outstrides), instrides(instrides), shape(shape),
+        type_size(type_size) {
+    const auto &settings = copy_settings();
+    ptrdiff_t nbytes = type_size;
+    for (int d = 0; d < D; ++d)
+      nbytes *= shape[d];
+    nontemporal = size_t(nbytes) > settings.nontemporal_cutoff;
+
+    unsigned char *const outptr1 = outptr + outoffset;
+    const unsigned char *const inptr1 = inptr + inoffset;
+    // Split the outermost dimension into one slab per thread
+    const int dir = prefer_fortran_order() ? D - 1 : 0;
+    const ptrdiff_t ni = D == 0 ? 1 : shape[dir];
+    const int nthreads =
+        D == 0 || size_t(nbytes) <= settings.cutoff
+            ? 1
+            : int(min(ptrdiff_t(copy_nthreads()), ni));
+    if (nthreads <= 1) {
+      run(outptr1, inptr1);
+      return;
+    }
+    vector<future<void>> slabs;
+    for (int t = 0; t < nthreads; ++t) {
+      const ptrdiff_t i0 = ni * t / nthreads, i1 = ni * (t + 1) / nthreads;
+      copy_t slab(*this);
+      slab.shape[dir] = i1 - i0;
+      unsigned char *const outptr2 = outptr1 + i0 * outstrides[dir];
+      const unsigned char *const inptr2 = inptr1 + i0 * instrides[dir];
+      if (t == nthreads - 1)
+        slab.run(outptr2, inptr2);
+      else
+        slabs.push_back(async(launch::async, [=]() {
+          slab.run(outptr2, inptr2);
+        }));
+    }
+    for (auto &slab : slabs)
+      slab.get();
   }
 };
 
@@ -274,14 +459,124 @@ pair<ptrdiff_t, point_t> layout2strides(const box_t &layout, const box_t &box,
   return make_pair(offset, point_t(strides));
 }
 
+namespace {
+// Highest rank for which there is a compile-time specialized copy kernel
+constexpr int max_fixed_rank = 4;
+
+void copy_fixed(unsigned char *const outptr, const ptrdiff_t outoffset,
+                const vector<ptrdiff_t> &outstrides,
+                const unsigned char *const inptr, const ptrdiff_t inoffset,
+                const vector<ptrdiff_t> &instrides,
+                const vector<ptrdiff_t> &shape, const ptrdiff_t type_size) {
+  switch (shape.size()) {
+  case 0:
+    copy_t<0>(outptr, outoffset, mkarray<0>(outstrides), inptr, inoffset,
+              mkarray<0>(instrides), mkarray<0>(shape), type_size);
+    break;
+  case 1:
+    copy_t<1>(outptr, outoffset, mkarray<1>(outstrides), inptr, inoffset,
+              mkarray<1>(instrides), mkarray<1>(shape), type_size);
+    break;
+  case 2:
+    copy_t<2>(outptr, outoffset, mkarray<2>(outstrides), inptr, inoffset,
+              mkarray<2>(instrides), mkarray<2>(shape), type_size);
+    break;
+  case 3:
+    copy_t<3>(outptr, outoffset, mkarray<3>(outstrides), inptr, inoffset,
+              mkarray<3>(instrides), mkarray<3>(shape), type_size);
+    break;
+  case 4:
+    copy_t<4>(outptr, outoffset, mkarray<4>(outstrides), inptr, inoffset,
+              mkarray<4>(instrides), mkarray<4>(shape), type_size);
+    break;
+  default:
+    assert(0);
+  }
+}
+
+// Sort dimensions by output stride, and merge neighbouring dimensions that
+// are contiguous in both input and output
+void sort_dims(vector<ptrdiff_t> &outstrides, vector<ptrdiff_t> &instrides,
+               vector<ptrdiff_t> &shape) {
+  const int rank = shape.size();
+  vector<int> perm(rank);
+  for (int d = 0; d < rank; ++d)
+    perm[d] = d;
+  stable_sort(perm.begin(), perm.end(), [&](int a, int b) {
+    return abs(outstrides[a]) < abs(outstrides[b]);
+  });
+  vector<ptrdiff_t> outstrides1, instrides1, shape1;
+  for (int d : perm) {
+    if (!shape1.empty() &&
+        outstrides[d] == outstrides1.back() * shape1.back() &&
+        instrides[d] == instrides1.back() * shape1.back()) {
+      shape1.back() *= shape[d];
+    } else {
+      outstrides1.push_back(outstrides[d]);
+      instrides1.push_back(instrides[d]);
+      shape1.push_back(shape[d]);
+    }
+  }
+  swap(outstrides, outstrides1);
+  swap(instrides, instrides1);
+  swap(shape, shape1);
+}
+
+// Copy a hyperslab of any rank. The innermost max_fixed_rank dimensions are
+// copied by a specialized kernel; a runtime loop nest iterates over the
+// remaining outer dimensions. Dimensions must be sorted by output stride.
+void copy_any(unsigned char *const outptr, const ptrdiff_t outoffset,
+              const vector<ptrdiff_t> &outstrides,
+              const unsigned char *const inptr, const ptrdiff_t inoffset,
+              const vector<ptrdiff_t> &instrides,
+              const vector<ptrdiff_t> &shape, const ptrdiff_t type_size) {
+  const int rank = shape.size();
+  if (rank <= max_fixed_rank) {
+    copy_fixed(outptr, outoffset, outstrides, inptr, inoffset, instrides,
+               shape, type_size);
+    return;
+  }
+  const int inner = max_fixed_rank;
+  const vector<ptrdiff_t> inner_outstrides(outstrides.begin(),
+                                           outstrides.begin() + inner);
+  const vector<ptrdiff_t> inner_instrides(instrides.begin(),
+                                          instrides.begin() + inner);
+  const vector<ptrdiff_t> inner_shape(shape.begin(), shape.begin() + inner);
+  vector<ptrdiff_t> idx(rank, 0);
+  ptrdiff_t outpos = outoffset, inpos = inoffset;
+  while (true) {
+    copy_fixed(outptr, outpos, inner_outstrides, inptr, inpos,
+               inner_instrides, inner_shape, type_size);
+    int d = inner;
+    for (; d < rank; ++d) {
+      outpos += outstrides[d];
+      inpos += instrides[d];
+      if (++idx[d] < shape[d])
+        break;
+      outpos -= shape[d] * outstrides[d];
+      inpos -= shape[d] * instrides[d];
+      idx[d] = 0;
+    }
+    if (d == rank)
+      break;
+  }
+}
+} // namespace
+
 void copy(void *const outptr0, const ptrdiff_t outnbytes,
-          const ptrdiff_t outoffset, const point_t &outstrides,
+          const ptrdiff_t outoffset, const vector<ptrdiff_t> &outstrides,
           const void *const inptr0, const ptrdiff_t innbytes,
-          const ptrdiff_t inoffset, const point_t &instrides,
-          const point_t &shape, const size_t type_size) {
-  const int rank = shape.rank();
-  assert(outstrides.rank() == rank);
-  assert(instrides.rank() == rank);
+          const ptrdiff_t inoffset, const vector<ptrdiff_t> &instrides,
+          const vector<ptrdiff_t> &shape, const size_t type_size) {
+  const int rank = shape.size();
+  assert(int(outstrides.size()) == rank);
+  assert(int(instrides.size()) == rank);
+
+  for (int d = 0; d < rank; ++d) {
+    assert(shape[d] >= 0);
+    if (shape[d] == 0)
+      return;
+  }
 
   // Check all corners whether they are contained in the array
   for (size_t corner = 0; corner < (size_t(1) << rank); ++corner) {
@@ -303,56 +598,49 @@ void copy(void *const outptr0, const ptrdiff_t outnbytes,
   const auto inptr = static_cast<const unsigned char *>(inptr0);
 
   // Compress stride description
-  point_t outstrides2 = outstrides;
-  point_t instrides2 = instrides;
-  point_t shape2 = shape;
-  int rank2 = shape2.rank();
+  vector<ptrdiff_t> outstrides2 = outstrides;
+  vector<ptrdiff_t> instrides2 = instrides;
+  vector<ptrdiff_t> shape2 = shape;
   size_t type_size2 = type_size;
   bool redo = true;
   while (redo) {
     redo = false;
-    for (int r = 0; r < rank2; ++r) {
-      if (outstrides2[r] == type_size2 && instrides2[r] == type_size2) {
-        outstrides2 = outstrides2.subpoint(r);
-        instrides2 = instrides2.subpoint(r);
+    for (size_t r = 0; r < shape2.size(); ++r) {
+      if (shape2[r] == 1 || (outstrides2[r] == ptrdiff_t(type_size2) &&
+                             instrides2[r] == ptrdiff_t(type_size2))) {
         type_size2 *= shape2[r];
-        shape2 = shape2.subpoint(r);
-        rank2 = shape2.rank();
+        outstrides2.erase(outstrides2.begin() + r);
+        instrides2.erase(instrides2.begin() + r);
+        shape2.erase(shape2.begin() + r);
         redo = true;
         break;
       }
     }
   }
 
-  switch (rank2) {
-  case 0:
-    copy_t<0>(outptr, outnbytes, outoffset, mkarray<0>(outstrides2), inptr,
-              innbytes, inoffset, mkarray<0>(instrides2), mkarray<0>(shape2),
-              type_size2);
-    break;
-  case 1:
-    copy_t<1>(outptr, outnbytes, outoffset, mkarray<1>(outstrides2), inptr,
-              innbytes, inoffset, mkarray<1>(instrides2), mkarray<1>(shape2),
-              type_size2);
-    break;
-  case 2:
-    copy_t<2>(outptr, outnbytes, outoffset, mkarray<2>(outstrides2), inptr,
-              innbytes, inoffset, mkarray<2>(instrides2), mkarray<2>(shape2),
-              type_size2);
-    break;
-  case 3:
-    copy_t<3>(outptr, outnbytes, outoffset, mkarray<3>(outstrides2), inptr,
-              innbytes, inoffset, mkarray<3>(instrides2), mkarray<3>(shape2),
-              type_size2);
-    break;
-  case 4:
-    copy_t<4>(outptr, outnbytes, outoffset, mkarray<4>(outstrides2), inptr,
-              innbytes, inoffset, mkarray<4>(instrides2), mkarray<4>(shape2),
-              type_size2);
-    break;
-  default:
-    assert(0);
+  if (shape2.size() > size_t(max_fixed_rank))
+    sort_dims(outstrides2, instrides2, shape2);
+
+  copy_any(outptr, outoffset, outstrides2, inptr, inoffset, instrides2, shape2,
+           type_size2);
+}
+
+void copy(void *const outptr0, const ptrdiff_t outnbytes,
+          const ptrdiff_t outoffset, const point_t &outstrides,
+          const void *const inptr0, const ptrdiff_t innbytes,
+          const ptrdiff_t inoffset, const point_t &instrides,
+          const point_t &shape, const size_t type_size) {
+  const int rank = shape.rank();
+  assert(outstrides.rank() == rank);
+  assert(instrides.rank() == rank);
+  vector<ptrdiff_t> outstrides1(rank), instrides1(rank), shape1(rank);
+  for (int d = 0; d < rank; ++d) {
+    outstrides1[d] = outstrides[d];
+    instrides1[d] = instrides[d];
+    shape1[d] = shape[d];
   }
+  copy(outptr0, outnbytes, outoffset, outstrides1, inptr0, innbytes, inoffset,
+       instrides1, shape1, type_size);
 }
 
 void copy(void *const outptr0, const ptrdiff_t outnpoints,
@@ -403,6 +691,380 @@ void copy(void *const outptr0, const ptrdiff_t outnpoints,
        type_size * innpoints, inoffset, point_t(instrides), shape, type_size);
 }
 
+
+size_t elttype_size(const elttype_t elttype) {
+  switch (elttype) {
+  case elttype_t::int8:
+  case elttype_t::uint8:
+    return 1;
+  case elttype_t::int16:
+  case elttype_t::uint16:
+    return 2;
+  case elttype_t::int32:
+  case elttype_t::uint32:
+  case elttype_t::float32:
+    return 4;
+  case elttype_t::int64:
+  case elttype_t::uint64:
+  case elttype_t::float64:
+    return 8;
+  case elttype_t::float_long:
+    return sizeof(long double);
+  }
+  assert(0);
+  return 0;
+}
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+bool get_elttype(const H5::DataType &datatype, elttype_t &elttype) {
+  const auto cls = datatype.getClass();
+  if (cls != H5T_INTEGER && cls != H5T_FLOAT)
+    return false;
+  // Only native types can be converted in memory
+  typedef signed char signed_char;
+  typedef unsigned char unsigned_char;
+  typedef unsigned short unsigned_short;
+  typedef long long long_long;
+  typedef unsigned long long unsigned_long_long;
+  typedef long double long_double;
+  if (datatype == H5::getType(signed_char{}))
+    elttype = elttype_t::int8;
+  else if (datatype == H5::getType(unsigned_char{}))
+    elttype = elttype_t::uint8;
+  else if (datatype == H5::getType(short{}))
+    elttype = elttype_t::int16;
+  else if (datatype == H5::getType(unsigned_short{}))
+    elttype = elttype_t::uint16;
+  else if (datatype == H5::getType(int{}))
+    elttype = elttype_t::int32;
+  else if (datatype == H5::getType(unsigned{}))
+    elttype = elttype_t::uint32;
+  else if (datatype == H5::getType(long_long{}))
+    elttype = elttype_t::int64;
+  else if (datatype == H5::getType(unsigned_long_long{}))
+    elttype = elttype_t::uint64;
+  else if (datatype == H5::getType(float{}))
+    elttype = elttype_t::float32;
+  else if (datatype == H5::getType(double{}))
+    elttype = elttype_t::float64;
+  else if (datatype == H5::getType(long_double{}))
+    elttype = elttype_t::float_long;
+  else
+    return false;
+  return true;
+}
+#endif
+
+namespace {
+// Convert a single value, clamping it to the range of the output type
+
+// Floating-point output: use the C++ conversion
+template <typename TO, typename TI>
+inline typename enable_if<is_floating_point<TO>::value, TO>::type
+convert_value(const TI x) {
+  return TO(x);
+}
+
+// Integer output from floating-point input
+template <typename TO, typename TI>
+inline typename enable_if<
+    is_integral<TO>::value && is_floating_point<TI>::value, TO>::type
+convert_value(const TI x) {
+  if (x != x)
+    return TO(0);
+  if (x <= TI(numeric_limits<TO>::min()))
+    return numeric_limits<TO>::min();
+  if (x >= TI(numeric_limits<TO>::max()))
+    return numeric_limits<TO>::max();
+  return TO(x);
+}
+
+// Integer output from integer input
+template <typename TO, typename TI>
+inline typename enable_if<is_integral<TO>::value && is_integral<TI>::value,
+                          TO>::type
+convert_value(const TI x) {
+  // Widening conversions need no checks
+  const bool check_lower = is_signed<TI>::value &&
+                           (!is_signed<TO>::value ||
+                            numeric_limits<TO>::digits <
+                                numeric_limits<TI>::digits);
+  const bool check_upper =
+      numeric_limits<TO>::digits < numeric_limits<TI>::digits;
+  if (check_lower && intmax_t(x) < intmax_t(numeric_limits<TO>::min()))
+    return numeric_limits<TO>::min();
+  if (check_upper && (!is_signed<TI>::value || intmax_t(x) >= 0) &&
+      uintmax_t(x) > uintmax_t(numeric_limits<TO>::max()))
+    return numeric_limits<TO>::max();
+  return TO(x);
+}
+
+template <typename TO, typename TI> class convert_t {
+  vector<ptrdiff_t> outstrides;
+  vector<ptrdiff_t> instrides;
+  vector<ptrdiff_t> shape;
+
+  // Convert the innermost dimension. Unaligned loads and stores go through
+  // memcpy, which the compiler turns into plain vectorizable moves.
+  static void convert_row(unsigned char *const outptr, const ptrdiff_t outdi,
+                          const unsigned char *const inptr,
+                          const ptrdiff_t indi, const ptrdiff_t ni) {
+    const ptrdiff_t NO = sizeof(TO), NI = sizeof(TI);
+    if (outdi == NO && indi == NI) {
+      for (ptrdiff_t i = 0; i < ni; ++i) {
+        TI x;
+        memcpy(&x, inptr + i * NI, NI);
+        const TO y = convert_value<TO>(x);
+        memcpy(outptr + i * NO, &y, NO);
+      }
+    } else {
+      for (ptrdiff_t i = 0; i < ni; ++i) {
+        TI x;
+        memcpy(&x, inptr + i * indi, NI);
+        const TO y = convert_value<TO>(x);
+        memcpy(outptr + i * outdi, &y, NO);
+      }
+    }
+  }
+
+  void convert_nd(const int d, unsigned char *const outptr,
+                  const unsigned char *const inptr) const {
+    if (d == 0) {
+      convert_row(outptr, outstrides[0], inptr, instrides[0], shape[0]);
+      return;
+    }
+    for (ptrdiff_t i = 0; i < shape[d]; ++i)
+      convert_nd(d - 1, outptr + i * outstrides[d], inptr + i * instrides[d]);
+  }
+
+public:
+  convert_t(unsigned char *const outptr, const ptrdiff_t outoffset,
+            const vector<ptrdiff_t> &outstrides0,
+            const unsigned char *const inptr, const ptrdiff_t inoffset,
+            const vector<ptrdiff_t> &instrides0,
+            const vector<ptrdiff_t> &shape0)
+      : outstrides(outstrides0), instrides(instrides0), shape(shape0) {
+    sort_dims(outstrides, instrides, shape);
+    if (shape.empty()) {
+      outstrides.push_back(sizeof(TO));
+      instrides.push_back(sizeof(TI));
+      shape.push_back(1);
+    }
+    const int rank = shape.size();
+
+    const auto &settings = copy_settings();
+    ptrdiff_t nbytes = sizeof(TO);
+    for (int d = 0; d < rank; ++d)
+      nbytes *= shape[d];
+    unsigned char *const outptr1 = outptr + outoffset;
+    const unsigned char *const inptr1 = inptr + inoffset;
+    // Split the outermost dimension into one slab per thread
+    const int dir = rank - 1;
+    const ptrdiff_t ni = shape[dir];
+    const int nthreads = size_t(nbytes) <= settings.cutoff
+                             ? 1
+                             : int(min(ptrdiff_t(copy_nthreads()), ni));
+    if (nthreads <= 1) {
+      convert_nd(dir, outptr1, inptr1);
+      return;
+    }
+    vector<future<void>> slabs;
+    for (int t = 0; t < nthreads; ++t) {
+      const ptrdiff_t i0 = ni * t / nthreads, i1 = ni * (t + 1) / nthreads;
+      convert_t slab(*this);
+      slab.shape[dir] = i1 - i0;
+      unsigned char *const outptr2 = outptr1 + i0 * outstrides[dir];
+      const unsigned char *const inptr2 = inptr1 + i0 * instrides[dir];
+      if (t == nthreads - 1)
+        slab.convert_nd(dir, outptr2, inptr2);
+      else
+        slabs.push_back(async(launch::async, [=]() {
+          slab.convert_nd(dir, outptr2, inptr2);
+        }));
+    }
+    for (auto &slab : slabs)
+      slab.get();
+  }
+};
+
+template <typename TI>
+void convert_from(unsigned char *const outptr, const ptrdiff_t outoffset,
+                  const vector<ptrdiff_t> &outstrides, const elttype_t outtype,
+                  const unsigned char *const inptr, const ptrdiff_t inoffset,
+                  const vector<ptrdiff_t> &instrides,
+                  const vector<ptrdiff_t> &shape) {
+  switch (outtype) {
+  case elttype_t::int8:
+    convert_t<int8_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                          instrides, shape);
+    break;
+  case elttype_t::uint8:
+    convert_t<uint8_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                           instrides, shape);
+    break;
+  case elttype_t::int16:
+    convert_t<int16_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                           instrides, shape);
+    break;
+  case elttype_t::uint16:
+    convert_t<uint16_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                            instrides, shape);
+    break;
+  case elttype_t::int32:
+    convert_t<int32_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                           instrides, shape);
+    break;
+  case elttype_t::uint32:
+    convert_t<uint32_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                            instrides, shape);
+    break;
+  case elttype_t::int64:
+    convert_t<int64_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                           instrides, shape);
+    break;
+  case elttype_t::uint64:
+    convert_t<uint64_t, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                            instrides, shape);
+    break;
+  case elttype_t::float32:
+    convert_t<float, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                         instrides, shape);
+    break;
+  case elttype_t::float64:
+    convert_t<double, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                          instrides, shape);
+    break;
+  case elttype_t::float_long:
+    convert_t<long double, TI>(outptr, outoffset, outstrides, inptr, inoffset,
+                               instrides, shape);
+    break;
+  default:
+    assert(0);
+  }
+}
+} // namespace
+
+void copy(void *const outptr0, const ptrdiff_t outnbytes,
+          const ptrdiff_t outoffset, const vector<ptrdiff_t> &outstrides,
+          const elttype_t outtype, const void *const inptr0,
+          const ptrdiff_t innbytes, const ptrdiff_t inoffset,
+          const vector<ptrdiff_t> &instrides, const elttype_t intype,
+          const vector<ptrdiff_t> &shape) {
+  if (outtype == intype) {
+    copy(outptr0, outnbytes, outoffset, outstrides, inptr0, innbytes, inoffset,
+         instrides, shape, elttype_size(intype));
+    return;
+  }
+
+  const int rank = shape.size();
+  assert(int(outstrides.size()) == rank);
+  assert(int(instrides.size()) == rank);
+  const ptrdiff_t outsize = elttype_size(outtype);
+  const ptrdiff_t insize = elttype_size(intype);
+
+  for (int d = 0; d < rank; ++d) {
+    assert(shape[d] >= 0);
+    if (shape[d] == 0)
+      return;
+  }
+
+  // Check all corners whether they are contained in the array
+  for (size_t corner = 0; corner < (size_t(1) << rank); ++corner) {
+    ptrdiff_t outpos = outoffset;
+    for (int d = 0; d < rank; ++d) {
+      size_t dbit = size_t(1) << d;
+      outpos += outstrides[d] * (corner & dbit ? shape[d] - 1 : 0);
+    }
+    assert(outpos >= 0 && outpos + outsize <= outnbytes);
+    ptrdiff_t inpos = inoffset;
+    for (int d = 0; d < rank; ++d) {
+      size_t dbit = size_t(1) << d;
+      inpos += instrides[d] * (corner & dbit ? shape[d] - 1 : 0);
+    }
+    assert(inpos >= 0 && inpos + insize <= innbytes);
+  }
+
+  const auto outptr = static_cast<unsigned char *>(outptr0);
+  const auto inptr = static_cast<const unsigned char *>(inptr0);
+
+  switch (intype) {
+  case elttype_t::int8:
+    convert_from<int8_t>(outptr, outoffset, outstrides, outtype, inptr,
+                         inoffset, instrides, shape);
+    break;
+  case elttype_t::uint8:
+    convert_from<uint8_t>(outptr, outoffset, outstrides, outtype, inptr,
+                          inoffset, instrides, shape);
+    break;
+  case elttype_t::int16:
+    convert_from<int16_t>(outptr, outoffset, outstrides, outtype, inptr,
+                          inoffset, instrides, shape);
+    break;
+  case elttype_t::uint16:
+    convert_from<uint16_t>(outptr, outoffset, outstrides, outtype, inptr,
+                           inoffset, instrides, shape);
+    break;
+  case elttype_t::int32:
+    convert_from<int32_t>(outptr, outoffset, outstrides, outtype, inptr,
+                          inoffset, instrides, shape);
+    break;
+  case elttype_t::uint32:
+    convert_from<uint32_t>(outptr, outoffset, outstrides, outtype, inptr,
+                           inoffset, instrides, shape);
+    break;
+  case elttype_t::int64:
+    convert_from<int64_t>(outptr, outoffset, outstrides, outtype, inptr,
+                          inoffset, instrides, shape);
+    break;
+  case elttype_t::uint64:
+    convert_from<uint64_t>(outptr, outoffset, outstrides, outtype, inptr,
+                           inoffset, instrides, shape);
+    break;
+  case elttype_t::float32:
+    convert_from<float>(outptr, outoffset, outstrides, outtype, inptr,
+                        inoffset, instrides, shape);
+    break;
+  case elttype_t::float64:
+    convert_from<double>(outptr, outoffset, outstrides, outtype, inptr,
+                         inoffset, instrides, shape);
+    break;
+  case elttype_t::float_long:
+    convert_from<long double>(outptr, outoffset, outstrides, outtype, inptr,
+                              inoffset, instrides, shape);
+    break;
+  default:
+    assert(0);
+  }
+}
+
+void copy(void *const outptr0, const ptrdiff_t outnpoints,
+          const box_t &outlayout, const box_t &outbox, const elttype_t outtype,
+          const void *const inptr0, const ptrdiff_t innpoints,
+          const box_t &inlayout, const box_t &inbox, const elttype_t intype) {
+  const int rank = outlayout.rank();
+  assert(outbox.rank() == rank);
+  assert(inlayout.rank() == rank);
+  assert(inbox.rank() == rank);
+  assert(outlayout.size() <= outnpoints);
+  assert(inlayout.size() <= innpoints);
+  const auto shape = outbox.shape();
+  assert(all(inbox.shape() == shape));
+
+  const ptrdiff_t outsize = elttype_size(outtype);
+  const ptrdiff_t insize = elttype_size(intype);
+  const auto out_off_str = layout2strides(outlayout, outbox, outsize);
+  const auto in_off_str = layout2strides(inlayout, inbox, insize);
+  vector<ptrdiff_t> outstrides(rank), instrides(rank), shape1(rank);
+  for (int d = 0; d < rank; ++d) {
+    outstrides[d] = out_off_str.second[d];
+    instrides[d] = in_off_str.second[d];
+    shape1[d] = shape[d];
+  }
+  copy(outptr0, outsize * outnpoints, out_off_str.first, outstrides, outtype,
+       inptr0, insize * innpoints, in_off_str.first, instrides, intype,
+       shape1);
+}
+
 } // namespace HyperSlab
 
 // DataBlock
@@ -553,18 +1215,134 @@ void DataRange::write(const tiledb_writer &w, const string &entry) const {
 #endif
 
 #ifdef SIMULATIONIO_HAVE_HDF5
+void DataRange::readData(void *data, const H5::DataType &datatype,
+                         const box_t &datalayout, const box_t &databox) const {
+  HyperSlab::elttype_t elttype;
+  bool have_elttype;
+  {
+    H5::library_lock lock;
+    have_elttype = HyperSlab::get_elttype(datatype, elttype);
+  }
+  if (!have_elttype)
+    throw invalid_argument(
+        "DataRange::readData: datatype must be a native numeric type");
+  switch (elttype) {
+  case HyperSlab::elttype_t::int8:
+    readData(static_cast<int8_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::uint8:
+    readData(static_cast<uint8_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::int16:
+    readData(static_cast<int16_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::uint16:
+    readData(static_cast<uint16_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::int32:
+    readData(static_cast<int32_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::uint32:
+    readData(static_cast<uint32_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::int64:
+    readData(static_cast<int64_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::uint64:
+    readData(static_cast<uint64_t *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::float32:
+    readData(static_cast<float *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::float64:
+    readData(static_cast<double *>(data), datalayout, databox);
+    break;
+  case HyperSlab::elttype_t::float_long:
+    readData(static_cast<long double *>(data), datalayout, databox);
+    break;
+  }
+}
+#endif
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+
+// element_type_t
+
+element_type_t::element_type_t(const H5::DataType &datatype)
+    : element_type_t() {
+  H5::library_lock lock;
+  m_size = datatype.getSize();
+  m_have_elttype = HyperSlab::get_elttype(datatype, m_elttype);
+  if (!m_have_elttype)
+    m_datatype = shared_ptr<const H5::DataType>(new H5::DataType(datatype),
+                                                [](const H5::DataType *p) {
+                                                  H5::library_lock lock;
+                                                  delete p;
+                                                });
+}
+
+bool element_type_t::operator==(const element_type_t &other) const {
+  if (m_have_elttype && other.m_have_elttype)
+    return m_elttype == other.m_elttype;
+  // A native numeric type differs from all other types
+  if (m_have_elttype || other.m_have_elttype)
+    return false;
+  if (m_cxxtype && other.m_cxxtype)
+    return *m_cxxtype == *other.m_cxxtype;
+  H5::library_lock lock;
+  return datatype() == other.datatype();
+}
+
+H5::DataType element_type_t::datatype() const {
+  H5::library_lock lock;
+  if (m_datatype)
+    return *m_datatype;
+  if (m_make_datatype)
+    return m_make_datatype();
+  assert(m_have_elttype);
+  typedef signed char signed_char;
+  typedef unsigned char unsigned_char;
+  typedef unsigned short unsigned_short;
+  typedef long long long_long;
+  typedef unsigned long long unsigned_long_long;
+  typedef long double long_double;
+  switch (m_elttype) {
+  case HyperSlab::elttype_t::int8:
+    return H5::getType(signed_char{});
+  case HyperSlab::elttype_t::uint8:
+    return H5::getType(unsigned_char{});
+  case HyperSlab::elttype_t::int16:
+    return H5::getType(short{});
+  case HyperSlab::elttype_t::uint16:
+    return H5::getType(unsigned_short{});
+  case HyperSlab::elttype_t::int32:
+    return H5::getType(int{});
+  case HyperSlab::elttype_t::uint32:
+    return H5::getType(unsigned{});
+  case HyperSlab::elttype_t::int64:
+    return H5::getType(long_long{});
+  case HyperSlab::elttype_t::uint64:
+    return H5::getType(unsigned_long_long{});
+  case HyperSlab::elttype_t::float32:
+    return H5::getType(float{});
+  case HyperSlab::elttype_t::float64:
+    return H5::getType(double{});
+  case HyperSlab::elttype_t::float_long:
+    return H5::getType(long_double{});
+  }
+  assert(0);
+  return H5::DataType();
+}
 
 // DataSet
 
 bool DataSet::invariant() const {
-  bool inv = DataBlock::invariant();
-  int ndims = m_dataspace.getSimpleExtentNdims();
-  inv &= ndims == rank();
-  vector<hsize_t> dims(rank());
-  m_dataspace.getSimpleExtentDims(dims.data());
-  reverse(dims);
-  inv &= all(point_t(dims) == shape());
-  return inv;
+  return DataBlock::invariant() && m_datatype.valid();
+}
+
+H5::DataSpace DataSet::dataspace() const {
+  H5::library_lock lock;
+  return H5::DataSpace(rank(), reversed(vector<hsize_t>(shape())).data());
 }
 
 shared_ptr<DataSet> DataSet::read(const H5::Group &group, const string &entry,
@@ -608,29 +1386,37 @@ shared_ptr<DataSet> DataSet::read_asdf(const shared_ptr<ASDF::reader_state> &rs,
 
 ostream &DataSet::output(ostream &os) const {
   using namespace Output;
+  H5::library_lock lock;
   auto cls = datatype().getClass();
   auto clsname = H5::className(cls);
-  auto typesize = datatype().getSize();
-  assert(dataspace().isSimple());
-  int dim = dataspace().getSimpleExtentNdims();
-  vector<hsize_t> size(dim);
-  dataspace().getSimpleExtentDims(size.data());
-  reverse(size);
+  auto typesize = m_datatype.size();
   os << "DataSet: type=" << clsname << "(" << (8 * typesize)
-     << " bit) shape=" << size;
+     << " bit) shape=" << shape();
   return os;
 }
 
 void DataSet::write(const H5::Group &group, const string &entry) const {
   assert(!m_have_dataset);
+  H5::library_lock lock;
   m_location_group = group;
   m_location_name = entry;
   m_have_location = true;
   create_dataset();
   if (m_have_attached_data) {
-    writeData(m_attached_data.data(), m_memtype, m_memlayout, m_membox);
-    m_attached_data.clear();
+    if (m_borrowed_data) {
+      write_borrowed_data();
+      m_borrowed_data = nullptr;
+      m_borrowed_owner.reset();
+    } else {
+      write_data(m_attached_data.data(), m_memtype, m_memlayout, m_membox,
+                 nullptr);
+      m_attached_data.clear();
+    }
     m_have_attached_data = false;
+    if (m_write_norm) {
+      m_write_norm(m_dataset);
+      m_write_norm = nullptr;
+    }
   }
 }
 
@@ -638,20 +1424,31 @@ void DataSet::write(const H5::Group &group, const string &entry) const {
 void DataSet::write(ASDF::writer &w, const string &entry) const { assert(0); }
 #endif
 
+void DataSet::closeHDF5() const {
+  // Nothing to release (and no need to wait for the library lock) if the
+  // dataset has not been written
+  if (m_location_group.getId() < 0 && m_dataset.getId() < 0)
+    return;
+  H5::library_lock lock;
+  m_location_group = H5::Group();
+  m_dataset = H5::DataSet();
+  m_have_location = false;
+  m_have_dataset = false;
+}
+
 void DataSet::create_dataset() const {
   if (m_have_dataset)
     return;
   assert(m_have_location);
   auto proplist = H5::DSetCreatPropList();
-  assert(dataspace().isSimple());
-  const int dim = dataspace().getSimpleExtentNdims();
-  vector<hsize_t> size(dim);
-  dataspace().getSimpleExtentDims(size.data());
+  const auto datatype = m_datatype.datatype();
+  const int dim = rank();
+  const vector<hsize_t> size = reversed(vector<hsize_t>(shape()));
   if (dim > 0) {
     // Zero-dimensional (scalar) datasets cannot be chunked
     if (write_options.chunk || write_options.compress ||
         write_options.shuffle || write_options.checksum) {
-      auto chunksize = choose_chunksize(size, datatype().getSize());
+      auto chunksize = choose_chunksize(write_options, size, m_datatype.size());
       proplist.setChunk(dim, chunksize.data());
     }
     if (write_options.checksum) {
@@ -660,25 +1457,296 @@ void DataSet::create_dataset() const {
     if (write_options.shuffle) {
       proplist.setShuffle(); // Shuffling improves compression
     }
-    if (write_options.compress) {
-      // Level 1 is fast, but still offers good compression
-      const int level = write_options.compression_level;
-      // We always use deflate, ignoring the user's choice
-      proplist.setDeflate(level);
-    }
+    if (write_options.compress)
+      set_compression(proplist, write_options, datatype);
   }
   assert(m_have_location);
-  m_dataset = m_location_group.createDataSet(m_location_name, datatype(),
+  m_dataset = m_location_group.createDataSet(m_location_name, datatype,
                                              dataspace(), proplist);
   m_have_dataset = true;
 }
 
+namespace {
+// Checksum used by HDF5's Fletcher32 filter
+uint32_t checksum_fletcher32(const unsigned char *data, const size_t nbytes) {
+  size_t len = nbytes / 2;
+  uint32_t sum1 = 0, sum2 = 0;
+  while (len) {
+    const size_t tlen = min(len, size_t(360));
+    len -= tlen;
+    for (size_t i = 0; i < tlen; ++i) {
+      sum1 += (uint32_t(data[0]) << 8) | uint32_t(data[1]);
+      data += 2;
+      sum2 += sum1;
+    }
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+  if (nbytes % 2) {
+    sum1 += uint32_t(data[0]) << 8;
+    sum2 += sum1;
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+  sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+  sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  return (sum2 << 16) | sum1;
+}
+
+// An HDF5 filter that we can apply ourselves
+struct chunk_filter_t {
+  H5Z_filter_t id;
+  vector<unsigned int> cd_values;
+};
+
+// Read the filter pipeline of a dataset; returns false if it contains a
+// filter that we cannot apply
+bool get_chunk_filters(const H5::DSetCreatPropList &proplist,
+                       vector<chunk_filter_t> &filters) {
+  const int nfilters = H5Pget_nfilters(proplist.getId());
+  assert(nfilters >= 0);
+  filters.clear();
+  for (int n = 0; n < nfilters; ++n) {
+    chunk_filter_t filter;
+    unsigned int flags;
+    size_t cd_nelmts = 8;
+    filter.cd_values.resize(cd_nelmts);
+    filter.id = H5Pget_filter2(proplist.getId(), n, &flags, &cd_nelmts,
+                               filter.cd_values.data(), 0, nullptr, nullptr);
+    filter.cd_values.resize(min(cd_nelmts, filter.cd_values.size()));
+    switch (filter.id) {
+    case H5Z_FILTER_FLETCHER32:
+    case H5Z_FILTER_SHUFFLE:
+#ifdef SIMULATIONIO_HAVE_ZLIB
+    case H5Z_FILTER_DEFLATE:
+#endif
+    case H5::H5Z_FILTER_LZ4:
+      break;
+#ifdef SIMULATIONIO_HAVE_BZIP2
+    case H5::H5Z_FILTER_BZIP2:
+      break;
+#endif
+    default:
+      return false;
+    }
+    filters.push_back(filter);
+  }
+  return true;
+}
+
+// Apply a filter pipeline to a chunk, producing the same bytes as HDF5
+vector<unsigned char> apply_chunk_filters(const vector<chunk_filter_t> &filters,
+                                          vector<unsigned char> buf,
+                                          const size_t typesize) {
+  for (const auto &filter : filters) {
+    switch (filter.id) {
+    case H5Z_FILTER_FLETCHER32: {
+      // Append the checksum in little-endian byte order
+      const uint32_t sum = checksum_fletcher32(buf.data(), buf.size());
+      for (int b = 0; b < 4; ++b)
+        buf.push_back((sum >> (8 * b)) & 0xff);
+      break;
+    }
+    case H5Z_FILTER_SHUFFLE: {
+      // Group the n-th bytes of all elements; trailing bytes that do not
+      // form a complete element are kept as they are
+      const size_t eltsize =
+          filter.cd_values.empty() ? typesize : filter.cd_values[0];
+      if (eltsize <= 1)
+        break;
+      const size_t nelts = buf.size() / eltsize;
+      if (nelts <= 1)
+        break;
+      vector<unsigned char> shuffled(buf.size());
+      for (size_t b = 0; b < eltsize; ++b)
+        for (size_t i = 0; i < nelts; ++i)
+          shuffled[b * nelts + i] = buf[i * eltsize + b];
+      copy(buf.begin() + nelts * eltsize, buf.end(),
+           shuffled.begin() + nelts * eltsize);
+      swap(buf, shuffled);
+      break;
+    }
+#ifdef SIMULATIONIO_HAVE_ZLIB
+    case H5Z_FILTER_DEFLATE: {
+      const int level = filter.cd_values.empty() ? Z_DEFAULT_COMPRESSION
+                                                 : int(filter.cd_values[0]);
+      uLongf nbytes = compressBound(buf.size());
+      vector<unsigned char> compressed(nbytes);
+      const int ierr =
+          compress2(compressed.data(), &nbytes, buf.data(), buf.size(), level);
+      if (ierr != Z_OK)
+        throw runtime_error("zlib compression failed");
+      compressed.resize(nbytes);
+      swap(buf, compressed);
+      break;
+    }
+#endif
+    default: {
+      const bool applied = H5::applyFilter(filter.id, filter.cd_values, buf);
+      assert(applied);
+    }
+    }
+  }
+  return buf;
+}
+} // namespace
+
+// Filter all chunks of the dataset in parallel, and write them directly to
+// the file. Returns false if this is not possible (e.g. because the HDF5
+// library is too old, or because of an unsupported filter).
+bool DataSet::write_chunks(const void *data, const box_t &datalayout,
+                           norm_copier *const norm) const {
+#if H5_VERSION_GE(1, 10, 3)
+  const auto proplist = m_dataset.getCreatePlist();
+  if (proplist.getLayout() != H5D_CHUNKED)
+    return false;
+  vector<chunk_filter_t> filters;
+  if (!get_chunk_filters(proplist, filters))
+    return false;
+  const int dim = rank();
+  vector<hsize_t> cchunksize(dim);
+  proplist.getChunk(dim, cchunksize.data());
+  // Chunk shape in our (Fortran) index order
+  const point_t chunkshape(reversed(cchunksize));
+  const auto typesize = m_datatype.size();
+
+  // Enumerate chunks
+  vector<box_t> chunks;
+  const point_t one(dim, 1);
+  const auto nchunks_dir = (shape() + chunkshape - one) / chunkshape;
+  vector<long long> idx(dim, 0);
+  while (true) {
+    const auto lower = box().lower() + point_t(idx) * chunkshape;
+    chunks.push_back(box_t(lower, lower + chunkshape));
+    int d = 0;
+    for (; d < dim; ++d) {
+      if (++idx[d] < nchunks_dir[d])
+        break;
+      idx[d] = 0;
+    }
+    if (d == dim)
+      break;
+  }
+  const size_t nchunks = chunks.size();
+
+  // Filter chunks in parallel. Chunks are written in order by this thread,
+  // since HDF5 is not thread-safe; a window limits the number of filtered
+  // chunks that are waiting to be written. Each worker repacks its chunks
+  // serially, since the workers already use all threads.
+  const int nthreads =
+      max(1, min(HyperSlab::copy_settings().nthreads, int(nchunks)));
+  const size_t window = 4 * size_t(nthreads);
+  vector<vector<unsigned char>> results(nchunks);
+  vector<bool> ready(nchunks, false);
+  size_t next = 0, nwritten = 0;
+  // The first exception thrown by a worker or the writer; all threads stop
+  // when it is set
+  exception_ptr error;
+  mutex mtx;
+  condition_variable cond;
+  const auto fail = [&]() {
+    {
+      lock_guard<mutex> lock(mtx);
+      if (!error)
+        error = current_exception();
+    }
+    cond.notify_all();
+  };
+  const auto worker = [&]() {
+    HyperSlab::serial_copies serial;
+    while (true) {
+      size_t n;
+      {
+        unique_lock<mutex> lock(mtx);
+        cond.wait(lock,
+                  [&]() { return error || next < nwritten + window; });
+        if (error || next >= nchunks)
+          return;
+        n = next++;
+      }
+      vector<unsigned char> filtered;
+      try {
+        const auto &chunk = chunks[n];
+        // Edge chunks are padded with zeros
+        vector<unsigned char> buf(chunk.size() * typesize, 0);
+        if (norm)
+          norm->copy(buf.data(), chunk.size(), chunk, chunk & box(), data,
+                     datalayout.size(), datalayout, chunk & box());
+        else
+          HyperSlab::copy(buf.data(), chunk.size(), chunk, chunk & box(), data,
+                          datalayout.size(), datalayout, chunk & box(),
+                          typesize);
+        filtered = apply_chunk_filters(filters, move(buf), typesize);
+      } catch (...) {
+        fail();
+        return;
+      }
+      {
+        lock_guard<mutex> lock(mtx);
+        results[n] = move(filtered);
+        ready[n] = true;
+      }
+      cond.notify_all();
+    }
+  };
+  vector<future<void>> workers;
+  for (int t = 0; t < nthreads; ++t)
+    workers.push_back(async(launch::async, worker));
+
+  try {
+    for (size_t n = 0; n < nchunks; ++n) {
+      vector<unsigned char> filtered;
+      {
+        unique_lock<mutex> lock(mtx);
+        cond.wait(lock, [&]() { return error || bool(ready[n]); });
+        if (error)
+          break;
+        swap(filtered, results[n]);
+      }
+      const auto coffset = reversed(vector<hsize_t>(chunks[n].lower() -
+                                                    box().lower()));
+      const herr_t herr =
+          H5Dwrite_chunk(m_dataset.getId(), H5P_DEFAULT, 0, coffset.data(),
+                         filtered.size(), filtered.data());
+      if (herr < 0)
+        throw H5::DataSetIException("DataSet::write_chunks",
+                                    "H5Dwrite_chunk failed");
+      {
+        lock_guard<mutex> lock(mtx);
+        ++nwritten;
+      }
+      cond.notify_all();
+    }
+  } catch (...) {
+    fail();
+  }
+  for (auto &w : workers)
+    w.get();
+  if (error)
+    rethrow_exception(error);
+  return true;
+#else
+  return false;
+#endif
+}
+
 void DataSet::writeData(const void *data, const H5::DataType &datatype,
                         const box_t &datalayout, const box_t &databox) const {
+  write_data(data, element_type_t(datatype), datalayout, databox, nullptr);
+}
+
+bool DataSet::write_data(const void *data, const element_type_t &datatype,
+                         const box_t &datalayout, const box_t &databox,
+                         norm_copier *const norm) const {
+  H5::library_lock lock;
   // create_dataset();
+  if (write_options.parallel_filters && rank() > 0 && databox == box() &&
+      datatype == m_datatype && write_chunks(data, datalayout, norm))
+    return bool(norm);
   H5::DataSpace memspace, filespace;
-  construct_spaces(datalayout, databox, m_dataspace, memspace, filespace);
-  m_dataset.write(data, datatype, memspace, filespace);
+  construct_spaces(datalayout, databox, dataspace(), memspace, filespace);
+  m_dataset.write(data, datatype.datatype(), memspace, filespace);
+  return false;
 }
 
 void DataSet::attachData(const vector<char> &data, const H5::DataType &datatype,
@@ -687,11 +1755,11 @@ void DataSet::attachData(const vector<char> &data, const H5::DataType &datatype,
   assert(not m_have_location);
   assert(not m_have_attached_data);
 
-  m_memtype = datatype;
   m_memlayout = datalayout;
   m_membox = databox;
   auto count = m_membox.size();
-  auto typesize = m_memtype.getSize();
+  m_memtype = element_type_t(datatype);
+  auto typesize = m_memtype.size();
 
   assert(m_attached_data.empty());
   assert(data.size() == count * typesize);
@@ -705,11 +1773,11 @@ void DataSet::attachData(vector<char> &&data, const H5::DataType &datatype,
   assert(not m_have_location);
   assert(not m_have_attached_data);
 
-  m_memtype = datatype;
   m_memlayout = datalayout;
   m_membox = databox;
   auto count = m_membox.size();
-  auto typesize = m_memtype.getSize();
+  m_memtype = element_type_t(datatype);
+  auto typesize = m_memtype.size();
 
   assert(m_attached_data.empty());
   assert(data.size() == count * typesize);
@@ -719,19 +1787,39 @@ void DataSet::attachData(vector<char> &&data, const H5::DataType &datatype,
 
 void DataSet::attachData(const void *data, const H5::DataType &datatype,
                          const box_t &datalayout, const box_t &databox) const {
+  attach_data(data, element_type_t(datatype), datalayout, databox);
+}
+
+void DataSet::attach_data(const void *data, const element_type_t &datatype,
+                          const box_t &datalayout,
+                          const box_t &databox) const {
   assert(not m_have_dataset);
   assert(not m_have_location);
   assert(not m_have_attached_data);
   assert(data);
 
-  m_memtype = datatype;
   // m_memlayout = datalayout;
   m_memlayout = databox; // since we copy
   m_membox = databox;
   auto count = m_membox.size();
-  auto typesize = m_memtype.getSize();
 
   assert(m_attached_data.empty());
+  HyperSlab::elttype_t memelttype, fileelttype;
+  const bool convert = datatype != m_datatype &&
+                       datatype.get_elttype(memelttype) &&
+                       m_datatype.get_elttype(fileelttype);
+  // When converting, convert to the dataset's type while copying, so that
+  // HDF5 does not need to convert when writing
+  m_memtype = convert ? m_datatype : datatype;
+  const auto typesize = m_memtype.size();
+  if (convert) {
+    m_attached_data.resize(count * typesize);
+    HyperSlab::copy(m_attached_data.data(), count, m_memlayout, m_membox,
+                    fileelttype, data, datalayout.size(), datalayout, databox,
+                    memelttype);
+    m_have_attached_data = true;
+    return;
+  }
   m_attached_data.resize(count * typesize);
   // memcpy(m_attached_data.data(), data, m_attached_data.size());
   HyperSlab::copy(m_attached_data.data(), count, m_memlayout, m_membox, data,
@@ -739,30 +1827,188 @@ void DataSet::attachData(const void *data, const H5::DataType &datatype,
   m_have_attached_data = true;
 }
 
-// DataBuffer
+void DataSet::attachData(const void *data, const shared_ptr<const void> &owner,
+                         const H5::DataType &datatype, const box_t &datalayout,
+                         const box_t &databox) const {
+  attach_data(data, owner, element_type_t(datatype), datalayout, databox);
+}
 
-shared_ptr<DataBuffer::dbuffer_t>
-DataBuffer::dbuffer_t::make(const H5::DataType &datatype) {
-  typedef long long long_long;
-  if (datatype == H5::getType(int{})) {
-    return make_shared<buffer_t<int>>();
-  } else if (datatype == H5::getType(long_long{})) {
-    return make_shared<buffer_t<long long>>();
-  } else if (datatype == H5::getType(float{})) {
-    return make_shared<buffer_t<float>>();
-  } else if (datatype == H5::getType(double{})) {
-    return make_shared<buffer_t<double>>();
+void DataSet::attach_data(const void *data, const shared_ptr<const void> &owner,
+                          const element_type_t &datatype,
+                          const box_t &datalayout,
+                          const box_t &databox) const {
+  assert(not m_have_dataset);
+  assert(not m_have_location);
+  assert(not m_have_attached_data);
+  assert(data);
+  assert(databox <= datalayout);
+
+  m_memtype = datatype;
+  m_memlayout = datalayout;
+  m_membox = databox;
+  m_borrowed_data = data;
+  m_borrowed_owner = owner;
+  m_have_attached_data = true;
+}
+
+namespace {
+// Whether a box occupies a contiguous range of memory in a layout
+bool is_contiguous(const box_t &layout, const box_t &box) {
+  const int rank = layout.rank();
+  const auto layoutshape = layout.shape();
+  const auto boxshape = box.shape();
+  // Skip the leading dimensions that span the whole layout, then there may
+  // be one partial dimension, followed by dimensions of extent one
+  int d = 0;
+  while (d < rank && boxshape[d] == layoutshape[d])
+    ++d;
+  if (d < rank)
+    ++d;
+  while (d < rank && boxshape[d] == 1)
+    ++d;
+  return d == rank;
+}
+} // namespace
+
+void DataSet::write_borrowed_data() const {
+  H5::library_lock lock;
+  HyperSlab::elttype_t memelttype, fileelttype;
+  const bool convert = m_memtype != m_datatype &&
+                       m_memtype.get_elttype(memelttype) &&
+                       m_datatype.get_elttype(fileelttype);
+  if (!convert && is_contiguous(m_memlayout, m_membox)) {
+    // Write directly from the caller's memory
+    write_data(m_borrowed_data, m_memtype, m_memlayout, m_membox, nullptr);
+    return;
+  }
+  // Repack (and convert) into a temporary buffer
+  const auto count = m_membox.size();
+  if (convert) {
+    vector<char> buf(count * m_datatype.size());
+    HyperSlab::copy(buf.data(), count, m_membox, m_membox, fileelttype,
+                    m_borrowed_data, m_memlayout.size(), m_memlayout, m_membox,
+                    memelttype);
+    write_data(buf.data(), m_datatype, m_membox, m_membox, nullptr);
   } else {
-    assert(0);
+    const auto typesize = m_memtype.size();
+    vector<char> buf(count * typesize);
+    HyperSlab::copy(buf.data(), count, m_membox, m_membox, m_borrowed_data,
+                    m_memlayout.size(), m_memlayout, m_membox, typesize);
+    write_data(buf.data(), m_memtype, m_membox, m_membox, nullptr);
+  }
+}
+
+// DataBuffer
+
+namespace {
+// Copy a hyperslab, converting between native types if necessary
+void copy_convert(void *const outptr, const ptrdiff_t outnpoints,
+                  const box_t &outlayout, const box_t &outbox,
+                  const H5::DataType &outtype, const void *const inptr,
+                  const ptrdiff_t innpoints, const box_t &inlayout,
+                  const box_t &inbox, const H5::DataType &intype) {
+  if (outtype == intype) {
+    HyperSlab::copy(outptr, outnpoints, outlayout, outbox, inptr, innpoints,
+                    inlayout, inbox, intype.getSize());
+    return;
   }
+  HyperSlab::elttype_t outelttype, inelttype;
+  const bool can_convert = HyperSlab::get_elttype(outtype, outelttype) &&
+                           HyperSlab::get_elttype(intype, inelttype);
+  assert(can_convert);
+  HyperSlab::copy(outptr, outnpoints, outlayout, outbox, outelttype, inptr,
+                  innpoints, inlayout, inbox, inelttype);
 }
+} // namespace
 
-DataBuffer::DataBuffer(int dim, const H5::DataType &datatype)
-    : m_datatype(datatype), m_concatenation(dconcatenation_t::make(dim)),
-      m_buffer(dbuffer_t::make(datatype)) {}
+DataBuffer::DataBuffer(const WriteOptions &write_options, int dim,
+                       const H5::DataType &datatype)
+    : m_write_options(write_options),
+      m_concatenation(dconcatenation_t::make(dim)), m_have_dataset(false) {
+  H5::library_lock lock;
+  m_datatype = datatype;
+}
+
+DataBuffer::DataBuffer(const H5::DataSet &dataset) : m_have_dataset(true) {
+  H5::library_lock lock;
+  m_datatype = dataset.getDataType();
+  m_dataspace = dataset.getSpace();
+  m_dataset = dataset;
+  dataset.reference(&m_reference, ".");
+  // Entry i occupies [offsets[i], offsets[i+1])
+  auto offsetdataset = dataset.openDataSet(dataset.getObjName() + "_offsets");
+  const auto offsetspace = offsetdataset.getSpace();
+  assert(offsetspace.getSimpleExtentNdims() == 1);
+  hsize_t noffsets;
+  offsetspace.getSimpleExtentDims(&noffsets);
+  m_offsets.resize(noffsets);
+  offsetdataset.read(m_offsets.data(), H5::getType(m_offsets[0]));
+}
+
+shared_ptr<DataBuffer> DataBuffer::get(const H5::Group &group,
+                                       const hobj_ref_t &reference) {
+  H5::library_lock library_lock;
+  // References are unique within a file, and HDF5 does not reuse file
+  // numbers while a file is open (which it is while its buffer is in use)
+  H5O_info_t info;
+  herr_t herr = H5Oget_info(group.getId(), &info);
+  assert(!herr);
+  typedef pair<unsigned long, hobj_ref_t> key_t;
+  static mutex registry_mutex;
+  static map<key_t, weak_ptr<DataBuffer>> registry;
+  lock_guard<mutex> lock(registry_mutex);
+  const key_t key(info.fileno, reference);
+  auto databuffer = registry[key].lock();
+  if (!databuffer) {
+    // Forget the buffers that are not used any more
+    for (auto it = registry.begin(); it != registry.end();)
+      it = it->second.expired() ? registry.erase(it) : next(it);
+    databuffer =
+        make_shared<DataBuffer>(H5::DataSet(group, &reference, H5R_OBJECT));
+    registry[key] = databuffer;
+  }
+  return databuffer;
+}
 
 void DataBuffer::write(const H5::Group &group, const string &entry) const {
-  assert(false);
+  assert(!m_have_dataset);
+  assert(m_concatenation);
+  H5::library_lock lock;
+  const hsize_t size = m_concatenation->size();
+  const auto typesize = m_datatype.getSize();
+  m_dataspace = H5::DataSpace(1, &size);
+  auto proplist = H5::DSetCreatPropList();
+  // Empty datasets cannot be chunked
+  if (size > 0 &&
+      (m_write_options.chunk || m_write_options.compress ||
+       m_write_options.shuffle || m_write_options.checksum)) {
+    auto chunksize = choose_chunksize(m_write_options, {size}, typesize);
+    proplist.setChunk(1, chunksize.data());
+    if (m_write_options.checksum)
+      proplist.setFletcher32();
+    if (m_write_options.shuffle)
+      proplist.setShuffle();
+    if (m_write_options.compress)
+      set_compression(proplist, m_write_options, m_datatype);
+  }
+  m_dataset = group.createDataSet(entry, m_datatype, m_dataspace, proplist);
+  m_dataset.reference(&m_reference, ".");
+  m_have_dataset = true;
+  if (!m_data.empty()) {
+    m_data.resize(size * typesize);
+    m_dataset.write(m_data.data(), m_datatype);
+    m_data.clear();
+    m_data.shrink_to_fit();
+  }
+
+  // Offset table: entry i occupies [offsets[i], offsets[i+1])
+  auto offsets = m_concatenation->positions();
+  offsets.push_back(size);
+  const hsize_t noffsets = offsets.size();
+  const auto offsettype = H5::getType(offsets[0]);
+  auto offsetdataset = group.createDataSet(
+      entry + "_offsets", offsettype, H5::DataSpace(1, &noffsets));
+  offsetdataset.write(offsets.data(), offsettype);
 }
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
@@ -771,24 +2017,149 @@ void DataBuffer::write(ASDF::writer &w, const string &entry) const {
 }
 #endif
 
+void DataBuffer::closeHDF5() const {
+  if (m_datatype.getId() < 0 && m_dataspace.getId() < 0 &&
+      m_dataset.getId() < 0)
+    return;
+  H5::library_lock lock;
+  m_datatype = H5::DataType();
+  m_dataspace = H5::DataSpace();
+  m_dataset = H5::DataSet();
+  m_have_dataset = false;
+}
+
+void DataBuffer::writeData(const long long pos, const box_t &entrybox,
+                           const void *data, const H5::DataType &datatype,
+                           const box_t &datalayout,
+                           const box_t &databox) const {
+  assert(databox <= datalayout);
+  assert(databox <= entrybox);
+  if (databox.empty())
+    return;
+  H5::library_lock lock;
+  const auto typesize = m_datatype.getSize();
+  const hsize_t count = entrybox.size();
+
+  if (!m_have_dataset) {
+    // Collect the data in memory
+    assert(m_concatenation);
+    const size_t size = m_concatenation->size() * typesize;
+    if (m_data.size() < size)
+      m_data.resize(size);
+    copy_convert(&m_data[pos * typesize], count, entrybox, databox,
+                 m_datatype, data, datalayout.size(), datalayout, databox,
+                 datatype);
+    return;
+  }
+
+  // Write directly into the dataset
+  const hsize_t start = pos;
+  auto filespace = m_dataset.getSpace();
+  filespace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+  const auto memspace = H5::DataSpace(1, &count);
+  vector<char> buf(count * typesize);
+  if (!(databox == entrybox))
+    // Read the parts of the entry that are not overwritten
+    m_dataset.read(buf.data(), m_datatype, memspace, filespace);
+  copy_convert(buf.data(), count, entrybox, databox, m_datatype, data,
+               datalayout.size(), datalayout, databox, datatype);
+  m_dataset.write(buf.data(), m_datatype, memspace, filespace);
+}
+
+void DataBuffer::readData(const long long pos, const box_t &entrybox,
+                          void *data, const H5::DataType &datatype,
+                          const box_t &datalayout,
+                          const box_t &databox) const {
+  assert(m_have_dataset);
+  assert(databox <= datalayout);
+  assert(databox <= entrybox);
+  if (databox.empty())
+    return;
+  H5::library_lock lock;
+  const hsize_t count = entrybox.size();
+  const hsize_t start = pos;
+  auto filespace = m_dataset.getSpace();
+  filespace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+  const auto memspace = H5::DataSpace(1, &count);
+  if (databox == entrybox && datalayout == databox) {
+    m_dataset.read(data, datatype, memspace, filespace);
+    return;
+  }
+  // Read the whole entry, and repack it into the caller's layout. Convert
+  // in memory if possible, otherwise let HDF5 convert.
+  HyperSlab::elttype_t memelttype, fileelttype;
+  const bool convert = HyperSlab::get_elttype(datatype, memelttype) &&
+                       HyperSlab::get_elttype(m_datatype, fileelttype);
+  const auto readtype = convert ? m_datatype : datatype;
+  vector<char> buf(count * readtype.getSize());
+  m_dataset.read(buf.data(), readtype, memspace, filespace);
+  copy_convert(data, datalayout.size(), datalayout, databox, datatype,
+               buf.data(), count, entrybox, databox, readtype);
+}
+
 // DataBufferEntry
 
 bool DataBufferEntry::invariant() const {
-  assert(false);
-  return true;
+  return DataBlock::invariant() && bool(m_databuffer) && m_index >= 0 &&
+         m_pos >= 0;
 }
 
 DataBufferEntry::DataBufferEntry(const WriteOptions &write_options,
                                  const box_t &box, const H5::DataType &datatype,
                                  const shared_ptr<DataBuffer> &databuffer)
     : DataBlock(write_options, box), m_databuffer(databuffer) {
-  assert(datatype == databuffer->datatype());
-  m_linearization = databuffer->concatenation()->push_back(box);
+#ifndef NDEBUG
+  {
+    H5::library_lock lock;
+    assert(datatype == databuffer->datatype());
+  }
+#endif
+  // All entries need to be defined before the buffer is written
+  assert(!databuffer->have_dataset());
+  m_index = databuffer->concatenation()->count();
+  m_pos = databuffer->concatenation()->push_back(box)->pos();
+  assert(invariant());
+}
+
+DataBufferEntry::DataBufferEntry(const WriteOptions &write_options,
+                                 const box_t &box,
+                                 const shared_ptr<DataBuffer> &databuffer,
+                                 long long index)
+    : DataBlock(write_options, box), m_databuffer(databuffer), m_index(index),
+      m_pos(databuffer->offset(index)) {
+  assert(invariant());
+}
+
+namespace {
+// Each entry refers to its buffer, and to its index in the buffer's offset
+// table, with a single attribute
+struct buffer_entry_t {
+  hobj_ref_t buffer;
+  long long index;
+};
+H5::CompType buffer_entry_type() {
+  H5::CompType type(sizeof(buffer_entry_t));
+  type.insertMember("buffer", HOFFSET(buffer_entry_t, buffer),
+                    H5::PredType::STD_REF_OBJ);
+  type.insertMember("index", HOFFSET(buffer_entry_t, index),
+                    H5::PredType::NATIVE_LLONG);
+  return type;
 }
+} // namespace
 
 shared_ptr<DataBufferEntry> DataBufferEntry::read(const H5::Group &group,
                                                   const string &entry,
                                                   const box_t &box) {
+  H5::library_lock lock;
+  if (group.attrExists(entry + "_bufferentry")) {
+    // entry is stored in a buffer
+    const auto type = buffer_entry_type();
+    buffer_entry_t bufferentry;
+    group.openAttribute(entry + "_bufferentry").read(type, &bufferentry);
+    return make_shared<DataBufferEntry>(
+        WriteOptions(), box, DataBuffer::get(group, bufferentry.buffer),
+        bufferentry.index);
+  }
   return nullptr;
 }
 
@@ -802,22 +2173,25 @@ DataBufferEntry::read_asdf(const shared_ptr<ASDF::reader_state> &rs,
 
 ostream &DataBufferEntry::output(ostream &os) const {
   using namespace Output;
+  H5::library_lock lock;
   auto cls = datatype().getClass();
   auto clsname = H5::className(cls);
   auto typesize = datatype().getSize();
-  // assert(dataspace().isSimple());
-  // int dim = dataspace().getSimpleExtentNdims();
-  // vector<hsize_t> size(dim);
-  // dataspace().getSimpleExtentDims(size.data());
-  // reverse(size);
   os << "DataBufferEntry: type=" << clsname << "(" << (8 * typesize)
-     << " bit) box=" << m_linearization->box()
-     << " pos=" << m_linearization->pos();
+     << " bit) box=" << box() << " pos=" << pos();
   return os;
 }
 
 void DataBufferEntry::write(const H5::Group &group, const string &entry) const {
-  m_databuffer->write(group, entry);
+  H5::library_lock lock;
+  // The first entry that is written also writes the buffer, unless the
+  // buffer has already been written elsewhere
+  if (!m_databuffer->have_dataset())
+    m_databuffer->write(group, entry + "_buffer");
+  const auto type = buffer_entry_type();
+  const buffer_entry_t bufferentry{m_databuffer->reference(), index()};
+  group.createAttribute(entry + "_bufferentry", type, H5::DataSpace())
+      .write(type, &bufferentry);
 }
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
@@ -826,6 +2200,228 @@ void DataBufferEntry::write(ASDF::writer &w, const string &entry) const {
 }
 #endif
 
+// DataSetCache
+
+DataSetCache::settings_t &DataSetCache::settings() {
+  static settings_t settings{16, size_t(16) << 20, size_t(256) << 20};
+  return settings;
+}
+
+namespace {
+// The chunk cache bytes reserved by all DataSetCaches
+mutex chunk_cache_mutex;
+size_t chunk_cache_bytes_used = 0;
+
+// Reserve up to nbytes from the global budget; returns the reserved size, or
+// 0 if not even HDF5's default chunk cache size is left
+size_t reserve_chunk_cache(size_t nbytes) {
+  const size_t default_bytes = size_t(1) << 20;
+  lock_guard<mutex> lock(chunk_cache_mutex);
+  const size_t budget = DataSetCache::settings().max_total_chunk_cache_bytes;
+  const size_t avail =
+      budget > chunk_cache_bytes_used ? budget - chunk_cache_bytes_used : 0;
+  nbytes = min(nbytes, avail);
+  if (nbytes <= default_bytes)
+    return 0;
+  chunk_cache_bytes_used += nbytes;
+  return nbytes;
+}
+
+void release_chunk_cache(size_t nbytes) {
+  lock_guard<mutex> lock(chunk_cache_mutex);
+  assert(nbytes <= chunk_cache_bytes_used);
+  chunk_cache_bytes_used -= nbytes;
+}
+} // namespace
+
+size_t DataSetCache::total_chunk_cache_bytes() {
+  lock_guard<mutex> lock(chunk_cache_mutex);
+  return chunk_cache_bytes_used;
+}
+
+shared_ptr<DataSetCache> DataSetCache::get(const H5::Group &group) {
+  H5::library_lock library_lock;
+  // HDF5 numbers the files that are open; the number is not reused while
+  // the file is open
+  H5O_info_t info;
+  herr_t herr = H5Oget_info(group.getId(), &info);
+  assert(!herr);
+  static mutex registry_mutex;
+  static map<unsigned long, weak_ptr<DataSetCache>> registry;
+  lock_guard<mutex> lock(registry_mutex);
+  auto cache = registry[info.fileno].lock();
+  if (!cache) {
+    // Forget the caches of files that have been closed
+    for (auto it = registry.begin(); it != registry.end();)
+      it = it->second.expired() ? registry.erase(it) : next(it);
+    cache = make_shared<DataSetCache>();
+    registry[info.fileno] = cache;
+  }
+  return cache;
+}
+
+namespace {
+hsize_t next_prime(hsize_t n) {
+  for (;; ++n) {
+    bool is_prime = n >= 2;
+    for (hsize_t d = 2; is_prime && d * d <= n; ++d)
+      is_prime = n % d != 0;
+    if (is_prime)
+      return n;
+  }
+}
+
+// Size the chunk cache for reading a dataset. The default of 1 MByte is too
+// small to hold the chunks that neighbouring reads need. Block and slice
+// reads need a layer of chunks (all chunks with the same index in the
+// slowest direction), point reads may need all chunks. The size is reserved
+// from the global budget; returns false if the default should be used.
+bool choose_chunk_cache(const H5::DataSet &dataset,
+                        const H5::DataSpace &dataspace,
+                        const WriteOptions::access_pattern_t access_pattern,
+                        H5::DSetAccPropList &dapl, size_t &reserved) {
+  const auto proplist = dataset.getCreatePlist();
+  if (proplist.getLayout() != H5D_CHUNKED)
+    return false;
+  const int dim = dataspace.getSimpleExtentNdims();
+  vector<hsize_t> dims(dim), chunkdims(dim);
+  dataspace.getSimpleExtentDims(dims.data());
+  proplist.getChunk(dim, chunkdims.data());
+  hsize_t chunk_bytes = dataset.getDataType().getSize();
+  hsize_t nchunks = 1;
+  // HDF5 dimensions are in C order; the slowest direction comes first
+  const int d0 =
+      access_pattern == WriteOptions::access_pattern_t::point ? 0 : 1;
+  for (int d = 0; d < dim; ++d) {
+    chunk_bytes *= chunkdims[d];
+    if (d >= d0)
+      nchunks *= (dims[d] + chunkdims[d] - 1) / chunkdims[d];
+  }
+  const auto &settings = DataSetCache::settings();
+  hsize_t nbytes = min(nchunks * chunk_bytes,
+                       hsize_t(settings.max_chunk_cache_bytes));
+  // HDF5 does not cache chunks that are larger than the cache
+  nbytes = max(nbytes, chunk_bytes);
+  reserved = reserve_chunk_cache(nbytes);
+  if (reserved < chunk_bytes) {
+    if (reserved > 0)
+      release_chunk_cache(reserved);
+    reserved = 0;
+    return false;
+  }
+  nbytes = reserved;
+  // HDF5 recommends a prime number of slots, about 100 times the number of
+  // chunks that fit into the cache
+  const hsize_t nslots =
+      next_prime(min(hsize_t(1) << 20, max(hsize_t(521),
+                                           100 * (nbytes / chunk_bytes))));
+  dapl.setChunkCache(nslots, nbytes, 0.75);
+  return true;
+}
+} // namespace
+
+DataSetCache::entry_t
+DataSetCache::open(const H5::Group &group, const string &name,
+                   const WriteOptions::access_pattern_t access_pattern) const {
+  // The library lock is always acquired before m_mutex
+  H5::library_lock library_lock;
+  string path = group.getObjName();
+  if (path.empty() || path.back() != '/')
+    path += '/';
+  path += name;
+  const key_t key(path, access_pattern);
+  lock_guard<mutex> lock(m_mutex);
+  const auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return m_entries.front().second.entry;
+  }
+  cached_t cached;
+  auto &entry = cached.entry;
+  entry.dataset = group.openDataSet(name);
+  entry.dataspace = entry.dataset.getSpace();
+  H5::DSetAccPropList dapl;
+  cached.chunk_cache_bytes = 0;
+  if (choose_chunk_cache(entry.dataset, entry.dataspace, access_pattern, dapl,
+                         cached.chunk_cache_bytes)) {
+    entry.dataset.close();
+    try {
+      entry.dataset = group.openDataSet(name, dapl);
+    } catch (...) {
+      release_chunk_cache(cached.chunk_cache_bytes);
+      throw;
+    }
+  }
+  entry.datatype = entry.dataset.getDataType();
+  m_entries.emplace_front(key, cached);
+  m_index[key] = m_entries.begin();
+  while (m_entries.size() > max(size_t(1), settings().max_datasets))
+    evict_last();
+  return entry;
+}
+
+void DataSetCache::evict_last() const {
+  release_chunk_cache(m_entries.back().second.chunk_cache_bytes);
+  m_index.erase(m_entries.back().first);
+  m_entries.pop_back();
+}
+
+size_t DataSetCache::size() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void DataSetCache::clear() const {
+  H5::library_lock library_lock;
+  lock_guard<mutex> lock(m_mutex);
+  while (!m_entries.empty())
+    evict_last();
+}
+
+// MappedData
+
+namespace {
+// Map a dataset that holds the data of `box`. Data written via another
+// handle to the same file need to be flushed first.
+MappedData map_dataset(const H5::DataSet &dataset, const H5::DataType &filetype,
+                       const box_t &box) {
+#ifdef SIMULATIONIO_HAVE_MMAP
+  // Datasets that are chunked, compressed, stored externally, or not yet
+  // allocated have no offset
+  const haddr_t offset = H5Dget_offset(dataset.getId());
+  if (offset == HADDR_UNDEF)
+    return MappedData();
+  HyperSlab::elttype_t elttype;
+  if (!HyperSlab::get_elttype(filetype, elttype))
+    return MappedData();
+  const size_t nbytes = box.size() * filetype.getSize();
+  assert(dataset.getStorageSize() == nbytes);
+  if (nbytes == 0)
+    return MappedData();
+  // mmap requires the file offset to be a multiple of the page size
+  const off_t pagesize = sysconf(_SC_PAGESIZE);
+  const off_t mapoffset = offset / pagesize * pagesize;
+  const size_t mapbytes = nbytes + (offset - mapoffset);
+  const string filename = dataset.getFileName();
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return MappedData();
+  void *const addr =
+      mmap(nullptr, mapbytes, PROT_READ, MAP_SHARED, fd, mapoffset);
+  // The mapping remains valid after the file is closed
+  close(fd);
+  if (addr == MAP_FAILED)
+    return MappedData();
+  const shared_ptr<const void> mapping(
+      addr, [mapbytes](const void *addr) { munmap((void *)addr, mapbytes); });
+  return MappedData(mapping, (const char *)addr + (offset - mapoffset),
+                    filetype, box);
+#else
+  return MappedData();
+#endif
+}
+} // namespace
+
 // CopyObj
 
 bool CopyObj::invariant() const {
@@ -842,23 +2438,17 @@ shared_ptr<CopyObj> CopyObj::read(const H5::Group &group, const string &entry,
   auto exists = H5Lexists(group.getLocId(), entry.c_str(), lapl);
   assert(exists >= 0);
   if (exists) {
-// entry is a link
-#if 0
-    // Check whether it is an external link
+    // entry is a link
+    // Check whether it is an external link. These are resolved as HDF5 does,
+    // relative to the linking file.
     bool have_extlink;
     string filename, objname;
     H5::readExternalLink(group, entry, have_extlink, filename, objname);
-    if (!have_extlink) {
-      // H5O_info_t info;
-      // herr_t herr =
-      //     H5Oget_info_by_name(group.getLocId(), entry.c_str(), &info, lapl);
-      // assert(!herr);
-      // assert(info.type == H5O_TYPE_DATASET);
-      return make_shared<CopyObj>(WriteOptions(), box, group, entry);
-    }
-#else
+    if (have_extlink)
+      return make_shared<CopyObj>(
+          WriteOptions(), box, group, entry,
+          H5::resolveExternalLink(group.getFileName(), filename), objname);
     return make_shared<CopyObj>(WriteOptions(), box, group, entry);
-#endif
   }
   return nullptr;
 }
@@ -871,6 +2461,15 @@ shared_ptr<CopyObj> CopyObj::read_asdf(const shared_ptr<ASDF::reader_state> &rs,
 }
 #endif
 
+void CopyObj::closeHDF5() const {
+  if (m_group.getId() < 0 && !m_cache)
+    return;
+  H5::library_lock lock;
+  m_group = H5::Group();
+  // This closes the datasets if no other CopyObj of this file uses them
+  m_cache.reset();
+}
+
 ostream &CopyObj::output(ostream &os) const {
   return os << "CopyObj: "
             << "???"
@@ -1012,40 +2611,285 @@ void CopyObj::readData(void *data, const H5::DataType &datatype,
     assert(!databox.empty()); // HDF5 cannot handle an empty scalar box
   assert(databox <= datalayout);
   assert(databox <= box());
-  auto dataset = group().openDataSet(name());
-  auto dataspace = dataset.getSpace();
-  int ndims = dataspace.getSimpleExtentNdims();
-  assert(ndims == rank());
-  vector<hsize_t> dims(rank());
-  dataspace.getSimpleExtentDims(dims.data());
-  reverse(dims);
-  assert(all(point_t(dims) == shape()));
+  H5::library_lock lock;
+  const auto entry = open_dataset();
+  read_dataset(entry.dataset, entry.dataspace, entry.datatype, data, datatype,
+               datalayout, databox);
+}
+
+DataSetCache::entry_t CopyObj::open_dataset() const {
+  H5::library_lock lock;
+  if (is_extlink()) {
+    const auto file = H5FileCache::get().open(extfilename());
+    return file.datasets->open(file.file.openGroup("/"), extobjname(),
+                               access_pattern());
+  }
+  // Keep the dataset open (and its chunks cached) for the next read
+  if (!m_cache)
+    m_cache = DataSetCache::get(group());
+  return m_cache->open(group(), name(), access_pattern());
+}
+
+void DataBlock::read_dataset(const H5::DataSet &dataset,
+                             const H5::DataSpace &dataspace,
+                             const H5::DataType &filetype, void *data,
+                             const H5::DataType &datatype,
+                             const box_t &datalayout,
+                             const box_t &databox) const {
+  HyperSlab::elttype_t memelttype, fileelttype;
+  if (!databox.empty() && !(datatype == filetype) &&
+      HyperSlab::get_elttype(datatype, memelttype) &&
+      HyperSlab::get_elttype(filetype, fileelttype)) {
+    // Read without conversion, then convert while copying into the
+    // caller's layout
+    vector<char> buf(databox.size() * filetype.getSize());
+    H5::DataSpace memspace, filespace;
+    construct_spaces(databox, databox, dataspace, memspace, filespace);
+    dataset.read(buf.data(), filetype, memspace, filespace);
+    HyperSlab::copy(data, datalayout.size(), datalayout, databox, memelttype,
+                    buf.data(), databox.size(), databox, databox, fileelttype);
+    return;
+  }
   H5::DataSpace memspace, filespace;
   construct_spaces(datalayout, databox, dataspace, memspace, filespace);
   dataset.read(data, datatype, memspace, filespace);
 }
 
+MappedData CopyObj::mapData() const {
+  H5::library_lock lock;
+  const auto entry = open_dataset();
+  return map_dataset(entry.dataset, entry.datatype, box());
+}
+
+namespace {
+// Batched reads whose union covers less than this fraction of its bounding
+// box select individual points instead, as long as there are at most
+// `max_points` of them. Larger sparse batches are read box by box.
+const long long min_density_inv = 4;
+const long long max_points = 1 << 16;
+} // namespace
+
+void DataBlock::readData(const vector<read_request_t> &requests) {
+  H5::library_lock lock;
+  // Group the CopyObj requests by dataset, preserving their order
+  struct batch_t {
+    DataSetCache::entry_t entry;
+    vector<const read_request_t *> requests;
+    vector<const CopyObj *> copyobjs;
+  };
+  vector<batch_t> batches;
+  map<hid_t, size_t> batch_index;
+  for (const auto &request : requests) {
+    const auto copyobj = dynamic_cast<const CopyObj *>(request.datablock.get());
+    if (!copyobj) {
+      // Generate data ranges directly in the caller's layout
+      if (const auto datarange =
+              dynamic_cast<const DataRange *>(request.datablock.get()))
+        datarange->readData(request.data, request.datatype, request.datalayout,
+                            request.databox);
+      else if (const auto extlink =
+                   dynamic_cast<const ExtLink *>(request.datablock.get()))
+        extlink->readData(request.data, request.datatype, request.datalayout,
+                          request.databox);
+      else if (const auto databufferentry =
+                   dynamic_cast<const DataBufferEntry *>(
+                       request.datablock.get()))
+        databufferentry->readData(request.data, request.datatype,
+                                  request.datalayout, request.databox);
+      else
+        throw invalid_argument(
+            "DataBlock::readData: data block type cannot be read");
+      continue;
+    }
+    if (copyobj->rank() == 0) {
+      copyobj->readData(request.data, request.datatype, request.datalayout,
+                        request.databox);
+      continue;
+    }
+    assert(request.databox <= request.datalayout);
+    assert(request.databox <= copyobj->box());
+    if (request.databox.empty())
+      continue;
+    const auto entry = copyobj->open_dataset();
+    const auto &filetype = entry.datatype;
+    HyperSlab::elttype_t memelttype, fileelttype;
+    if (!(request.datatype == filetype) &&
+        !(HyperSlab::get_elttype(request.datatype, memelttype) &&
+          HyperSlab::get_elttype(filetype, fileelttype))) {
+      // Let HDF5 convert
+      copyobj->readData(request.data, request.datatype, request.datalayout,
+                        request.databox);
+      continue;
+    }
+    const auto iter = batch_index.find(entry.dataset.getId());
+    if (iter != batch_index.end()) {
+      batches.at(iter->second).requests.push_back(&request);
+      batches.at(iter->second).copyobjs.push_back(copyobj);
+    } else {
+      batch_index[entry.dataset.getId()] = batches.size();
+      batches.push_back({entry, {&request}, {copyobj}});
+    }
+  }
+
+  // Copy from a buffer holding data in the file type into the caller's
+  // layout, converting if necessary
+  const auto copy_out = [](const read_request_t &request,
+                           const H5::DataType &filetype, const void *buf,
+                           const box_t &buflayout, const box_t &bufbox) {
+    if (request.datatype == filetype) {
+      HyperSlab::copy(request.data, request.datalayout.size(),
+                      request.datalayout, request.databox, buf,
+                      buflayout.size(), buflayout, bufbox, filetype.getSize());
+    } else {
+      HyperSlab::elttype_t memelttype, fileelttype;
+      HyperSlab::get_elttype(request.datatype, memelttype);
+      HyperSlab::get_elttype(filetype, fileelttype);
+      HyperSlab::copy(request.data, request.datalayout.size(),
+                      request.datalayout, request.databox, memelttype, buf,
+                      buflayout.size(), buflayout, bufbox, fileelttype);
+    }
+  };
+
+  for (const auto &batch : batches) {
+    const auto &dataset = batch.entry.dataset;
+    const auto &filetype = batch.entry.datatype;
+    const size_t typesize = filetype.getSize();
+    // Boxes in file coordinates
+    vector<box_t> fileboxes;
+    long long npoints = 0;
+    for (size_t n = 0; n < batch.requests.size(); ++n) {
+      const auto request = batch.requests[n];
+      const auto &copyobj = *batch.copyobjs[n];
+      const box_t filebox(request->databox.lower() - copyobj.box().lower(),
+                          request->databox.upper() - copyobj.box().lower());
+      fileboxes.push_back(filebox);
+      npoints += filebox.size();
+    }
+    box_t bbox = fileboxes.front();
+    for (const auto &filebox : fileboxes)
+      bbox = bbox.bounding_box(filebox);
+    const int dim = bbox.rank();
+
+    if (batch.requests.size() == 1 ||
+        (bbox.size() > min_density_inv * npoints && npoints > max_points)) {
+      for (size_t n = 0; n < batch.requests.size(); ++n) {
+        const auto request = batch.requests[n];
+        batch.copyobjs[n]->readData(request->data, request->datatype,
+                                    request->datalayout, request->databox);
+      }
+      continue;
+    }
+
+    H5::DataSpace filespace;
+    filespace.copy(batch.entry.dataspace);
+    if (bbox.size() <= min_density_inv * npoints) {
+      // Read the union of the boxes into a buffer covering their bounding
+      // box. Memory and file selections have the same shape, so that HDF5
+      // places each element at its own position in the buffer.
+      vector<char> buf(bbox.size() * typesize);
+      H5::DataSpace memspace(dim,
+                             reversed(vector<hsize_t>(bbox.shape())).data());
+      for (size_t n = 0; n < fileboxes.size(); ++n) {
+        const auto op = n == 0 ? H5S_SELECT_SET : H5S_SELECT_OR;
+        const auto count = reversed(vector<hsize_t>(fileboxes[n].shape()));
+        filespace.selectHyperslab(
+            op, count.data(),
+            reversed(vector<hsize_t>(fileboxes[n].lower())).data());
+        memspace.selectHyperslab(
+            op, count.data(),
+            reversed(vector<hsize_t>(fileboxes[n].lower() - bbox.lower()))
+                .data());
+      }
+      dataset.read(buf.data(), filetype, memspace, filespace);
+      for (size_t n = 0; n < fileboxes.size(); ++n)
+        copy_out(*batch.requests[n], filetype, buf.data(), bbox, fileboxes[n]);
+    } else {
+      // Select the points of all boxes in order; HDF5 reads point
+      // selections in the order in which the points are listed, so that
+      // each box ends up contiguous in the buffer
+      vector<char> buf(npoints * typesize);
+      vector<hsize_t> coords;
+      coords.reserve(npoints * dim);
+      for (const auto &filebox : fileboxes) {
+        point_t p = filebox.lower();
+        for (long long i = 0; i < filebox.size(); ++i) {
+          for (int d = dim - 1; d >= 0; --d)
+            coords.push_back(p[d]);
+          for (int d = 0; d < dim; ++d) {
+            if (++p[d] < filebox.upper()[d])
+              break;
+            p[d] = filebox.lower()[d];
+          }
+        }
+      }
+      filespace.selectElements(H5S_SELECT_SET, npoints, coords.data());
+      const hsize_t memdims = npoints;
+      H5::DataSpace memspace(1, &memdims);
+      dataset.read(buf.data(), filetype, memspace, filespace);
+      long long offset = 0;
+      for (size_t n = 0; n < fileboxes.size(); ++n) {
+        copy_out(*batch.requests[n], filetype,
+                 buf.data() + offset * typesize, fileboxes[n], fileboxes[n]);
+        offset += fileboxes[n].size();
+      }
+    }
+  }
+}
+
+// H5FileCache
+
+H5FileCache::settings_t &H5FileCache::settings() {
+  static settings_t settings{64};
+  return settings;
+}
+
+H5FileCache &H5FileCache::get() {
+  static H5FileCache cache;
+  return cache;
+}
+
+H5FileCache::entry_t H5FileCache::open(const string &filename0) const {
+  const auto filename = H5::canonicalFileName(filename0);
+  H5::library_lock library_lock;
+  lock_guard<mutex> lock(m_mutex);
+  const auto it = m_index.find(filename);
+  if (it != m_index.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return m_entries.front().second;
+  }
+  entry_t entry;
+  entry.file = H5::H5File(filename, H5F_ACC_RDONLY);
+  entry.datasets = DataSetCache::get(entry.file.openGroup("/"));
+  m_entries.emplace_front(filename, entry);
+  m_index[filename] = m_entries.begin();
+  // The file is closed when its datasets and the last handle to it are
+  // closed
+  while (m_entries.size() > max(size_t(1), settings().max_files)) {
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+  return entry;
+}
+
+size_t H5FileCache::size() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void H5FileCache::clear() const {
+  H5::library_lock library_lock;
+  lock_guard<mutex> lock(m_mutex);
+  m_index.clear();
+  m_entries.clear();
+}
+
 // ExtLink
 
 shared_ptr<ExtLink> ExtLink::read(const H5::Group &group, const string &entry,
                                   const box_t &box) {
-// Reading a dataset always produces a CopyObj
-#if 0
-  auto lapl = H5::take_hid(H5Pcreate(H5P_LINK_ACCESS));
-  assert(lapl.valid());
-  auto exists = H5Lexists(group.getLocId(), entry.c_str(), lapl);
-  assert(exists >= 0);
-  if (exists) {
-    // entry is a link
-    // Check whether it is an external link
-    bool have_extlink;
-    string filename, objname;
-    H5::readExternalLink(group, entry, have_extlink, filename, objname);
-    if (have_extlink) {
-      return make_shared<ExtLink>(box, filename, objname);
-    }
-  }
-#endif
+  // Reading a dataset always produces a CopyObj, so that it can be copied
+  // like any other dataset; CopyObjs reached via external links are read via
+  // the H5FileCache
   return nullptr;
 }
 
@@ -1065,6 +2909,28 @@ void ExtLink::write(const H5::Group &group, const string &entry) const {
   H5::createExternalLink(group, entry, filename(), objname());
 }
 
+MappedData ExtLink::mapData() const {
+  H5::library_lock lock;
+  const auto file = H5FileCache::get().open(filename());
+  const auto entry = file.datasets->open(file.file.openGroup("/"), objname(),
+                                         write_options.access_pattern);
+  return map_dataset(entry.dataset, entry.datatype, box());
+}
+
+void ExtLink::readData(void *data, const H5::DataType &datatype,
+                       const box_t &datalayout, const box_t &databox) const {
+  if (rank() == 0)
+    assert(!databox.empty()); // HDF5 cannot handle an empty scalar box
+  assert(databox <= datalayout);
+  assert(databox <= box());
+  H5::library_lock lock;
+  const auto file = H5FileCache::get().open(filename());
+  const auto entry = file.datasets->open(file.file.openGroup("/"), objname(),
+                                         write_options.access_pattern);
+  read_dataset(entry.dataset, entry.dataspace, entry.datatype, data, datatype,
+               datalayout, databox);
+}
+
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
 void ExtLink::write(ASDF::writer &w, const string &entry) const { assert(0); }
 #endif
@@ -1093,6 +2959,7 @@ ASDF::compression_t ASDFData::asdf_compression_method() const {
     switch (write_options.compression_method) {
     case WriteOptions::compression_method_t::bzip2:
       return ASDF::compression_t::bzip2;
+    case WriteOptions::compression_method_t::lz4:
     case WriteOptions::compression_method_t::szip:
     case WriteOptions::compression_method_t::zlib:
       return ASDF::compression_t::zlib;
@@ -1281,7 +3148,8 @@ void TileDBData::writeData(const tiledb_writer &w, const string &entry,
                            const void *data, tiledb_datatype_t datatype,
                            const box_t &datalayout,
                            const box_t &databox) const {
-  auto tilesize = choose_tilesize(box().shape(), tiledb_type_size(datatype));
+  auto tilesize =
+      write_options.chunk_shape(box().shape(), tiledb_type_size(datatype));
 
   tiledb::Domain domain(w.ctx());
   if (rank() == 0)
@@ -25,11 +25,16 @@
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
+#include <typeinfo>
 #include <utility>
 #include <vector>
 
@@ -134,11 +139,48 @@ public:
   norm_t &operator+=(T x) { return *this += norm_t(x); }
   norm_t operator+(T x) const { return *this + norm_t(x); }
 
-  norm_t(const std::vector<T> &xs) {
-    *this = norm_t();
-    for (auto x : xs)
-      *this += x;
+  // Accumulate many values at once. This does not construct a temporary
+  // norm per value, and keeps independent partial results in several lanes
+  // so that the compiler can vectorize the loop.
+  norm_t(const T *xs, int_type n) : norm_t() {
+    constexpr int nlanes = 8;
+    int_type zeros[nlanes];
+    value_type mins[nlanes], maxs[nlanes], sums[nlanes];
+    real_type sums_abs[nlanes], sums_abs_squared[nlanes];
+    for (int l = 0; l < nlanes; ++l) {
+      zeros[l] = 0;
+      mins[l] = detail::norm_traits<T>::min();
+      maxs[l] = detail::norm_traits<T>::max();
+      sums[l] = 0;
+      sums_abs[l] = 0;
+      sums_abs_squared[l] = 0;
+    }
+    const auto add = [&](int l, T x) {
+      const real_type a = std::abs(x);
+      zeros[l] += x == T(0);
+      mins[l] = detail::norm_traits<T>::min(mins[l], x);
+      maxs[l] = detail::norm_traits<T>::max(maxs[l], x);
+      sums[l] += x;
+      sums_abs[l] += a;
+      sums_abs_squared[l] += a * a;
+    };
+    int_type i = 0;
+    for (; i + nlanes <= n; i += nlanes)
+      for (int l = 0; l < nlanes; ++l)
+        add(l, xs[i + l]);
+    for (; i < n; ++i)
+      add(0, xs[i]);
+    m_count = n;
+    for (int l = 0; l < nlanes; ++l) {
+      m_zeros += zeros[l];
+      m_min = detail::norm_traits<T>::min(m_min, mins[l]);
+      m_max = detail::norm_traits<T>::max(m_max, maxs[l]);
+      m_sum += sums[l];
+      m_sum_abs += sums_abs[l];
+      m_sum_abs_squared += sums_abs_squared[l];
+    }
   }
+  norm_t(const std::vector<T> &xs) : norm_t(xs.data(), xs.size()) {}
 
   int_type count() const { return m_count; }
   int_type zeros() const { return m_zeros; }
@@ -168,10 +210,41 @@ public:
 // Hyperslabs
 
 namespace HyperSlab {
+// Settings for copying hyperslabs. Copies of more than `cutoff` bytes are
+// split along their outermost dimension into up to `nthreads` slabs that are
+// copied in parallel. Copies of more than `nontemporal_cutoff` bytes bypass
+// the cache when writing contiguous output, where the hardware supports this.
+struct copy_settings_t {
+  size_t cutoff;
+  int nthreads;
+  size_t nontemporal_cutoff;
+};
+copy_settings_t &copy_settings();
+// The number of threads a large copy may use: settings.nthreads, or 1 on
+// threads that are themselves workers of a parallel operation
+int copy_nthreads();
+// Make copies on this thread run serially while this object exists, so that
+// nested parallelism does not oversubscribe the machine
+class serial_copies {
+  bool m_was_serial;
+
+public:
+  serial_copies();
+  ~serial_copies();
+  serial_copies(const serial_copies &) = delete;
+  serial_copies &operator=(const serial_copies &) = delete;
+};
+
 ptrdiff_t layout2offset(ptrdiff_t offset, const point_t &strides,
                         const box_t &virtual_layout, const box_t &box);
 pair<ptrdiff_t, point_t> layout2strides(const box_t &layout, const box_t &box,
                                         size_t type_size);
+// Copy a strided hyperslab of any rank; strides and offsets are in bytes
+void copy(void *outptr0, ptrdiff_t outnbytes, ptrdiff_t outoffset,
+          const vector<ptrdiff_t> &outstrides, const void *inptr0,
+          ptrdiff_t innbytes, ptrdiff_t inoffset,
+          const vector<ptrdiff_t> &instrides, const vector<ptrdiff_t> &shape,
+          size_t type_size);
 void copy(void *const outptr0, ptrdiff_t outnbytes, ptrdiff_t outoffset,
           const point_t &outstrides, const void *inptr0, ptrdiff_t innbytes,
           ptrdiff_t inoffset, const point_t &instrides, const point_t &shape,
@@ -179,13 +252,246 @@ void copy(void *const outptr0, ptrdiff_t outnbytes, ptrdiff_t outoffset,
 void copy(void *outptr0, ptrdiff_t outnpoints, const box_t &outlayout,
           const box_t &outbox, const void *inptr0, ptrdiff_t innpoints,
           const box_t &inlayout, const box_t &inbox, size_t type_size);
+
+// Native numeric element types between which copies can convert. Converting
+// copies clamp out-of-range values to the output type, as HDF5 does, and map
+// NaN to zero when converting to an integer type.
+enum class elttype_t {
+  int8,
+  uint8,
+  int16,
+  uint16,
+  int32,
+  uint32,
+  int64,
+  uint64,
+  float32,
+  float64,
+  float_long,
+};
+inline elttype_t get_elttype(const char &) {
+  return std::is_signed<char>::value ? elttype_t::int8 : elttype_t::uint8;
+}
+inline elttype_t get_elttype(const signed char &) { return elttype_t::int8; }
+inline elttype_t get_elttype(const unsigned char &) { return elttype_t::uint8; }
+inline elttype_t get_elttype(const short &) { return elttype_t::int16; }
+inline elttype_t get_elttype(const unsigned short &) {
+  return elttype_t::uint16;
+}
+inline elttype_t get_elttype(const int &) { return elttype_t::int32; }
+inline elttype_t get_elttype(const unsigned int &) { return elttype_t::uint32; }
+inline elttype_t get_elttype(const long &) {
+  return sizeof(long) == 8 ? elttype_t::int64 : elttype_t::int32;
+}
+inline elttype_t get_elttype(const unsigned long &) {
+  return sizeof(unsigned long) == 8 ? elttype_t::uint64 : elttype_t::uint32;
+}
+inline elttype_t get_elttype(const long long &) { return elttype_t::int64; }
+inline elttype_t get_elttype(const unsigned long long &) {
+  return elttype_t::uint64;
+}
+inline elttype_t get_elttype(const float &) { return elttype_t::float32; }
+inline elttype_t get_elttype(const double &) { return elttype_t::float64; }
+inline elttype_t get_elttype(const long double &) {
+  return elttype_t::float_long;
+}
+size_t elttype_size(elttype_t elttype);
+#ifdef SIMULATIONIO_HAVE_HDF5
+// Find the element type corresponding to an HDF5 datatype; returns false if
+// there is none (e.g. for compound or non-native types)
+bool get_elttype(const H5::DataType &datatype, elttype_t &elttype);
+#endif
+
+// Copy a strided hyperslab, converting each element from intype to outtype
+void copy(void *outptr0, ptrdiff_t outnbytes, ptrdiff_t outoffset,
+          const vector<ptrdiff_t> &outstrides, elttype_t outtype,
+          const void *inptr0, ptrdiff_t innbytes, ptrdiff_t inoffset,
+          const vector<ptrdiff_t> &instrides, elttype_t intype,
+          const vector<ptrdiff_t> &shape);
+void copy(void *outptr0, ptrdiff_t outnpoints, const box_t &outlayout,
+          const box_t &outbox, elttype_t outtype, const void *inptr0,
+          ptrdiff_t innpoints, const box_t &inlayout, const box_t &inbox,
+          elttype_t intype);
+
+// Copy a hyperslab of type T, converting to type U, and add the norm of the
+// copied elements (before conversion) to `norm`. Each element is read only
+// once; the norm is calculated from a small buffer that stays in the cache.
+// Rows are distributed over threads as for the other copies.
+template <typename U, typename T>
+void copy(U *const outptr, const ptrdiff_t outnpoints, const box_t &outlayout,
+          const box_t &outbox, const T *const inptr, const ptrdiff_t innpoints,
+          const box_t &inlayout, const box_t &inbox, norm_t<T> &norm) {
+  const int rank = outlayout.rank();
+  assert(outbox.rank() == rank);
+  assert(inlayout.rank() == rank);
+  assert(inbox.rank() == rank);
+  assert(outlayout.size() <= outnpoints);
+  assert(inlayout.size() <= innpoints);
+  assert(all(inbox.shape() == outbox.shape()));
+  if (outbox.empty())
+    return;
+  // Strides in units of elements
+  const auto out_off_str = layout2strides(outlayout, outbox, 1);
+  const auto in_off_str = layout2strides(inlayout, inbox, 1);
+  const auto shape = outbox.shape();
+  // Rows extend along the fastest dimension
+  const ptrdiff_t ni = rank == 0 ? 1 : shape[0];
+  const ptrdiff_t outdi = rank == 0 ? 1 : out_off_str.second[0];
+  const ptrdiff_t indi = rank == 0 ? 1 : in_off_str.second[0];
+  const ptrdiff_t nrows = outbox.size() / ni;
+  const auto copy_rows = [&](const ptrdiff_t row0, const ptrdiff_t row1) {
+    norm_t<T> rows_norm;
+    constexpr ptrdiff_t nbuf = 256;
+    T buf[nbuf];
+    for (ptrdiff_t row = row0; row < row1; ++row) {
+      ptrdiff_t outpos = out_off_str.first, inpos = in_off_str.first;
+      ptrdiff_t idx = row;
+      for (int d = 1; d < rank; ++d) {
+        const ptrdiff_t i = idx % shape[d];
+        idx /= shape[d];
+        outpos += i * out_off_str.second[d];
+        inpos += i * in_off_str.second[d];
+      }
+      for (ptrdiff_t i0 = 0; i0 < ni; i0 += nbuf) {
+        const ptrdiff_t n = std::min(nbuf, ni - i0);
+        const T *const inrow = inptr + inpos + i0 * indi;
+        U *const outrow = outptr + outpos + i0 * outdi;
+        for (ptrdiff_t i = 0; i < n; ++i)
+          buf[i] = inrow[i * indi];
+        rows_norm += norm_t<T>(buf, n);
+        for (ptrdiff_t i = 0; i < n; ++i)
+          outrow[i * outdi] = static_cast<U>(buf[i]);
+      }
+    }
+    return rows_norm;
+  };
+  const auto &settings = copy_settings();
+  const int nthreads = size_t(outbox.size()) * sizeof(T) <= settings.cutoff
+                           ? 1
+                           : int(std::min(ptrdiff_t(copy_nthreads()), nrows));
+  std::vector<std::future<norm_t<T>>> slabs;
+  for (int t = 0; t < nthreads - 1; ++t)
+    slabs.push_back(std::async(std::launch::async, copy_rows,
+                               nrows * t / nthreads,
+                               nrows * (t + 1) / nthreads));
+  const auto last_norm = copy_rows(nrows * (nthreads - 1) / nthreads, nrows);
+  for (auto &slab : slabs)
+    norm += slab.get();
+  norm += last_norm;
+}
+
+namespace detail {
+template <typename T, bool = std::is_arithmetic<T>::value>
+struct convert_norm_copy {
+  static void copy(void *const outptr, const ptrdiff_t outnpoints,
+                   const box_t &outlayout, const box_t &outbox,
+                   const elttype_t outtype, const T *const inptr,
+                   const ptrdiff_t innpoints, const box_t &inlayout,
+                   const box_t &inbox, norm_t<T> &norm) {
+    switch (outtype) {
+    case elttype_t::int8:
+      HyperSlab::copy(static_cast<int8_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::uint8:
+      HyperSlab::copy(static_cast<uint8_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::int16:
+      HyperSlab::copy(static_cast<int16_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::uint16:
+      HyperSlab::copy(static_cast<uint16_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::int32:
+      HyperSlab::copy(static_cast<int32_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::uint32:
+      HyperSlab::copy(static_cast<uint32_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::int64:
+      HyperSlab::copy(static_cast<int64_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::uint64:
+      HyperSlab::copy(static_cast<uint64_t *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::float32:
+      HyperSlab::copy(static_cast<float *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::float64:
+      HyperSlab::copy(static_cast<double *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    case elttype_t::float_long:
+      HyperSlab::copy(static_cast<long double *>(outptr), outnpoints, outlayout,
+                      outbox, inptr, innpoints, inlayout, inbox, norm);
+      break;
+    default:
+      assert(0);
+    }
+  }
+};
+// Non-numeric types (e.g. complex numbers) have no element type
+template <typename T> struct convert_norm_copy<T, false> {
+  static void copy(void *, ptrdiff_t, const box_t &, const box_t &, elttype_t,
+                   const T *, ptrdiff_t, const box_t &, const box_t &,
+                   norm_t<T> &) {
+    assert(0);
+  }
+};
+} // namespace detail
+
+// Copy a hyperslab of type T, converting to the element type `outtype`, and
+// add the norm of the copied elements (before conversion) to `norm`
+template <typename T>
+void copy(void *const outptr, const ptrdiff_t outnpoints,
+          const box_t &outlayout, const box_t &outbox, const elttype_t outtype,
+          const T *const inptr, const ptrdiff_t innpoints,
+          const box_t &inlayout, const box_t &inbox, norm_t<T> &norm) {
+  detail::convert_norm_copy<T>::copy(outptr, outnpoints, outlayout, outbox,
+                                     outtype, inptr, innpoints, inlayout,
+                                     inbox, norm);
+}
 } // namespace HyperSlab
 
+// Calculate the norm of an array, splitting large arrays over threads as
+// HyperSlab copies do
+template <typename T> norm_t<T> parallel_norm(const T *xs, ptrdiff_t n) {
+  const auto &settings = HyperSlab::copy_settings();
+  const int nthreads =
+      size_t(n) * sizeof(T) <= settings.cutoff
+          ? 1
+          : int(std::min(ptrdiff_t(HyperSlab::copy_nthreads()), n));
+  std::vector<std::future<norm_t<T>>> parts;
+  for (int t = 0; t < nthreads - 1; ++t) {
+    const ptrdiff_t i0 = n * t / nthreads, i1 = n * (t + 1) / nthreads;
+    parts.push_back(std::async(std::launch::async, [=]() {
+      return norm_t<T>(xs + i0, i1 - i0);
+    }));
+  }
+  const ptrdiff_t i0 = n * (nthreads - 1) / nthreads;
+  const norm_t<T> last_norm(xs + i0, n - i0);
+  norm_t<T> norm;
+  for (auto &part : parts)
+    norm += part.get();
+  return norm += last_norm;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // Options for writing data, e.g. compression settings
 struct WriteOptions {
-  enum class compression_method_t { bzip2, szip, zlib };
+  // bzip2 compresses best, lz4 is fastest; szip works only for numeric
+  // types. Methods that are not available fall back to zlib. New methods
+  // are appended, so that existing values do not change.
+  enum class compression_method_t { bzip2, szip, zlib, lz4 };
 
   bool chunk;
   bool compress;
@@ -193,11 +499,34 @@ struct WriteOptions {
   int compression_level;
   bool shuffle;
   bool checksum;
+  // Filter (e.g. compress) chunks in parallel, and write them directly to
+  // the file, when a whole dataset is written at once
+  bool parallel_filters;
+
+  // How the data will be read back; this determines the chunk (or tile)
+  // shape
+  enum class access_pattern_t {
+    block, // whole blocks or large sub-boxes: compact chunks
+    slice, // slices normal to slice_dir: chunks are flat in this direction
+    point, // single points, e.g. time series: small chunks
+  };
+  access_pattern_t access_pattern;
+  // The direction normal to slices, -1 means the slowest direction
+  int slice_dir;
+  // The chunk size in bytes, e.g. the file system's stripe size; 0 chooses a
+  // default suitable for the access pattern
+  long long chunk_bytes;
 
   WriteOptions()
       : chunk(true), compress(true),
         compression_method(compression_method_t::zlib), compression_level(1),
-        shuffle(true), checksum(true) {}
+        shuffle(true), checksum(true), parallel_filters(false),
+        access_pattern(access_pattern_t::block), slice_dir(-1),
+        chunk_bytes(0) {}
+
+  // Choose the chunk shape for a dataset with the given shape and element
+  // size in bytes
+  point_t chunk_shape(const point_t &shape, long long type_size) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -259,6 +588,11 @@ protected:
                         const H5::DataSpace &dataspace, // file space
                         H5::DataSpace &memspace,
                         H5::DataSpace &filespace) const;
+  // Read a box from an open dataset holding this block
+  void read_dataset(const H5::DataSet &dataset, const H5::DataSpace &dataspace,
+                    const H5::DataType &filetype, void *data,
+                    const H5::DataType &datatype, const box_t &datalayout,
+                    const box_t &databox) const;
 #endif
 
 public:
@@ -277,9 +611,56 @@ public:
 #ifdef SIMULATIONIO_HAVE_TILEDB
   virtual void write(const tiledb_writer &w, const string &entry) const = 0;
 #endif
+#ifdef SIMULATIONIO_HAVE_HDF5
+  // Release the HDF5 objects (e.g. open datasets) this block holds, so that
+  // destroying it does not call HDF5. The block cannot be accessed via HDF5
+  // any more afterwards.
+  virtual void closeHDF5() const {}
+#endif
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+  // A request to read a box of a CopyObj, DataRange, ExtLink, or
+  // DataBufferEntry; the fields have the same meaning as the arguments of
+  // their readData
+  struct read_request_t {
+    shared_ptr<const DataBlock> datablock;
+    void *data;
+    H5::DataType datatype;
+    box_t datalayout;
+    box_t databox;
+  };
+  // Read several boxes, possibly from different datasets. All requests for
+  // the same dataset are combined into a single read of the union of their
+  // boxes. Data ranges are generated in place without allocating. Throws
+  // invalid_argument for blocks that cannot be read (e.g. DataSet).
+  static void readData(const vector<read_request_t> &requests);
+#endif
 };
 
-// A multi-linear range
+namespace detail {
+// Convert a value as the converting hyperslab copies do: clamp to the range
+// of an integer type, and map NaN to zero
+template <typename T>
+typename std::enable_if<!std::is_integral<T>::value, T>::type
+convert_value(double x) {
+  return T(x);
+}
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type
+convert_value(double x) {
+  if (std::isnan(x))
+    return T(0);
+  if (x <= double(std::numeric_limits<T>::lowest()))
+    return std::numeric_limits<T>::lowest();
+  if (x >= double(std::numeric_limits<T>::max()))
+    return std::numeric_limits<T>::max();
+  return T(x);
+}
+} // namespace detail
+
+// A multi-linear range, e.g. coordinates. The value at point p is
+// origin + sum_d delta[d] * (p[d] - box().lower()[d]). Reading generates the
+// values; no array is stored.
 class DataRange : public DataBlock {
   double m_origin;
   vector<double> m_delta;
@@ -317,14 +698,128 @@ public:
 #ifdef SIMULATIONIO_HAVE_TILEDB
   virtual void write(const tiledb_writer &w, const string &entry) const;
 #endif
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+  // The datatype must be a native numeric type
+  void readData(void *data, const H5::DataType &datatype,
+                const box_t &datalayout, const box_t &databox) const;
+#endif
+  template <typename T>
+  void readData(T *data, const box_t &datalayout, const box_t &databox) const {
+    assert(databox <= datalayout);
+    assert(databox <= box());
+    const int dim = rank();
+    if (dim == 0) {
+      if (!databox.empty())
+        data[0] = detail::convert_value<T>(m_origin);
+      return;
+    }
+    if (databox.empty())
+      return;
+    // Fill rows along the first (contiguous) direction; each row is a
+    // linear sequence that the compiler can vectorize
+    const point_t layout_lo = datalayout.lower(),
+                  layout_shape = datalayout.shape();
+    const point_t box_lo = box().lower();
+    const point_t lo = databox.lower(), hi = databox.upper();
+    const ptrdiff_t n0 = hi[0] - lo[0];
+    const double delta0 = m_delta[0];
+    point_t p = lo;
+    for (;;) {
+      ptrdiff_t offset = 0, stride = 1;
+      double base = m_origin;
+      for (int d = 0; d < dim; ++d) {
+        offset += stride * (p[d] - layout_lo[d]);
+        stride *= layout_shape[d];
+        base += m_delta[d] * (p[d] - box_lo[d]);
+      }
+      T *const row = data + offset;
+      for (ptrdiff_t i = 0; i < n0; ++i)
+        row[i] = detail::convert_value<T>(base + i * delta0);
+      int d = 1;
+      for (; d < dim; ++d) {
+        if (++p[d] < hi[d])
+          break;
+        p[d] = lo[d];
+      }
+      if (d == dim)
+        break;
+    }
+  }
+  template <typename T> vector<T> readData(const box_t &databox) const {
+    vector<T> data(databox.size());
+    readData(data.data(), databox, databox);
+    return data;
+  }
+  template <typename T> vector<T> readData() const {
+    return readData<T>(box());
+  }
 };
 
 #ifdef SIMULATIONIO_HAVE_HDF5
 
+// The element type of a dataset or of attached data. Native numeric C++
+// types are described by their HyperSlab element type, and other C++ types
+// by a function creating their HDF5 datatype, so that datasets can be
+// created and data attached without calling HDF5 (see
+// Project::writeHDF5Async). The HDF5 datatype is only created when needed.
+class element_type_t {
+  bool m_have_elttype;
+  HyperSlab::elttype_t m_elttype;
+  size_t m_size;
+  const std::type_info *m_cxxtype; // the C++ type, if known
+  function<H5::DataType()> m_make_datatype;
+  // A datatype that is neither a native numeric nor a known C++ type.
+  // Shared, so that copies do not call HDF5.
+  shared_ptr<const H5::DataType> m_datatype;
+
+  template <typename T> struct is_native {
+    static constexpr bool value =
+        std::is_floating_point<T>::value ||
+        (std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+         !std::is_same<T, wchar_t>::value &&
+         !std::is_same<T, char16_t>::value &&
+         !std::is_same<T, char32_t>::value);
+  };
+  template <typename T> void set_cxxtype(std::true_type) {
+    m_have_elttype = true;
+    m_elttype = HyperSlab::get_elttype(T{});
+  }
+  template <typename T> void set_cxxtype(std::false_type) {
+    m_make_datatype = []() { return H5::DataType(H5::getType(T{})); };
+  }
+
+public:
+  element_type_t() : m_have_elttype(false), m_size(0), m_cxxtype(nullptr) {}
+  // This calls HDF5
+  explicit element_type_t(const H5::DataType &datatype);
+  // This does not call HDF5
+  template <typename T> static element_type_t of() {
+    element_type_t type;
+    type.m_size = sizeof(T);
+    type.m_cxxtype = &typeid(T);
+    type.set_cxxtype<T>(std::integral_constant<bool, is_native<T>::value>());
+    return type;
+  }
+
+  bool valid() const { return m_size > 0; }
+  size_t size() const { return m_size; }
+  bool get_elttype(HyperSlab::elttype_t &elttype) const {
+    elttype = m_elttype;
+    return m_have_elttype;
+  }
+  // This calls HDF5 (unless both types are native numeric or C++ types)
+  bool operator==(const element_type_t &other) const;
+  bool operator!=(const element_type_t &other) const {
+    return !(*this == other);
+  }
+  // This calls HDF5
+  H5::DataType datatype() const;
+};
+
 // An HDF5 dataset
 class DataSet : public DataBlock {
-  H5::DataSpace m_dataspace;
-  H5::DataType m_datatype;
+  element_type_t m_datatype;
   mutable bool m_have_location;
   mutable H5::Group m_location_group;
   mutable string m_location_name;
@@ -333,38 +828,46 @@ class DataSet : public DataBlock {
 
   mutable bool m_have_attached_data;
   mutable vector<char> m_attached_data;
-  mutable H5::DataType m_memtype;
+  // Borrowed data (set instead of m_attached_data)
+  mutable const void *m_borrowed_data;
+  mutable shared_ptr<const void> m_borrowed_owner;
+  // Writes the norm of the attached data, if it was calculated
+  mutable function<void(const H5::DataSet &)> m_write_norm;
+  mutable element_type_t m_memtype;
   mutable box_t m_memlayout; // allocated memory
   mutable box_t m_membox;    // memory to be transferred
 
 public:
-  H5::DataSpace dataspace() const { return m_dataspace; }
-  H5::DataType datatype() const { return m_datatype; }
+  H5::DataSpace dataspace() const;
+  H5::DataType datatype() const { return m_datatype.datatype(); }
   bool have_dataset() const { return m_have_dataset; }
-  H5::DataSet dataset() const { return m_dataset; }
+  H5::DataSet dataset() const {
+    H5::library_lock lock;
+    return m_dataset;
+  }
 
   virtual bool invariant() const;
 
   DataSet(const WriteOptions &write_options, const box_t &box,
           const H5::DataType &datatype)
-      : DataBlock(write_options, box),
-        m_dataspace(
-            H5::DataSpace(rank(), reversed(vector<hsize_t>(shape())).data())),
-        m_datatype(datatype), m_have_location(false), m_have_dataset(false),
-        m_have_attached_data(false) {
+      : DataBlock(write_options, box), m_datatype(datatype),
+        m_have_location(false), m_have_dataset(false),
+        m_have_attached_data(false), m_borrowed_data(nullptr) {
     assert(invariant());
   }
+  // This does not call HDF5
   template <typename T>
   DataSet(T, const WriteOptions &write_options, const box_t &box)
-      : DataBlock(write_options, box),
-        m_dataspace(
-            H5::DataSpace(rank(), reversed(vector<hsize_t>(shape())).data())),
-        m_datatype(H5::getType(T{})), m_have_location(false),
-        m_have_dataset(false), m_have_attached_data(false) {
+      : DataBlock(write_options, box), m_datatype(element_type_t::of<T>()),
+        m_have_location(false), m_have_dataset(false),
+        m_have_attached_data(false), m_borrowed_data(nullptr) {
     assert(invariant());
   }
 
-  virtual ~DataSet() {}
+  DataSet(const DataSet &) = delete;
+  DataSet &operator=(const DataSet &) = delete;
+
+  virtual ~DataSet() { closeHDF5(); }
 
   static shared_ptr<DataSet> read(const H5::Group &group, const string &entry,
                                   const box_t &box);
@@ -384,9 +887,52 @@ public:
     assert(0);
   }
 #endif
+  virtual void closeHDF5() const;
 
 private:
+  // Copies data of a particular type, and accumulates their norm. Copies
+  // may run concurrently.
+  class norm_copier {
+  public:
+    virtual ~norm_copier() {}
+    virtual void copy(void *outptr, ptrdiff_t outnpoints,
+                      const box_t &outlayout, const box_t &outbox,
+                      const void *inptr, ptrdiff_t innpoints,
+                      const box_t &inlayout, const box_t &inbox) = 0;
+  };
+  template <typename T> class typed_norm_copier : public norm_copier {
+    std::mutex m_mutex;
+    norm_t<T> m_norm;
+
+  public:
+    virtual void copy(void *outptr, ptrdiff_t outnpoints,
+                      const box_t &outlayout, const box_t &outbox,
+                      const void *inptr, ptrdiff_t innpoints,
+                      const box_t &inlayout, const box_t &inbox) {
+      norm_t<T> norm;
+      HyperSlab::copy(static_cast<T *>(outptr), outnpoints, outlayout, outbox,
+                      static_cast<const T *>(inptr), innpoints, inlayout,
+                      inbox, norm);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_norm += norm;
+    }
+    const norm_t<T> &norm() const { return m_norm; }
+  };
+
   void create_dataset() const;
+  // Filter and write the chunks in parallel. If `norm` is given, the data
+  // are repacked with it, accumulating their norm.
+  bool write_chunks(const void *data, const box_t &datalayout,
+                    norm_copier *norm = nullptr) const;
+  // Returns whether the data were repacked with `norm`
+  bool write_data(const void *data, const element_type_t &datatype,
+                  const box_t &datalayout, const box_t &databox,
+                  norm_copier *norm) const;
+  void attach_data(const void *data, const element_type_t &datatype,
+                   const box_t &datalayout, const box_t &databox) const;
+  void attach_data(const void *data, const shared_ptr<const void> &owner,
+                   const element_type_t &datatype, const box_t &datalayout,
+                   const box_t &databox) const;
 
 public:
   void writeData(const void *data, const H5::DataType &datatype,
@@ -394,7 +940,7 @@ public:
   template <typename T>
   void writeData(const T *data, const box_t &datalayout,
                  const box_t &databox) const {
-    writeData(data, H5::getType(T{}), datalayout, databox);
+    write_data(data, element_type_t::of<T>(), datalayout, databox, nullptr);
   }
   template <typename T>
   void writeData(const T *data, const box_t &databox) const {
@@ -411,23 +957,21 @@ public:
     writeData(data.data(), databox, databox);
   }
   template <typename T> void writeData(const vector<T> &data) const {
-    writeData(data, box());
-
-    // TODO: Add function to add / update minimum and maximum; call it after
-    // copying
-    // TODO: Only update the attributes, do not set them (cache them!)
-    // auto minmaxit = std::minmax_element(data.begin(), data.end());
-    // H5::createAttribute(m_dataset, "minimum", *minmaxit.first);
-    // H5::createAttribute(m_dataset, "maximum", *minmaxit.second);
-    norm_t<T> norm(data);
-    H5::createAttribute(m_dataset, "num_zeros", norm.zeros());
-    H5::createAttribute(m_dataset, "sum", norm.sum());
-    H5::createAttribute(m_dataset, "minimum", norm.min());
-    H5::createAttribute(m_dataset, "maximum", norm.max());
-    H5::createAttribute(m_dataset, "sum_abs", norm.sum_abs());
-    H5::createAttribute(m_dataset, "sum_abs_squared", norm.sum_abs_squared());
+    assert(ptrdiff_t(data.size()) == box().size());
+    // The norm is calculated while the chunks are repacked for filtering
+    // (see WriteOptions::parallel_filters). HDF5 reads the data directly
+    // otherwise, and the norm needs a separate pass.
+    typed_norm_copier<T> norm;
+    const bool have_norm = write_data(data.data(), element_type_t::of<T>(),
+                                      box(), box(), &norm);
+    H5::library_lock lock;
+    if (have_norm)
+      write_norm(m_dataset, norm.norm());
+    else
+      write_norm(m_dataset, parallel_norm(data.data(), data.size()));
   }
 
+  // Attaching data via C++ types does not call HDF5
   void attachData(const vector<char> &data, const H5::DataType &datatype,
                   const box_t &datalayout, const box_t &databox) const;
   void attachData(vector<char> &&data, const H5::DataType &datatype,
@@ -437,7 +981,7 @@ public:
   template <typename T>
   void attachData(const T *data, const box_t &datalayout,
                   const box_t &databox) const {
-    attachData(data, H5::getType(T{}), datalayout, databox);
+    attach_data(data, element_type_t::of<T>(), datalayout, databox);
   }
   template <typename T>
   void attachData(const T *data, const box_t &databox) const {
@@ -453,29 +997,127 @@ public:
   void attachData(const vector<T> &data, const box_t &databox) const {
     attachData(data.data(), databox, databox);
   }
+  // Attach data for the whole dataset, and write their norm as attributes
+  // (as writeData does) when the dataset is written. The norm is calculated
+  // while the data are copied (and converted to the dataset's type).
+  template <typename T> void attachData(const vector<T> &data) const {
+    assert(ptrdiff_t(data.size()) == box().size());
+    const auto memtype = element_type_t::of<T>();
+    HyperSlab::elttype_t memelttype, fileelttype;
+    const bool same_type = memtype == m_datatype;
+    const bool convert = !same_type && memtype.get_elttype(memelttype) &&
+                         m_datatype.get_elttype(fileelttype);
+    norm_t<T> norm;
+    if (same_type || convert) {
+      // The copy is attached as borrowed data. It is not initialized, since
+      // the copy overwrites it completely.
+      const shared_ptr<char> buf(new char[data.size() * m_datatype.size()],
+                                 std::default_delete<char[]>());
+      if (same_type)
+        HyperSlab::copy(reinterpret_cast<T *>(buf.get()), data.size(), box(),
+                        box(), data.data(), data.size(), box(), box(), norm);
+      else
+        HyperSlab::copy(buf.get(), data.size(), box(), box(), fileelttype,
+                        data.data(), data.size(), box(), box(), norm);
+      attach_data(buf.get(), buf, m_datatype, box(), box());
+    } else {
+      // HDF5 converts when writing
+      attachData(data, box());
+      norm = parallel_norm(data.data(), data.size());
+    }
+    m_write_norm = [norm](const H5::DataSet &dataset) {
+      write_norm(dataset, norm);
+    };
+  }
+
+  // Attach data without copying them. The data are read from the caller's
+  // memory when the dataset is written, and are only repacked if they are
+  // not contiguous or need to be converted. `owner` is kept alive until
+  // then; a custom deleter can be used as completion callback.
+  void attachData(const void *data, const shared_ptr<const void> &owner,
+                  const H5::DataType &datatype, const box_t &datalayout,
+                  const box_t &databox) const;
+  template <typename T>
+  void attachData(const shared_ptr<vector<T>> &data, const box_t &datalayout,
+                  const box_t &databox) const {
+    assert(ptrdiff_t(data->size()) == datalayout.size());
+    attach_data(data->data(), data, element_type_t::of<T>(), datalayout,
+                databox);
+  }
+  template <typename T>
+  void attachData(const shared_ptr<vector<T>> &data,
+                  const box_t &databox) const {
+    attachData(data, databox, databox);
+  }
+
+private:
+  void write_borrowed_data() const;
+
+  template <typename T>
+  static void write_norm(const H5::DataSet &dataset, const norm_t<T> &norm) {
+    // TODO: Only update the attributes, do not set them (cache them!)
+    H5::createAttribute(dataset, "num_zeros", norm.zeros());
+    H5::createAttribute(dataset, "sum", norm.sum());
+    H5::createAttribute(dataset, "minimum", norm.min());
+    H5::createAttribute(dataset, "maximum", norm.max());
+    H5::createAttribute(dataset, "sum_abs", norm.sum_abs());
+    H5::createAttribute(dataset, "sum_abs_squared", norm.sum_abs_squared());
+  }
 };
 
 // An HDF5 dataset holding multiple concatenated blocks
 class DataBuffer {
-  H5::DataType m_datatype;
+  WriteOptions m_write_options;
+  mutable H5::DataType m_datatype;
   shared_ptr<dconcatenation_t> m_concatenation;
-  H5::DataSpace m_dataspace;
-  H5::DataSet m_dataset;
+  mutable bool m_have_dataset;
+  mutable H5::DataSpace m_dataspace;
+  mutable H5::DataSet m_dataset;
+  // A reference to the dataset, once it exists
+  mutable hobj_ref_t m_reference;
 
-  struct dbuffer_t {
-    virtual ~dbuffer_t() {}
-    static shared_ptr<dbuffer_t> make(const H5::DataType &datatype);
-  };
-  template <typename T> struct buffer_t : dbuffer_t { vector<T> vec; };
-  shared_ptr<dbuffer_t> m_buffer;
+  // Data collected before the dataset is written
+  mutable vector<char> m_data;
+  // The starting positions of the entries of a dataset that was read
+  vector<long long> m_offsets;
 
 public:
-  H5::DataType datatype() const { return m_datatype; }
+  H5::DataType datatype() const {
+    H5::library_lock lock;
+    return m_datatype;
+  }
   shared_ptr<dconcatenation_t> concatenation() const { return m_concatenation; }
+  bool have_dataset() const { return m_have_dataset; }
+  H5::DataSet dataset() const {
+    H5::library_lock lock;
+    return m_dataset;
+  }
+  hobj_ref_t reference() const {
+    assert(m_have_dataset);
+    return m_reference;
+  }
+  // The starting position of an entry of a dataset that was read
+  long long offset(long long index) const { return m_offsets.at(index); }
 
   DataBuffer() = delete;
-  DataBuffer(int dim, const H5::DataType &datatype);
-
+  DataBuffer(const WriteOptions &write_options, int dim,
+             const H5::DataType &datatype);
+  DataBuffer(int dim, const H5::DataType &datatype)
+      : DataBuffer(WriteOptions(), dim, datatype) {}
+  // Wrap an existing dataset for reading; its offset table is read as well
+  DataBuffer(const H5::DataSet &dataset);
+  DataBuffer(const DataBuffer &) = delete;
+  DataBuffer &operator=(const DataBuffer &) = delete;
+  virtual ~DataBuffer() { closeHDF5(); }
+  // The buffer a reference refers to. Entries that refer to the same
+  // dataset share one buffer (while it is in use), so that the dataset is
+  // opened and its offset table is read only once.
+  static shared_ptr<DataBuffer> get(const H5::Group &group,
+                                    const hobj_ref_t &reference);
+
+  // Write all entries into a single one-dimensional dataset, and their
+  // starting positions into the dataset `entry + "_offsets"`. Data that are
+  // written to entries afterwards go directly into the dataset.
   virtual void write(const H5::Group &group, const string &entry) const;
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
   virtual void write(ASDF::writer &w, const string &entry) const;
@@ -486,15 +1128,31 @@ public:
     assert(0);
   }
 #endif
+  // Release the HDF5 objects; see DataBlock::closeHDF5
+  void closeHDF5() const;
+
+  void writeData(long long pos, const box_t &entrybox, const void *data,
+                 const H5::DataType &datatype, const box_t &datalayout,
+                 const box_t &databox) const;
+  void readData(long long pos, const box_t &entrybox, void *data,
+                const H5::DataType &datatype, const box_t &datalayout,
+                const box_t &databox) const;
 };
 
 // A pointer into a DataBuffer
 class DataBufferEntry : public DataBlock {
   shared_ptr<DataBuffer> m_databuffer;
-  unique_ptr<dlinearization_t> m_linearization;
+  long long m_index; // in the buffer's offset table
+  long long m_pos;
 
 public:
-  H5::DataType datatype() const { return m_databuffer->datatype(); }
+  H5::DataType datatype() const {
+    H5::library_lock lock;
+    return m_databuffer->datatype();
+  }
+  shared_ptr<DataBuffer> databuffer() const { return m_databuffer; }
+  long long index() const { return m_index; }
+  long long pos() const { return m_pos; }
 
   virtual bool invariant() const;
 
@@ -503,6 +1161,9 @@ public:
   DataBufferEntry(const WriteOptions &write_options, const box_t &box,
                   const H5::DataType &datatype,
                   const shared_ptr<DataBuffer> &databuffer);
+  // An entry of a buffer that was read
+  DataBufferEntry(const WriteOptions &write_options, const box_t &box,
+                  const shared_ptr<DataBuffer> &databuffer, long long index);
 
   static shared_ptr<DataBufferEntry>
   read(const H5::Group &group, const string &entry, const box_t &box);
@@ -522,28 +1183,246 @@ public:
     assert(0);
   }
 #endif
+  virtual void closeHDF5() const { m_databuffer->closeHDF5(); }
+
+  void writeData(const void *data, const H5::DataType &datatype,
+                 const box_t &datalayout, const box_t &databox) const {
+    m_databuffer->writeData(m_pos, box(), data, datatype, datalayout, databox);
+  }
+  template <typename T>
+  void writeData(const T *data, const box_t &datalayout,
+                 const box_t &databox) const {
+    H5::library_lock lock;
+    writeData(data, H5::getType(T{}), datalayout, databox);
+  }
+  template <typename T>
+  void writeData(const vector<T> &data, const box_t &datalayout,
+                 const box_t &databox) const {
+    assert(ptrdiff_t(data.size()) == datalayout.size());
+    writeData(data.data(), datalayout, databox);
+  }
+  template <typename T> void writeData(const vector<T> &data) const {
+    writeData(data, box(), box());
+  }
+
+  void readData(void *data, const H5::DataType &datatype,
+                const box_t &datalayout, const box_t &databox) const {
+    m_databuffer->readData(m_pos, box(), data, datatype, datalayout, databox);
+  }
+  template <typename T>
+  void readData(T *data, const box_t &datalayout, const box_t &databox) const {
+    H5::library_lock lock;
+    readData(data, H5::getType(T{}), datalayout, databox);
+  }
+  template <typename T> vector<T> readData(const box_t &databox) const {
+    vector<T> data(databox.size());
+    readData(data.data(), databox, databox);
+    return data;
+  }
+  template <typename T> vector<T> readData() const {
+    return readData<T>(box());
+  }
+};
+
+// A least-recently-used cache of open HDF5 datasets that are read. All
+// datasets of a file (i.e. of a project) share one cache. The chunk cache of
+// each dataset is sized from its chunk shape and the access pattern, so that
+// repeated partial reads reuse decompressed chunks.
+//
+// The chunk caches stay resident while their datasets are open. Each is
+// limited to max_chunk_cache_bytes, and all chunk caches of all
+// DataSetCaches in the process (including those of the files in the
+// H5FileCache) together to max_total_chunk_cache_bytes. Datasets opened
+// beyond this budget use HDF5's default chunk cache of 1 MByte, so that at
+// most max_total_chunk_cache_bytes plus 1 MByte per other open dataset are
+// kept resident.
+class DataSetCache {
+public:
+  struct settings_t {
+    size_t max_datasets;          // number of datasets kept open per file
+    size_t max_chunk_cache_bytes; // chunk cache size limit per dataset
+    size_t max_total_chunk_cache_bytes; // limit for all datasets together
+  };
+  static settings_t &settings();
+  // The chunk cache bytes currently held by all open datasets
+  static size_t total_chunk_cache_bytes();
+
+  struct entry_t {
+    H5::DataSet dataset;
+    H5::DataSpace dataspace;
+    H5::DataType datatype;
+  };
+
+private:
+  struct cached_t {
+    entry_t entry;
+    size_t chunk_cache_bytes; // counted against the global budget
+  };
+  // Datasets are opened separately for each access pattern, since their
+  // chunk caches differ
+  typedef pair<string, WriteOptions::access_pattern_t> key_t;
+  mutable std::mutex m_mutex;
+  // Most recently used entries come first
+  mutable std::list<pair<key_t, cached_t>> m_entries;
+  mutable std::map<key_t, std::list<pair<key_t, cached_t>>::iterator>
+      m_index;
+
+  void evict_last() const;
+
+public:
+  DataSetCache() = default;
+  DataSetCache(const DataSetCache &) = delete;
+  DataSetCache &operator=(const DataSetCache &) = delete;
+  ~DataSetCache() { clear(); }
+
+  // The cache for the file containing a group
+  static shared_ptr<DataSetCache> get(const H5::Group &group);
+
+  entry_t open(const H5::Group &group, const string &name,
+               WriteOptions::access_pattern_t access_pattern) const;
+  size_t size() const;
+  void clear() const;
+};
+
+// A bounded pool of HDF5 files that are kept open for reading, e.g. the
+// targets of external links. When the pool is full, the least recently
+// used file is closed.
+class H5FileCache {
+public:
+  struct settings_t {
+    size_t max_files; // number of files kept open
+  };
+  static settings_t &settings();
+
+  struct entry_t {
+    H5::H5File file;
+    shared_ptr<DataSetCache> datasets; // the datasets open in this file
+  };
+
+private:
+  mutable std::mutex m_mutex;
+  // Most recently used entries come first
+  mutable std::list<pair<string, entry_t>> m_entries;
+  mutable std::map<string, std::list<pair<string, entry_t>>::iterator>
+      m_index;
+
+public:
+  H5FileCache() = default;
+  H5FileCache(const H5FileCache &) = delete;
+  H5FileCache &operator=(const H5FileCache &) = delete;
+  ~H5FileCache() { clear(); }
+
+  // The process-wide pool
+  static H5FileCache &get();
+
+  // Files are identified by their canonical name, so that a file is only
+  // opened once even if it is referred to by different relative names
+  entry_t open(const string &filename) const;
+  size_t size() const;
+  void clear() const;
+};
+
+// The data of a dataset, mapped read-only into memory without copying. The
+// data are laid out as `layout` (in our index order, the first direction is
+// fastest). Only uncompressed datasets with contiguous storage and a native
+// numeric type can be mapped; for others the view is not valid, and the
+// data need to be read instead.
+class MappedData {
+  shared_ptr<const void> m_mapping;
+  const void *m_data;
+  // Shared, so that copying a view does not call HDF5
+  shared_ptr<const H5::DataType> m_datatype;
+  box_t m_layout;
+
+public:
+  MappedData() : m_data(nullptr) {}
+  MappedData(const shared_ptr<const void> &mapping, const void *data,
+             const H5::DataType &datatype, const box_t &layout)
+      : m_mapping(mapping), m_data(data),
+        m_datatype(new H5::DataType(datatype),
+                   [](const H5::DataType *p) {
+                     H5::library_lock lock;
+                     delete p;
+                   }),
+        m_layout(layout) {}
+
+  bool valid() const { return m_data != nullptr; }
+  H5::DataType datatype() const {
+    H5::library_lock lock;
+    return m_datatype ? *m_datatype : H5::DataType();
+  }
+  box_t layout() const { return m_layout; }
+  const void *data() const { return m_data; }
+  template <typename T> const T *data() const {
+    assert(valid());
+    assert(datatype() == H5::getType(T{}));
+    return static_cast<const T *>(m_data);
+  }
 };
 
 // A copy of an existing HDF5 dataset
 class CopyObj : public DataBlock {
-  H5::Group m_group;
+  mutable H5::Group m_group;
   string m_name;
+  // The file and object name an external link refers to, if the dataset is
+  // reached via one. Such datasets are read via the H5FileCache.
+  string m_extfilename;
+  string m_extobjname;
+  // How the data will be read
+  WriteOptions::access_pattern_t m_access_pattern;
+  // Set when the dataset is first read
+  mutable shared_ptr<DataSetCache> m_cache;
 
 public:
-  H5::Group group() const { return m_group; }
+  H5::Group group() const {
+    H5::library_lock lock;
+    return m_group;
+  }
   string name() const { return m_name; }
+  bool is_extlink() const { return !m_extfilename.empty(); }
+  string extfilename() const { return m_extfilename; }
+  string extobjname() const { return m_extobjname; }
+  // How the data will be read, e.g. in slices; this sizes the dataset's
+  // chunk cache. Datasets read from a file default to reading blocks.
+  WriteOptions::access_pattern_t access_pattern() const {
+    return m_access_pattern;
+  }
+  void setAccessPattern(WriteOptions::access_pattern_t access_pattern) {
+    m_access_pattern = access_pattern;
+  }
 
   virtual bool invariant() const;
 
   CopyObj(const WriteOptions &write_options, const box_t &box,
           const H5::Group &group, const string &name)
-      : DataBlock(write_options, box), m_group(group), m_name(name) {}
+      : DataBlock(write_options, box), m_name(name),
+        m_access_pattern(write_options.access_pattern) {
+    H5::library_lock lock;
+    m_group = group;
+  }
+  // A dataset reached via an external link; `extfilename` should already be
+  // resolved (see H5::resolveExternalLink)
+  CopyObj(const WriteOptions &write_options, const box_t &box,
+          const H5::Group &group, const string &name,
+          const string &extfilename, const string &extobjname)
+      : DataBlock(write_options, box), m_name(name),
+        m_extfilename(extfilename), m_extobjname(extobjname),
+        m_access_pattern(write_options.access_pattern) {
+    H5::library_lock lock;
+    m_group = group;
+  }
   CopyObj(const WriteOptions &write_options, const box_t &box,
           const H5::H5File &file, const string &name)
-      : DataBlock(write_options, box), m_group(file.openGroup("/")),
-        m_name(name) {}
+      : DataBlock(write_options, box), m_name(name),
+        m_access_pattern(write_options.access_pattern) {
+    H5::library_lock lock;
+    m_group = file.openGroup("/");
+  }
 
-  virtual ~CopyObj() {}
+  CopyObj(const CopyObj &) = delete;
+  CopyObj &operator=(const CopyObj &) = delete;
+
+  virtual ~CopyObj() { closeHDF5(); }
 
   static shared_ptr<CopyObj> read(const H5::Group &group, const string &entry,
                                   const box_t &box);
@@ -560,11 +1439,13 @@ public:
 #ifdef SIMULATIONIO_HAVE_TILEDB
   virtual void write(const tiledb_writer &w, const string &entry) const;
 #endif
+  virtual void closeHDF5() const;
 
   void readData(void *data, const H5::DataType &datatype,
                 const box_t &datalayout, const box_t &databox) const;
   template <typename T>
   void readData(T *data, const box_t &datalayout, const box_t &databox) const {
+    H5::library_lock lock;
     readData(data, H5::getType(T{}), datalayout, databox);
   }
   template <typename T> vector<T> readData(const box_t &databox) const {
@@ -575,6 +1456,12 @@ public:
   template <typename T> vector<T> readData() const {
     return readData<T>(box());
   }
+  // Map the file into memory instead of reading
+  MappedData mapData() const;
+
+  // The dataset, kept open in the file's DataSetCache. Datasets reached via
+  // an external link are opened in the H5FileCache's pool of files.
+  DataSetCache::entry_t open_dataset() const;
 };
 
 // An external link to an HDF5 dataset
@@ -616,7 +1503,26 @@ public:
   }
 #endif
 
-  // TODO: implement readData
+  // The external file is opened via the H5FileCache; a relative file name is
+  // relative to the current directory. (External links that are read from a
+  // file become CopyObjs, which resolve them relative to the linking file.)
+  void readData(void *data, const H5::DataType &datatype,
+                const box_t &datalayout, const box_t &databox) const;
+  template <typename T>
+  void readData(T *data, const box_t &datalayout, const box_t &databox) const {
+    H5::library_lock lock;
+    readData(data, H5::getType(T{}), datalayout, databox);
+  }
+  template <typename T> vector<T> readData(const box_t &databox) const {
+    vector<T> data(databox.size());
+    readData(data.data(), databox, databox);
+    return data;
+  }
+  template <typename T> vector<T> readData() const {
+    return readData<T>(box());
+  }
+  // Map the file into memory instead of reading
+  MappedData mapData() const;
 };
 
 #endif // #ifdef SIMULATIONIO_HAVE_HDF5
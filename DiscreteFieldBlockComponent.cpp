@@ -191,6 +191,10 @@ shared_ptr<DataBufferEntry> DiscreteFieldBlockComponent::createDataBufferEntry(
 }
 #endif
 
+box_t DiscreteFieldBlockComponent::datablock_box() const {
+  return discretefieldblock()->discretizationblock()->box();
+}
+
 shared_ptr<DataRange>
 DiscreteFieldBlockComponent::createDataRange(const WriteOptions &write_options,
                                              double origin,
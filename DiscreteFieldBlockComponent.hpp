@@ -66,6 +66,9 @@ public:
   shared_ptr<DataSet> dataset() const {
     return dynamic_pointer_cast<DataSet>(m_datablock);
   }
+  shared_ptr<DataBufferEntry> databufferentry() const {
+    return dynamic_pointer_cast<DataBufferEntry>(m_datablock);
+  }
   shared_ptr<CopyObj> copyobj() const {
     return dynamic_pointer_cast<CopyObj>(m_datablock);
   }
@@ -140,6 +143,8 @@ private:
   void read(const shared_ptr<ASDF::reader_state> &rs, const YAML::Node &node,
             const shared_ptr<DiscreteFieldBlock> &discretefieldblock);
 #endif
+  // The box of the discretization block
+  box_t datablock_box() const;
 
 public:
   virtual ~DiscreteFieldBlockComponent() {}
@@ -178,9 +183,13 @@ public:
 #ifdef SIMULATIONIO_HAVE_HDF5
   shared_ptr<DataSet> createDataSet(const WriteOptions &write_options,
                                     const H5::DataType &type);
+  // This does not call HDF5
   template <typename T>
   shared_ptr<DataSet> createDataSet(const WriteOptions &write_options) {
-    return createDataSet(write_options, H5::getType(T{}));
+    assert(!m_datablock);
+    auto res = make_shared<DataSet>(T{}, write_options, datablock_box());
+    m_datablock = res;
+    return res;
   }
   shared_ptr<DataBufferEntry>
   createDataBufferEntry(const WriteOptions &write_options,
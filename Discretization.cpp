@@ -6,8 +6,244 @@
 #include "H5Helpers.hpp"
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
 namespace SimulationIO {
 
+////////////////////////////////////////////////////////////////////////////////
+
+// A bounding volume hierarchy over the (half-open) block boxes. Each
+// node covers a contiguous range of blocks; inner nodes split their
+// blocks at the median of the box centres along the longest extent.
+struct Discretization::BlockIndex {
+  static constexpr size_t leafsize = 8;
+
+  int rank;
+  // Blocks and their boxes, stored in leaf order
+  vector<shared_ptr<DiscretizationBlock>> blocks;
+  vector<long long> lower, upper;
+  struct node_t {
+    size_t begin, end;
+    size_t left, right; // 0 for leaves
+  };
+  vector<node_t> nodes;
+  vector<long long> node_lower, node_upper;
+
+  BlockIndex(int rank, const vector<shared_ptr<DiscretizationBlock>> &blocks0)
+      : rank(rank) {
+    size_t nblocks = blocks0.size();
+    vector<long long> lower0(nblocks * rank), upper0(nblocks * rank);
+    for (size_t i = 0; i < nblocks; ++i) {
+      const auto &box = blocks0[i]->box();
+      auto lo = box.lower(), hi = box.upper();
+      for (int d = 0; d < rank; ++d) {
+        lower0[i * rank + d] = lo[d];
+        upper0[i * rank + d] = hi[d];
+      }
+    }
+    vector<size_t> perm(nblocks);
+    for (size_t i = 0; i < nblocks; ++i)
+      perm[i] = i;
+    if (nblocks > 0)
+      build(0, nblocks, perm, lower0, upper0);
+    blocks.reserve(nblocks);
+    lower.reserve(nblocks * rank);
+    upper.reserve(nblocks * rank);
+    for (size_t i : perm) {
+      blocks.push_back(blocks0[i]);
+      lower.insert(lower.end(), lower0.data() + i * rank,
+                   lower0.data() + (i + 1) * rank);
+      upper.insert(upper.end(), upper0.data() + i * rank,
+                   upper0.data() + (i + 1) * rank);
+    }
+  }
+
+  size_t build(size_t begin, size_t end, vector<size_t> &perm,
+               const vector<long long> &lower0,
+               const vector<long long> &upper0) {
+    size_t n = nodes.size();
+    nodes.push_back({begin, end, 0, 0});
+    node_lower.resize((n + 1) * rank);
+    node_upper.resize((n + 1) * rank);
+    for (int d = 0; d < rank; ++d) {
+      long long lo = lower0[perm[begin] * rank + d];
+      long long hi = upper0[perm[begin] * rank + d];
+      for (size_t i = begin + 1; i < end; ++i) {
+        lo = std::min(lo, lower0[perm[i] * rank + d]);
+        hi = std::max(hi, upper0[perm[i] * rank + d]);
+      }
+      node_lower[n * rank + d] = lo;
+      node_upper[n * rank + d] = hi;
+    }
+    if (end - begin <= leafsize)
+      return n;
+    int dir = -1;
+    long long maxext = -1;
+    for (int d = 0; d < rank; ++d) {
+      long long ext = node_upper[n * rank + d] - node_lower[n * rank + d];
+      if (ext > maxext) {
+        dir = d;
+        maxext = ext;
+      }
+    }
+    size_t mid = begin + (end - begin) / 2;
+    if (dir >= 0)
+      std::nth_element(perm.begin() + begin, perm.begin() + mid,
+                       perm.begin() + end,
+                       [&](size_t i, size_t j) {
+                         return lower0[i * rank + dir] +
+                                    upper0[i * rank + dir] <
+                                lower0[j * rank + dir] + upper0[j * rank + dir];
+                       });
+    size_t left = build(begin, mid, perm, lower0, upper0);
+    size_t right = build(mid, end, perm, lower0, upper0);
+    nodes[n].left = left;
+    nodes[n].right = right;
+    return n;
+  }
+
+  static bool overlaps(int rank, const long long *lo0, const long long *hi0,
+                       const long long *lo1, const long long *hi1) {
+    for (int d = 0; d < rank; ++d)
+      if (!(lo0[d] < hi1[d] && lo1[d] < hi0[d]))
+        return false;
+    return true;
+  }
+
+  // Squared Euclidean distance between a point and a box
+  static double distance2(int rank, const long long *p, const long long *lo,
+                          const long long *hi) {
+    double r = 0;
+    for (int d = 0; d < rank; ++d) {
+      double x = 0;
+      if (p[d] < lo[d])
+        x = double(lo[d] - p[d]);
+      else if (p[d] >= hi[d])
+        x = double(p[d] - (hi[d] - 1));
+      r += x * x;
+    }
+    return r;
+  }
+
+  template <typename F>
+  void overlapping(const long long *lo, const long long *hi,
+                   const F &f) const {
+    if (nodes.empty())
+      return;
+    vector<size_t> stack{0};
+    while (!stack.empty()) {
+      size_t n = stack.back();
+      stack.pop_back();
+      const auto &node = nodes[n];
+      if (!overlaps(rank, node_lower.data() + n * rank,
+                    node_upper.data() + n * rank, lo, hi))
+        continue;
+      if (node.left == 0) {
+        for (size_t i = node.begin; i < node.end; ++i)
+          if (overlaps(rank, lower.data() + i * rank, upper.data() + i * rank,
+                       lo, hi))
+            f(blocks[i]);
+      } else {
+        stack.push_back(node.right);
+        stack.push_back(node.left);
+      }
+    }
+  }
+
+  shared_ptr<DiscretizationBlock> nearest(const long long *p) const {
+    if (nodes.empty())
+      return nullptr;
+    // Best-first search; the queue holds nodes ordered by their distance
+    typedef std::pair<double, size_t> item_t;
+    std::priority_queue<item_t, vector<item_t>, std::greater<item_t>> queue;
+    queue.push({distance2(rank, p, node_lower.data(), node_upper.data()), 0});
+    double best_dist = HUGE_VAL;
+    size_t best = 0;
+    while (!queue.empty() && queue.top().first < best_dist) {
+      size_t n = queue.top().second;
+      queue.pop();
+      const auto &node = nodes[n];
+      if (node.left == 0) {
+        for (size_t i = node.begin; i < node.end; ++i) {
+          double dist = distance2(rank, p, lower.data() + i * rank,
+                                  upper.data() + i * rank);
+          if (dist < best_dist) {
+            best_dist = dist;
+            best = i;
+          }
+        }
+      } else {
+        for (size_t c : {node.left, node.right})
+          queue.push({distance2(rank, p, node_lower.data() + c * rank,
+                                node_upper.data() + c * rank),
+                      c});
+      }
+    }
+    return blocks[best];
+  }
+};
+
+shared_ptr<const Discretization::BlockIndex>
+Discretization::blockindex() const {
+  std::lock_guard<std::mutex> lock(m_blockindex_mutex);
+  if (!m_blockindex) {
+    vector<shared_ptr<DiscretizationBlock>> blocks;
+    for (const auto &kv : m_discretizationblocks)
+      if (kv.second->box().valid())
+        blocks.push_back(kv.second);
+    m_blockindex =
+        make_shared<BlockIndex>(manifold()->dimension(), std::move(blocks));
+  }
+  return m_blockindex;
+}
+
+void Discretization::invalidateBlockIndex() {
+  std::lock_guard<std::mutex> lock(m_blockindex_mutex);
+  m_blockindex.reset();
+}
+
+vector<shared_ptr<DiscretizationBlock>>
+Discretization::overlappingBlocks(const box_t &box) const {
+  auto index = blockindex();
+  assert(box.valid() && box.rank() == index->rank);
+  vector<shared_ptr<DiscretizationBlock>> blocks;
+  if (box.empty())
+    return blocks;
+  vector<long long> lo(box.lower()), hi(box.upper());
+  index->overlapping(lo.data(), hi.data(),
+                     [&](const shared_ptr<DiscretizationBlock> &block) {
+                       blocks.push_back(block);
+                     });
+  return blocks;
+}
+
+vector<shared_ptr<DiscretizationBlock>>
+Discretization::containingBlocks(const point_t &point) const {
+  auto index = blockindex();
+  assert(point.valid() && point.rank() == index->rank);
+  vector<shared_ptr<DiscretizationBlock>> blocks;
+  vector<long long> lo(point), hi(point + point_t(point.rank(), 1));
+  index->overlapping(lo.data(), hi.data(),
+                     [&](const shared_ptr<DiscretizationBlock> &block) {
+                       blocks.push_back(block);
+                     });
+  return blocks;
+}
+
+shared_ptr<DiscretizationBlock>
+Discretization::nearestBlock(const point_t &point) const {
+  auto index = blockindex();
+  assert(point.valid() && point.rank() == index->rank);
+  vector<long long> p(point);
+  return index->nearest(p.data());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 bool Discretization::invariant() const {
   return Common::invariant() && bool(manifold()) &&
          manifold()->discretizations().count(name()) &&
@@ -143,6 +379,7 @@ Discretization::createDiscretizationBlock(const string &name) {
   checked_emplace(m_discretizationblocks, discretizationblock->name(),
                   discretizationblock, "Discretization",
                   "discretizationblocks");
+  invalidateBlockIndex();
   assert(discretizationblock->invariant());
   return discretizationblock;
 }
@@ -184,6 +421,7 @@ Discretization::readDiscretizationBlock(const H5::H5Location &loc,
   checked_emplace(m_discretizationblocks, discretizationblock->name(),
                   discretizationblock, "Discretization",
                   "discretizationblocks");
+  invalidateBlockIndex();
   assert(discretizationblock->invariant());
   return discretizationblock;
 }
@@ -197,6 +435,7 @@ shared_ptr<DiscretizationBlock> Discretization::readDiscretizationBlock(
   checked_emplace(m_discretizationblocks, discretizationblock->name(),
                   discretizationblock, "Discretization",
                   "discretizationblocks");
+  invalidateBlockIndex();
   assert(discretizationblock->invariant());
   return discretizationblock;
 }
@@ -5,6 +5,7 @@
 #include "Config.hpp"
 #include "Configuration.hpp"
 #include "Manifold.hpp"
+#include "RegionCalculus.hpp"
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
 #include <asdf.hpp>
@@ -21,15 +22,21 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace SimulationIO {
 
+using RegionCalculus::box_t;
+using RegionCalculus::point_t;
+
 using std::make_shared;
 using std::map;
 using std::ostream;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::weak_ptr;
 
 class DiscreteField;
@@ -47,6 +54,12 @@ class Discretization : public Common,
       m_parent_discretizations; // backlinks
   NoBackLink<weak_ptr<DiscreteField>> m_discretefields;
 
+  // Bounding volume hierarchy over the block boxes, built on demand
+  struct BlockIndex;
+  mutable std::mutex m_blockindex_mutex;
+  mutable shared_ptr<const BlockIndex> m_blockindex;
+  shared_ptr<const BlockIndex> blockindex() const;
+
 public:
   virtual string type() const { return "Discretization"; }
 
@@ -160,7 +173,18 @@ public:
                          const YAML::Node &node);
 #endif
 
+  // Spatial queries over the boxes of the discretization blocks. Blocks
+  // without a box are ignored. Results are returned in unspecified order.
+  vector<shared_ptr<DiscretizationBlock>>
+  overlappingBlocks(const box_t &box) const;
+  vector<shared_ptr<DiscretizationBlock>>
+  containingBlocks(const point_t &point) const;
+  // Block whose box is closest to the point (in the Euclidean norm), or null
+  shared_ptr<DiscretizationBlock> nearestBlock(const point_t &point) const;
+
 private:
+  friend class DiscretizationBlock;
+  void invalidateBlockIndex();
   friend class SubDiscretization;
   void insertChild(const string &name,
                    const shared_ptr<SubDiscretization> &subdiscretization) {
@@ -136,8 +136,10 @@ void DiscretizationBlock::merge(
     const shared_ptr<DiscretizationBlock> &discretizationblock) {
   assert(discretization()->name() ==
          discretizationblock->discretization()->name());
-  if (!m_box.valid())
+  if (!m_box.valid()) {
     m_box = discretizationblock->box();
+    discretization()->invalidateBlockIndex();
+  }
   if (!m_active.valid())
     m_active = discretizationblock->active();
   if (discretizationblock->box().valid())
@@ -166,10 +168,11 @@ void try_write_active(const H5::H5Object &group,
   if (active.rank() != D)
     return;
   typedef RegionCalculus::box<long long, D> box_t;
+  // Merge boxes to keep the attribute small
   vector<box_t> boxes =
       dynamic_cast<const RegionCalculus::wregion<long long, D> *>(
           active.val.get())
-          ->val;
+          ->val.decompose(RegionCalculus::decomposition::merged);
   auto boxtype =
       discretizationblock.discretization()->manifold()->project()->boxtypes.at(
           D);
@@ -263,7 +266,8 @@ void write_region(const tiledb_writer &w,
   typedef RegionCalculus::region<long long, D> regionD_t;
   regionD_t regionD(region);
   typedef RegionCalculus::box<long long, D> boxD_t;
-  vector<boxD_t> boxesD(regionD);
+  vector<boxD_t> boxesD =
+      regionD.decompose(RegionCalculus::decomposition::merged);
 
   typedef array<long long, D> ipoint_t;
   typedef array<ipoint_t, 2> ibox_t;
@@ -109,12 +109,16 @@ public:
 
   void merge(const shared_ptr<DiscretizationBlock> &discretizationblock);
 
-  void setBox() { m_box.reset(); }
+  void setBox() {
+    m_box.reset();
+    discretization()->invalidateBlockIndex();
+  }
   void setBox(const box_t &box) {
     assert(box.valid() &&
            box.rank() == discretization()->manifold()->dimension() &&
            !box.empty());
     m_box = box;
+    discretization()->invalidateBlockIndex();
   }
   box_t getBox() const { return m_box; }
 
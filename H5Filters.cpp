@@ -0,0 +1,397 @@
+#include "H5Filters.hpp"
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+
+#ifdef SIMULATIONIO_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace H5 {
+
+namespace {
+
+// Big-endian integers, as used in the LZ4 filter's framing
+void put_be(std::vector<unsigned char> &buf, uint64_t val, int nbytes) {
+  for (int b = nbytes - 1; b >= 0; --b)
+    buf.push_back((val >> (8 * b)) & 0xff);
+}
+uint64_t get_be(const unsigned char *ptr, int nbytes) {
+  uint64_t val = 0;
+  for (int b = 0; b < nbytes; ++b)
+    val = (val << 8) | ptr[b];
+  return val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// LZ4 block format, see
+// <https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md>. We implement
+// a simple greedy compressor; its output can be decoded by any LZ4
+// implementation.
+
+const size_t lz4_minmatch = 4;
+// The last match must start at least 12 bytes before the end of the block,
+// and the last 5 bytes are always literals
+const size_t lz4_mflimit = 12;
+const size_t lz4_lastliterals = 5;
+const int lz4_hashlog = 14;
+const size_t lz4_maxoffset = 65535;
+
+uint32_t lz4_read32(const unsigned char *ptr) {
+  uint32_t val;
+  std::memcpy(&val, ptr, sizeof val);
+  return val;
+}
+
+uint32_t lz4_hash(uint32_t seq) {
+  return (seq * 2654435761U) >> (32 - lz4_hashlog);
+}
+
+void lz4_put_length(std::vector<unsigned char> &dst, size_t len) {
+  for (; len >= 255; len -= 255)
+    dst.push_back(255);
+  dst.push_back(len);
+}
+
+// Append a sequence (literals followed by an optional match)
+void lz4_put_sequence(std::vector<unsigned char> &dst,
+                      const unsigned char *literals, size_t nliterals,
+                      size_t offset, size_t matchlen) {
+  const size_t token = dst.size();
+  dst.push_back(std::min(nliterals, size_t(15)) << 4);
+  if (nliterals >= 15)
+    lz4_put_length(dst, nliterals - 15);
+  dst.insert(dst.end(), literals, literals + nliterals);
+  if (matchlen == 0)
+    return;
+  dst.push_back(offset & 0xff);
+  dst.push_back(offset >> 8);
+  const size_t len = matchlen - lz4_minmatch;
+  dst[token] |= std::min(len, size_t(15));
+  if (len >= 15)
+    lz4_put_length(dst, len - 15);
+}
+
+void lz4_compress_block(const unsigned char *src, size_t srclen,
+                        std::vector<unsigned char> &dst) {
+  size_t anchor = 0;
+  if (srclen > lz4_mflimit) {
+    // Positions are stored with an offset of 1, so that 0 means "empty"
+    std::vector<uint32_t> table(size_t(1) << lz4_hashlog, 0);
+    const size_t limit = srclen - lz4_mflimit;
+    const size_t matchlimit = srclen - lz4_lastliterals;
+    size_t ip = 0;
+    // Skip faster through incompressible data
+    size_t misses = 0;
+    while (ip < limit) {
+      const uint32_t seq = lz4_read32(src + ip);
+      const uint32_t h = lz4_hash(seq);
+      const size_t candidate = table[h];
+      table[h] = ip + 1;
+      if (candidate == 0 || ip - (candidate - 1) > lz4_maxoffset ||
+          lz4_read32(src + candidate - 1) != seq) {
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      size_t ref = candidate - 1;
+      size_t len = lz4_minmatch;
+      while (ip + len + 8 <= matchlimit &&
+             std::memcmp(src + ref + len, src + ip + len, 8) == 0)
+        len += 8;
+      while (ip + len < matchlimit && src[ref + len] == src[ip + len])
+        ++len;
+      // Extend the match backwards into the pending literals
+      while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+        --ip;
+        --ref;
+        ++len;
+      }
+      lz4_put_sequence(dst, src + anchor, ip - anchor, ip - ref, len);
+      ip += len;
+      anchor = ip;
+      if (ip >= 2 && ip - 2 < limit)
+        table[lz4_hash(lz4_read32(src + ip - 2))] = ip - 2 + 1;
+    }
+  }
+  lz4_put_sequence(dst, src + anchor, srclen - anchor, 0, 0);
+}
+
+// Returns false if the input is corrupt
+bool lz4_decompress_block(const unsigned char *src, size_t srclen,
+                          unsigned char *dst, size_t dstlen) {
+  size_t ip = 0, op = 0;
+  const auto get_length = [&](size_t &len) {
+    unsigned char b;
+    do {
+      if (ip >= srclen)
+        return false;
+      b = src[ip++];
+      len += b;
+    } while (b == 255);
+    return true;
+  };
+  while (ip < srclen) {
+    const unsigned char token = src[ip++];
+    size_t nliterals = token >> 4;
+    if (nliterals == 15 && !get_length(nliterals))
+      return false;
+    if (nliterals > srclen - ip || nliterals > dstlen - op)
+      return false;
+    std::memcpy(dst + op, src + ip, nliterals);
+    ip += nliterals;
+    op += nliterals;
+    if (ip == srclen)
+      break; // the last sequence has no match
+    if (srclen - ip < 2)
+      return false;
+    const size_t offset = src[ip] | (size_t(src[ip + 1]) << 8);
+    ip += 2;
+    size_t len = token & 15;
+    if (len == 15 && !get_length(len))
+      return false;
+    len += lz4_minmatch;
+    if (offset == 0 || offset > op || len > dstlen - op)
+      return false;
+    // Matches may overlap their output
+    for (size_t i = 0; i < len; ++i, ++op)
+      dst[op] = dst[op - offset];
+  }
+  return op == dstlen;
+}
+
+// The framing of the HDF5 LZ4 filter plugin: the uncompressed size (8 bytes)
+// and block size (4 bytes), followed by blocks each prefixed by their
+// compressed size (4 bytes), all big-endian. Blocks that do not compress are
+// stored as they are.
+const size_t lz4_default_blocksize = size_t(1) << 30;
+
+std::vector<unsigned char> lz4_encode(const unsigned char *src, size_t srclen,
+                                      size_t cd_nelmts,
+                                      const unsigned int cd_values[]) {
+  size_t blocksize = cd_nelmts > 0 && cd_values[0] > 0 ? cd_values[0]
+                                                       : lz4_default_blocksize;
+  blocksize = std::max(size_t(1), std::min(blocksize, srclen));
+  std::vector<unsigned char> dst;
+  dst.reserve(srclen + srclen / 255 + 16 + 4 * (srclen / blocksize + 1));
+  put_be(dst, srclen, 8);
+  put_be(dst, blocksize, 4);
+  std::vector<unsigned char> block;
+  for (size_t pos = 0; pos < srclen; pos += blocksize) {
+    const size_t len = std::min(blocksize, srclen - pos);
+    block.clear();
+    lz4_compress_block(src + pos, len, block);
+    if (block.size() >= len) {
+      put_be(dst, len, 4);
+      dst.insert(dst.end(), src + pos, src + pos + len);
+    } else {
+      put_be(dst, block.size(), 4);
+      dst.insert(dst.end(), block.begin(), block.end());
+    }
+  }
+  return dst;
+}
+
+// Returns false if the input is corrupt
+bool lz4_decode(const unsigned char *src, size_t srclen,
+                std::vector<unsigned char> &dst) {
+  if (srclen < 12)
+    return false;
+  const uint64_t origsize = get_be(src, 8);
+  size_t blocksize = get_be(src + 8, 4);
+  if (blocksize > origsize)
+    blocksize = origsize;
+  dst.resize(origsize);
+  size_t ip = 12;
+  for (size_t op = 0; op < origsize; op += blocksize) {
+    const size_t len = std::min(blocksize, size_t(origsize - op));
+    if (srclen - ip < 4)
+      return false;
+    const size_t complen = get_be(src + ip, 4);
+    ip += 4;
+    if (complen > srclen - ip)
+      return false;
+    if (complen == len)
+      std::memcpy(dst.data() + op, src + ip, len);
+    else if (!lz4_decompress_block(src + ip, complen, dst.data() + op, len))
+      return false;
+    ip += complen;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef SIMULATIONIO_HAVE_BZIP2
+int bzip2_blocksize(size_t cd_nelmts, const unsigned int cd_values[]) {
+  const int blocksize = cd_nelmts > 0 ? cd_values[0] : 9;
+  return std::max(1, std::min(9, blocksize));
+}
+
+// Returns false if compression fails
+bool bzip2_encode(const unsigned char *src, size_t srclen, size_t cd_nelmts,
+                  const unsigned int cd_values[],
+                  std::vector<unsigned char> &dst) {
+  // This bound is given in the bzip2 documentation
+  unsigned int dstlen = srclen + srclen / 100 + 600;
+  dst.resize(dstlen);
+  const int ierr = BZ2_bzBuffToBuffCompress(
+      reinterpret_cast<char *>(dst.data()), &dstlen,
+      const_cast<char *>(reinterpret_cast<const char *>(src)), srclen,
+      bzip2_blocksize(cd_nelmts, cd_values), 0, 0);
+  if (ierr != BZ_OK)
+    return false;
+  dst.resize(dstlen);
+  return true;
+}
+
+// Returns false if the input is corrupt
+bool bzip2_decode(const unsigned char *src, size_t srclen,
+                  std::vector<unsigned char> &dst) {
+  bz_stream stream;
+  std::memset(&stream, 0, sizeof stream);
+  if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK)
+    return false;
+  stream.next_in = const_cast<char *>(reinterpret_cast<const char *>(src));
+  stream.avail_in = srclen;
+  dst.resize(std::max(size_t(1024), 4 * srclen));
+  size_t pos = 0;
+  int ierr;
+  do {
+    if (pos == dst.size())
+      dst.resize(2 * dst.size());
+    stream.next_out = reinterpret_cast<char *>(dst.data() + pos);
+    stream.avail_out = dst.size() - pos;
+    ierr = BZ2_bzDecompress(&stream);
+    pos = dst.size() - stream.avail_out;
+  } while (ierr == BZ_OK && (stream.avail_in > 0 || stream.avail_out == 0));
+  BZ2_bzDecompressEnd(&stream);
+  if (ierr != BZ_STREAM_END)
+    return false;
+  dst.resize(pos);
+  return true;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Replace the chunk buffer owned by HDF5
+size_t filter_result(const std::vector<unsigned char> &result,
+                     size_t *buf_size, void **buf) {
+  void *newbuf = H5allocate_memory(std::max(result.size(), size_t(1)), false);
+  if (!newbuf)
+    return 0;
+  std::memcpy(newbuf, result.data(), result.size());
+  H5free_memory(*buf);
+  *buf = newbuf;
+  *buf_size = std::max(result.size(), size_t(1));
+  return result.size();
+}
+
+size_t lz4_filter(unsigned int flags, size_t cd_nelmts,
+                  const unsigned int cd_values[], size_t nbytes,
+                  size_t *buf_size, void **buf) {
+  const auto src = static_cast<const unsigned char *>(*buf);
+  std::vector<unsigned char> result;
+  if (flags & H5Z_FLAG_REVERSE) {
+    if (!lz4_decode(src, nbytes, result))
+      return 0;
+  } else {
+    result = lz4_encode(src, nbytes, cd_nelmts, cd_values);
+  }
+  return filter_result(result, buf_size, buf);
+}
+
+#ifdef SIMULATIONIO_HAVE_BZIP2
+size_t bzip2_filter(unsigned int flags, size_t cd_nelmts,
+                    const unsigned int cd_values[], size_t nbytes,
+                    size_t *buf_size, void **buf) {
+  const auto src = static_cast<const unsigned char *>(*buf);
+  std::vector<unsigned char> result;
+  if (flags & H5Z_FLAG_REVERSE) {
+    if (!bzip2_decode(src, nbytes, result))
+      return 0;
+  } else {
+    // Returning 0 makes HDF5 treat this as a filter failure
+    if (!bzip2_encode(src, nbytes, cd_nelmts, cd_values, result))
+      return 0;
+  }
+  return filter_result(result, buf_size, buf);
+}
+#endif
+
+} // namespace
+
+void registerFilters() {
+  static std::once_flag registered;
+  std::call_once(registered, [] {
+    static const H5Z_class2_t lz4_class = {
+        H5Z_CLASS_T_VERS, H5Z_FILTER_LZ4, 1, 1, "lz4", nullptr, nullptr,
+        lz4_filter};
+    herr_t herr = H5Zregister(&lz4_class);
+    assert(!herr);
+#ifdef SIMULATIONIO_HAVE_BZIP2
+    static const H5Z_class2_t bzip2_class = {
+        H5Z_CLASS_T_VERS, H5Z_FILTER_BZIP2, 1, 1, "bzip2", nullptr, nullptr,
+        bzip2_filter};
+    herr = H5Zregister(&bzip2_class);
+    assert(!herr);
+#endif
+  });
+}
+
+bool filterCanEncode(H5Z_filter_t filter) {
+  registerFilters();
+  if (H5Zfilter_avail(filter) <= 0)
+    return false;
+  unsigned int config;
+  if (H5Zget_filter_info(filter, &config) < 0)
+    return false;
+  return config & H5Z_FILTER_CONFIG_ENCODE_ENABLED;
+}
+
+void setBZip2(DSetCreatPropList &proplist, int block_size) {
+  assert(block_size >= 1 && block_size <= 9);
+  registerFilters();
+  const unsigned int cd_values[] = {(unsigned int)block_size};
+  proplist.setFilter(H5Z_FILTER_BZIP2, H5Z_FLAG_OPTIONAL, 1, cd_values);
+}
+
+void setLZ4(DSetCreatPropList &proplist) {
+  registerFilters();
+  proplist.setFilter(H5Z_FILTER_LZ4, H5Z_FLAG_OPTIONAL, 0, nullptr);
+}
+
+bool applyFilter(H5Z_filter_t filter,
+                 const std::vector<unsigned int> &cd_values,
+                 std::vector<unsigned char> &buf) {
+  switch (filter) {
+  case H5Z_FILTER_LZ4:
+    buf = lz4_encode(buf.data(), buf.size(), cd_values.size(),
+                     cd_values.data());
+    return true;
+#ifdef SIMULATIONIO_HAVE_BZIP2
+  case H5Z_FILTER_BZIP2: {
+    std::vector<unsigned char> compressed;
+    if (!bzip2_encode(buf.data(), buf.size(), cd_values.size(),
+                      cd_values.data(), compressed))
+      throw std::runtime_error("bzip2 compression failed");
+    buf.swap(compressed);
+    return true;
+  }
+#endif
+  default:
+    return false;
+  }
+}
+
+} // namespace H5
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef H5FILTERS_HPP
+#define H5FILTERS_HPP
+
+// Additional HDF5 compression filters
+
+#include "Config.hpp"
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+
+#include <H5Cpp.h>
+
+#include <vector>
+
+namespace H5 {
+
+// Filter identifiers as registered with The HDF Group. Files written with
+// these filters can also be read via the standard HDF5 filter plugins.
+const H5Z_filter_t H5Z_FILTER_BZIP2 = 307;
+const H5Z_filter_t H5Z_FILTER_LZ4 = 32004;
+
+// Register our filters with the HDF5 library. This needs to happen before
+// datasets using these filters are read or written. It is safe to call this
+// function multiple times.
+void registerFilters();
+
+// Check whether a filter can be used to write datasets
+bool filterCanEncode(H5Z_filter_t filter);
+
+// Add a filter to a dataset creation property list.
+// The bzip2 block size (in units of 100 kByte) must be in the range 1...9.
+void setBZip2(DSetCreatPropList &proplist, int block_size);
+// LZ4 is very fast, but compresses less than deflate or bzip2
+void setLZ4(DSetCreatPropList &proplist);
+
+// Apply one of our filters to a buffer, producing the same bytes as the HDF5
+// filter pipeline would. Returns false if the filter is not ours, and throws
+// if the filter fails.
+bool applyFilter(H5Z_filter_t filter,
+                 const std::vector<unsigned int> &cd_values,
+                 std::vector<unsigned char> &buf);
+
+} // namespace H5
+
+#endif
+
+#endif // #ifndef H5FILTERS_HPP
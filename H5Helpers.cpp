@@ -2,8 +2,56 @@
 
 #ifdef SIMULATIONIO_HAVE_HDF5
 
+#include <atomic>
+#include <cstdlib>
+
+#include <unistd.h>
+
 namespace H5 {
 
+bool isLibraryThreadsafe() {
+  static const bool threadsafe = [] {
+    hbool_t is_ts = false;
+    const herr_t herr = H5is_library_threadsafe(&is_ts);
+    return herr >= 0 && is_ts;
+  }();
+  return threadsafe;
+}
+
+namespace {
+std::atomic<bool> &library_serialized() {
+  static std::atomic<bool> serialized(!isLibraryThreadsafe());
+  return serialized;
+}
+thread_local int library_lock_depth = 0;
+} // namespace
+
+bool isLibrarySerialized() { return library_serialized(); }
+
+void setLibrarySerialized(bool serialized) {
+  library_serialized() = serialized || !isLibraryThreadsafe();
+}
+
+std::recursive_mutex &libraryMutex() {
+  // Never destroyed, so that static objects can be destroyed under the lock
+  static auto *const mutex = new std::recursive_mutex;
+  return *mutex;
+}
+
+library_lock::library_lock() : m_locked(isLibrarySerialized()) {
+  if (m_locked)
+    libraryMutex().lock();
+  ++library_lock_depth;
+}
+
+library_lock::~library_lock() {
+  --library_lock_depth;
+  if (m_locked)
+    libraryMutex().unlock();
+}
+
+bool library_lock::held() { return library_lock_depth > 0; }
+
 // Wrapper for hid_t that ensures correct HDF5 reference counting
 hid::hid(const hid &other) : m_id(other.m_id) { incref(); }
 
@@ -324,6 +372,63 @@ void readExternalLink(const CommonFG &link_loc, const std::string &link_name,
   }
 }
 
+std::string canonicalFileName(const std::string &file_name) {
+  char *const path = realpath(file_name.c_str(), nullptr);
+  if (!path)
+    return file_name;
+  const std::string canonical(path);
+  free(path);
+  return canonical;
+}
+
+std::string resolveExternalLink(const std::string &parent_file_name,
+                                const std::string &file_name) {
+  const auto exists = [](const std::string &name) {
+    return access(name.c_str(), F_OK) == 0;
+  };
+  const auto directory = [](const std::string &name) {
+    const auto slash = name.rfind('/');
+    return slash == std::string::npos ? std::string()
+                                      : name.substr(0, slash + 1);
+  };
+  if (file_name.empty())
+    return file_name;
+  std::string name = file_name;
+  if (name[0] == '/') {
+    if (exists(name))
+      return canonicalFileName(name);
+    name = name.substr(name.rfind('/') + 1);
+  }
+  const std::string parent_dir =
+      directory(canonicalFileName(parent_file_name));
+  std::vector<std::string> prefixes;
+  if (const char *const env = getenv("HDF5_EXT_PREFIX")) {
+    const std::string ext_prefix(env);
+    const std::string origin = "${ORIGIN}";
+    size_t pos = 0;
+    while (pos <= ext_prefix.size()) {
+      size_t end = ext_prefix.find(':', pos);
+      if (end == std::string::npos)
+        end = ext_prefix.size();
+      std::string prefix = ext_prefix.substr(pos, end - pos);
+      if (prefix.compare(0, origin.size(), origin) == 0)
+        prefix = parent_dir + prefix.substr(origin.size());
+      if (!prefix.empty()) {
+        if (prefix.back() != '/')
+          prefix += '/';
+        prefixes.push_back(prefix);
+      }
+      pos = end + 1;
+    }
+  }
+  prefixes.push_back(parent_dir);
+  prefixes.push_back(std::string());
+  for (const auto &prefix : prefixes)
+    if (exists(prefix + name))
+      return canonicalFileName(prefix + name);
+  return file_name;
+}
+
 } // namespace H5
 
 #endif
@@ -16,6 +16,7 @@
 #include <complex>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
@@ -36,6 +37,35 @@ template <typename T, typename Allocator>
 struct is_vector<std::vector<T, Allocator>> : std::true_type {};
 } // namespace detail
 
+// HDF5 may be built without thread-safety. SimulationIO then serializes all
+// its HDF5 calls on one process-wide recursive mutex. Data blocks can be
+// created and data attached via C++ types (e.g. createDataSet<T> and
+// DataSet::attachData(const vector<T> &)) without calling HDF5, so that the
+// next project can be built while Project::writeHDF5Async writes another
+// one on the I/O thread. Application code that calls HDF5 directly (this
+// includes creating, copying, or destroying H5 objects, e.g. those created
+// via getType or returned by SimulationIO) while such a write is pending
+// must hold a library_lock.
+bool isLibraryThreadsafe();
+// Whether HDF5 calls are serialized. This is always the case if HDF5 is not
+// thread-safe, and can be enabled otherwise, e.g. for testing.
+bool isLibrarySerialized();
+void setLibrarySerialized(bool serialized);
+std::recursive_mutex &libraryMutex();
+
+// Hold the library lock in a scope
+class library_lock {
+  bool m_locked;
+
+public:
+  library_lock();
+  ~library_lock();
+  library_lock(const library_lock &) = delete;
+  library_lock &operator=(const library_lock &) = delete;
+  // Whether the calling thread holds the library lock
+  static bool held();
+};
+
 // Wrapper for hid_t that ensures correct HDF5 reference counting
 class hid {
   hid_t m_id;
@@ -362,6 +392,21 @@ void readExternalLink(const CommonFG &link_loc, const std::string &link_name,
                       bool &link_exists, std::string &file_name,
                       std::string &obj_name);
 
+// The canonical absolute name of an existing file (with symbolic links
+// resolved), so that file names can be compared; other names are returned
+// unchanged
+std::string canonicalFileName(const std::string &file_name);
+
+// Find the file an external link refers to, as HDF5 does when it traverses
+// the link: an absolute name is tried first; a relative name (or the base
+// name of an absolute name that does not exist) is looked up in the
+// directories listed in HDF5_EXT_PREFIX (where "${ORIGIN}" stands for the
+// directory of the linking file), then in the directory of the linking file,
+// then in the current directory. Returns the canonical name of the file, or
+// file_name if it is not found.
+std::string resolveExternalLink(const std::string &parent_file_name,
+                                const std::string &file_name);
+
 // Write a map (ignoring the keys)
 template <typename K, typename T>
 Group createGroup(const H5Location &loc, const std::string &name,
@@ -3,6 +3,7 @@
 #include "Buffer.hpp"
 #include "Configuration.hpp"
 #include "CoordinateSystem.hpp"
+#include "DiscreteFieldBlockComponent.hpp"
 #include "Field.hpp"
 #include "Helpers.hpp"
 #include "Manifold.hpp"
@@ -12,29 +13,44 @@
 #include "TensorType.hpp"
 
 #ifdef SIMULATIONIO_HAVE_HDF5
+#include "H5Filters.hpp"
 #include "H5Helpers.hpp"
 #endif
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iomanip>
 #include <map>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace SimulationIO {
 
+using std::condition_variable;
+using std::deque;
 using std::ifstream;
 using std::ios;
+using std::lock_guard;
+using std::logic_error;
 using std::max;
 using std::min;
+using std::mutex;
 using std::ofstream;
 using std::ostringstream;
+using std::packaged_task;
 using std::string;
+using std::thread;
+using std::unique_lock;
 using std::vector;
 
 shared_ptr<Project> createProject(const string &name) {
@@ -46,12 +62,16 @@ shared_ptr<Project> createProject(const string &name) {
 #ifdef SIMULATIONIO_HAVE_HDF5
 shared_ptr<Project> readProject(const H5::H5Location &loc,
                                 const string &filename) {
+  H5::library_lock lock;
+  // Datasets may use our own compression filters
+  H5::registerFilters();
   auto project = Project::create(loc, filename);
   assert(project->invariant());
   return project;
 }
 
 shared_ptr<Project> readProjectHDF5(const string &filename) {
+  H5::library_lock lock;
   auto file = H5::H5File(filename, H5F_ACC_RDONLY);
   return readProject(file, filename);
 }
@@ -102,6 +122,12 @@ shared_ptr<Project> readProjectASDF(const string &filename) {
 
 bool Project::invariant() const { return Common::invariant(); }
 
+Project::~Project() {
+#ifdef SIMULATIONIO_HAVE_HDF5
+  releaseTypes();
+#endif
+}
+
 #ifdef SIMULATIONIO_HAVE_HDF5
 void Project::read(const H5::H5Location &loc, const string &filename) {
   auto group = loc.openGroup(".");
@@ -392,6 +418,7 @@ void Project::insertEnumField(const H5::EnumType &type, const string &name,
 #endif
 void Project::createTypes() const {
 #ifdef SIMULATIONIO_HAVE_HDF5
+  H5::library_lock lock;
   enumtype = H5::EnumType(H5::getType(int{}));
   insertEnumField(enumtype, "Basis", type_Basis);
   insertEnumField(enumtype, "BasisVector", type_BasisVector);
@@ -495,9 +522,37 @@ void Project::createTypes() const {
 }
 
 #ifdef SIMULATIONIO_HAVE_HDF5
+void Project::releaseTypes() const {
+  if (enumtype.getId() < 0 && pointtypes.empty())
+    return;
+  H5::library_lock lock;
+  enumtype = H5::EnumType();
+  rangetype = H5::CompType();
+  pointtypes.clear();
+  boxtypes.clear();
+  regiontypes.clear();
+  linearizationtypes.clear();
+  concatenationtypes.clear();
+}
+
+void Project::closeHDF5() const {
+  H5::library_lock lock;
+  for (const auto &field : fields())
+    for (const auto &discretefield : field.second->discretefields())
+      for (const auto &discretefieldblock :
+           discretefield.second->discretefieldblocks())
+        for (const auto &discretefieldblockcomponent :
+             discretefieldblock.second->discretefieldblockcomponents())
+          if (const auto &datablock =
+                  discretefieldblockcomponent.second->datablock())
+            datablock->closeHDF5();
+  releaseTypes();
+}
+
 void Project::write(const H5::H5Location &loc,
                     const H5::H5Location &parent) const {
   assert(invariant());
+  H5::library_lock lock;
   // auto group = loc.createGroup(name());
   auto group = loc.openGroup(".");
   createTypes();
@@ -525,6 +580,7 @@ void Project::write(const H5::H5Location &loc,
 }
 
 void Project::writeHDF5(const string &filename) const {
+  H5::library_lock lock;
   auto fapl = H5::FileAccPropList();
   // fapl.setFcloseDegree(H5F_CLOSE_STRONG);
   fapl.setLibverBounds(H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
@@ -532,6 +588,90 @@ void Project::writeHDF5(const string &filename) const {
       H5::H5File(filename, H5F_ACC_EXCL, H5::FileCreatPropList::DEFAULT, fapl);
   write(file);
 }
+
+namespace {
+// A dedicated thread that executes asynchronous HDF5 writes in order. At
+// most max_pending writes are queued or running, so that the caller can
+// build the next output while the previous one is written (double
+// buffering), without unbounded memory use. Each write holds the library
+// lock (see H5::library_lock) while it runs; building the next output does
+// not need it.
+class hdf5_write_queue_t {
+  static constexpr size_t max_pending = 2;
+
+  mutex m_mutex;
+  condition_variable m_cond;
+  deque<packaged_task<void()>> m_tasks;
+  size_t m_npending; // queued or running
+  bool m_stop;
+  thread m_thread;
+
+  void run() {
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+      m_cond.wait(lock, [&]() { return m_stop || !m_tasks.empty(); });
+      if (m_tasks.empty())
+        break;
+      auto task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+      lock.unlock();
+      // Exceptions are passed to the future
+      task();
+      lock.lock();
+      --m_npending;
+      m_cond.notify_all();
+    }
+  }
+
+public:
+  hdf5_write_queue_t()
+      : m_npending(0), m_stop(false), m_thread([this]() { run(); }) {}
+  ~hdf5_write_queue_t() {
+    // Finish all pending writes
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+  }
+
+  future<void> push(const function<void()> &f) {
+    packaged_task<void()> task(f);
+    auto fut = task.get_future();
+    unique_lock<mutex> lock(m_mutex);
+    m_cond.wait(lock, [&]() { return m_npending < max_pending; });
+    ++m_npending;
+    m_tasks.push_back(std::move(task));
+    m_cond.notify_all();
+    return fut;
+  }
+};
+
+hdf5_write_queue_t &hdf5_write_queue() {
+  static hdf5_write_queue_t queue;
+  return queue;
+}
+} // namespace
+
+future<void> Project::writeHDF5Async(const string &filename) const {
+  // The I/O thread needs the library lock, and we might wait for it below
+  if (H5::library_lock::held())
+    throw logic_error("Project::writeHDF5Async: called while holding the "
+                      "HDF5 library lock");
+  // Keep the project alive until it has been written
+  auto self = shared_from_this();
+  return hdf5_write_queue().push([self, filename]() {
+    H5::library_lock lock;
+    try {
+      self->writeHDF5(filename);
+    } catch (...) {
+      self->closeHDF5();
+      throw;
+    }
+    self->closeHDF5();
+  });
+}
 #endif
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
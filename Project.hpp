@@ -19,6 +19,7 @@
 #endif
 
 #include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
 #include <map>
@@ -29,6 +30,7 @@
 namespace SimulationIO {
 
 using std::function;
+using std::future;
 using std::istream;
 using std::make_shared;
 using std::map;
@@ -102,6 +104,7 @@ public:
   }
 
 #ifdef SIMULATIONIO_HAVE_HDF5
+  // These are created when the project is read or written
   mutable H5::EnumType enumtype;
   mutable H5::CompType rangetype;
 
@@ -129,16 +132,15 @@ public:
   friend shared_ptr<Project>
   readProject(const shared_ptr<ASDF::reader_state> &rs, const YAML::Node &node);
 #endif
+  // This does not call HDF5
   Project(hidden, const string &name) : Common(name) {
     SIMULATIONIO_CHECK_VERSION;
-    createTypes();
   }
   Project(hidden) : Common(hidden()) { SIMULATIONIO_CHECK_VERSION; }
 
 private:
   static shared_ptr<Project> create(const string &name) {
     auto project = make_shared<Project>(hidden(), name);
-    project->createTypes();
     return project;
   }
 #ifdef SIMULATIONIO_HAVE_HDF5
@@ -161,7 +163,7 @@ private:
 #endif
 
 public:
-  virtual ~Project() {}
+  virtual ~Project();
 
   void merge(const shared_ptr<Project> &project);
 
@@ -178,6 +180,9 @@ private:
                               int value);
 #endif
   void createTypes() const;
+#ifdef SIMULATIONIO_HAVE_HDF5
+  void releaseTypes() const;
+#endif
 
 public:
 #ifdef SIMULATIONIO_HAVE_HDF5
@@ -185,6 +190,19 @@ public:
                      const H5::H5Location &parent) const;
   void write(const H5::H5Location &loc) const { write(loc, H5::H5File()); }
   void writeHDF5(const string &filename) const;
+  // Write the project on a dedicated I/O thread. The project and its
+  // attached data must not be modified until the returned future is ready,
+  // but other projects can be built (and data attached to them via C++
+  // types) meanwhile, since this does not call HDF5 (see H5::library_lock).
+  // The project's HDF5 objects are released on the I/O thread after
+  // writing (see closeHDF5), so that the project can be destroyed on any
+  // thread. At most two writes are pending at a time; further calls block
+  // until the oldest write has finished. This must not be called while
+  // holding the library lock.
+  future<void> writeHDF5Async(const string &filename) const;
+  // Release the HDF5 objects held by the project and its data blocks (see
+  // DataBlock::closeHDF5)
+  void closeHDF5() const;
 #endif
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
   virtual vector<string> yaml_path() const;
@@ -14,11 +14,15 @@
 #include <cmath>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
+#include <new>
+#include <queue>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -168,6 +172,25 @@ R reduce(F &&f, Op &&op, const C &c) {
                 std::end(c));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Parallelism
+////////////////////////////////////////////////////////////////////////////////
+
+// Settings for task-parallel region operations. Work items (e.g. box lists)
+// with at most `cutoff` elements are processed serially; larger work items are
+// split recursively, and the parts are processed by up to `nthreads` threads.
+// Setting `nthreads` to 1 disables parallelism.
+struct parallel_settings_t {
+  size_t cutoff;
+  int nthreads;
+};
+
+inline parallel_settings_t &parallel_settings() {
+  static parallel_settings_t settings{
+      1000, max(1, int(std::thread::hardware_concurrency()))};
+  return settings;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Point
 ////////////////////////////////////////////////////////////////////////////////
@@ -1064,6 +1087,81 @@ template <typename T, int D> struct hash<RegionCalculus::box<T, D>> {
 };
 } // namespace std
 
+////////////////////////////////////////////////////////////////////////////////
+// Box decomposition
+////////////////////////////////////////////////////////////////////////////////
+
+namespace RegionCalculus {
+
+// How to convert a region to a list of disjoint boxes
+enum class decomposition {
+  // The boxes as they fall out of the region representation (fastest)
+  sweep,
+  // Additionally merge adjacent boxes that share a face
+  merged,
+  // Additionally try all sweep directions and keep the shortest list (slowest)
+  best,
+};
+
+namespace detail {
+// Greedily merge pairs of boxes that touch in one direction and have the same
+// extent in all other directions, until no more pairs can be merged. The boxes
+// must be disjoint. The result is sorted.
+template <typename T, int D> void merge_boxes(vector<box<T, D>> &bs) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int dir = 0; dir < D; ++dir) {
+      // Sort by the extent in all other directions, so that mergeable boxes
+      // become neighbours
+      sort(bs.begin(), bs.end(),
+           [dir](const box<T, D> &a, const box<T, D> &b) {
+             for (int d = D - 1; d >= 0; --d) {
+               if (d == dir)
+                 continue;
+               if (a.lo[d] != b.lo[d])
+                 return a.lo[d] < b.lo[d];
+               if (a.hi[d] != b.hi[d])
+                 return a.hi[d] < b.hi[d];
+             }
+             return a.lo[dir] < b.lo[dir];
+           });
+      size_t j = 0;
+      for (size_t i = 1; i < bs.size(); ++i) {
+        bool mergeable = bs[j].hi[dir] == bs[i].lo[dir];
+        for (int d = 0; d < D && mergeable; ++d)
+          if (d != dir)
+            mergeable =
+                bs[j].lo[d] == bs[i].lo[d] && bs[j].hi[d] == bs[i].hi[d];
+        if (mergeable) {
+          bs[j].hi[dir] = bs[i].hi[dir];
+          changed = true;
+        } else {
+          bs[++j] = bs[i];
+        }
+      }
+      if (!bs.empty())
+        bs.resize(j + 1);
+    }
+  }
+  sort(bs.begin(), bs.end(), std::less<box<T, D>>());
+}
+
+// Rank-0 boxes cannot be merged
+template <typename T> void merge_boxes(vector<box<T, 0>> &bs) {}
+
+// Cyclically permute the directions of a box by `k`
+template <typename T, int D> box<T, D> rotate_box(const box<T, D> &b, int k) {
+  point<T, D> lo, hi;
+  for (int d = 0; d < D; ++d) {
+    lo[d] = b.lo[(d + k) % D];
+    hi[d] = b.hi[(d + k) % D];
+  }
+  return box<T, D>(lo, hi);
+}
+} // namespace detail
+} // namespace RegionCalculus
+
 ////////////////////////////////////////////////////////////////////////////////
 // Region
 ////////////////////////////////////////////////////////////////////////////////
@@ -1093,6 +1191,12 @@ template <typename T, int D> struct region {
     assert(invariant());
   }
   operator vector<box<T, D>>() const { return boxes; }
+  vector<box<T, D>> decompose(decomposition mode) const {
+    vector<box<T, D>> bs(boxes);
+    if (mode != decomposition::sweep)
+      detail::merge_boxes(bs);
+    return bs;
+  }
   region &operator=(const region &r) = default;
   region &operator=(region &&r) = default;
   template <typename U> region(const region<U, D> &r) {
@@ -1406,6 +1510,7 @@ template <typename T> struct region<T, 0> {
       return vector<box<T, D>>();
     return vector<box<T, D>>(1, box<T, D>(true));
   }
+  vector<box<T, D>> decompose(decomposition mode) const { return *this; }
 
   // Shift and scale operators
   region operator>>(const point<T, D> &d) const { return *this; }
@@ -1449,6 +1554,33 @@ template <typename T> struct region<T, 0> {
   }
   region difference(const region &other) const { return *this - other; }
 
+  // Multi-way set operations
+  static region union_all(const vector<const region *> &regions) {
+    region res;
+    for (const auto r : regions)
+      res.m_full |= r->m_full;
+    return res;
+  }
+  static region intersect_all(const vector<const region *> &regions) {
+    assert(!regions.empty());
+    region res(true);
+    for (const auto r : regions)
+      res.m_full &= r->m_full;
+    return res;
+  }
+  static region union_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return union_all(rs);
+  }
+  static region intersect_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return intersect_all(rs);
+  }
+
   // Set comparison operators
   bool contains(const point<T, D> &p) const { return m_full; }
   bool isdisjoint(const region &other) const {
@@ -1512,6 +1644,84 @@ template <typename T> struct region<T, 0> {
 #endif
 };
 
+namespace detail {
+// Find the first element in [first, last) that is not less than x. The search
+// starts at the beginning and takes steps of increasing size, so that short
+// runs are found quickly.
+template <typename T>
+const T *gallop_lower_bound(const T *first, const T *last, const T &x) {
+  const size_t n = last - first;
+  size_t bound = 1;
+  while (bound < n && first[bound] < x)
+    bound *= 2;
+  return std::lower_bound(first + bound / 2, first + min(bound, n), x);
+}
+
+// Combine two sorted lists of interval boundaries (as stored in region<T,1>)
+// with a set operation. Bit (s0 + 2 * s1) of `table` holds the result of the
+// operation for the membership states s0 and s1 of the inputs. Writes at most
+// n0 + n1 boundaries to `res` and returns their number. `res` may alias
+// `iter0` if it starts at least n1 elements before it, which allows merging
+// in place.
+//
+// While one input does not change its state, the output changes state either
+// never or exactly whenever the other input changes its state. Such runs are
+// thus either skipped or copied as a whole, which avoids testing each boundary
+// separately.
+template <typename T>
+size_t merge_boundaries(const unsigned table, const T *iter0, const size_t n0,
+                        const T *iter1, const size_t n1, T *const res) {
+  const auto op = [table](bool s0, bool s1) {
+    return bool((table >> (int(s0) + 2 * int(s1))) & 1);
+  };
+  // The result must be empty outside of the inputs
+  assert(!op(false, false));
+  const bool depends0[2] = {op(false, false) != op(true, false),
+                            op(false, true) != op(true, true)};
+  const bool depends1[2] = {op(false, false) != op(false, true),
+                            op(true, false) != op(true, true)};
+
+  // Copy a run of the first input, which may already be in place
+  const auto copy_run = [](const T *first, const T *last, T *out) {
+    return out == first ? out + (last - first) : std::copy(first, last, out);
+  };
+
+  const T *const end0 = iter0 + n0;
+  const T *const end1 = iter1 + n1;
+  T *out = res;
+  bool s0 = false, s1 = false;
+  while (iter0 != end0 && iter1 != end1) {
+    if (*iter0 < *iter1) {
+      const T *const next0 = gallop_lower_bound(iter0, end0, *iter1);
+      if (depends0[s1])
+        out = copy_run(iter0, next0, out);
+      s0 ^= (next0 - iter0) & 1;
+      iter0 = next0;
+    } else if (*iter1 < *iter0) {
+      const T *const next1 = gallop_lower_bound(iter1, end1, *iter0);
+      if (depends1[s0])
+        out = std::copy(iter1, next1, out);
+      s1 ^= (next1 - iter1) & 1;
+      iter1 = next1;
+    } else {
+      const bool old_s = op(s0, s1);
+      s0 = !s0;
+      s1 = !s1;
+      if (op(s0, s1) != old_s)
+        *out++ = *iter0;
+      ++iter0;
+      ++iter1;
+    }
+  }
+  // The exhausted input is empty from here on
+  if (depends0[false])
+    out = copy_run(iter0, end0, out);
+  if (depends1[false])
+    out = std::copy(iter1, end1, out);
+  return out - res;
+}
+} // namespace detail
+
 template <typename T> struct region<T, 1> {
   constexpr static int D = 1;
 
@@ -1602,26 +1812,47 @@ private:
     return res;
   }
 
+  // Tabulate a set operation for merge_boundaries
+  template <typename F> static unsigned tabulate(const F &op) {
+    unsigned table = 0;
+    for (int s = 0; s < 4; ++s)
+      table |= unsigned(!op(subregion_t(bool(s & 1)), subregion_t(bool(s & 2)))
+                             .empty())
+               << s;
+    return table;
+  }
+
   template <typename F>
   region binary_operator(const F &op, const region &other) const {
     region res;
-    // res.reserve(subregions.size() + other.subregions.size());
-    subregion_t old_decoded_subregion;
-    traverse_subregions(
-        [&](const T pos, const subregion_t &decoded_subregion0,
-            const subregion_t &decoded_subregion1) {
-          auto decoded_subregion = op(decoded_subregion0, decoded_subregion1);
-          auto subregion = decoded_subregion ^ old_decoded_subregion;
-          if (!subregion.empty())
-            res.subregions.push_back(pos);
-          old_decoded_subregion = decoded_subregion;
-        },
-        other);
-    assert(old_decoded_subregion.empty());
+    res.subregions.resize(subregions.size() + other.subregions.size());
+    const size_t nres = detail::merge_boundaries(
+        tabulate(op), subregions.data(), subregions.size(),
+        other.subregions.data(), other.subregions.size(),
+        res.subregions.data());
+    res.subregions.resize(nres);
     assert(res.invariant());
     return res;
   }
 
+  // Merge in place: move our boundaries to the end of the buffer and
+  // write the result to its beginning
+  template <typename F>
+  region &binary_operator_inplace(const F &op, const region &other) {
+    if (&other == this)
+      return *this = binary_operator(op, other);
+    const size_t n0 = subregions.size(), n1 = other.subregions.size();
+    subregions.resize(n0 + n1);
+    std::copy_backward(subregions.begin(), subregions.begin() + n0,
+                       subregions.end());
+    const size_t nres = detail::merge_boundaries(
+        tabulate(op), subregions.data() + n1, n0, other.subregions.data(), n1,
+        subregions.data());
+    subregions.resize(nres);
+    assert(invariant());
+    return *this;
+  }
+
 public:
   // Invariant
   bool invariant() const {
@@ -1706,6 +1937,8 @@ public:
     lbnds.reserve(boxes.size());
     ubnds.reserve(boxes.size());
     for (const auto &box : boxes) {
+      if (box.empty())
+        continue;
       lbnds.push_back(box.lower()[0]);
       ubnds.push_back(box.upper()[0]);
     }
@@ -1737,6 +1970,8 @@ public:
 #endif
     return res;
   }
+  // Intervals are already a minimal decomposition
+  vector<box<T, D>> decompose(decomposition mode) const { return *this; }
 
   // Shift and scale operators
   region operator>>(const point<T, D> &d) const {
@@ -1839,10 +2074,34 @@ public:
                            other);
   }
 
-  region &operator^=(const region &other) { return *this = *this ^ other; }
-  region &operator&=(const region &other) { return *this = *this & other; }
-  region &operator|=(const region &other) { return *this = *this | other; }
-  region &operator-=(const region &other) { return *this = *this - other; }
+  region &operator^=(const region &other) {
+    return binary_operator_inplace(
+        [](const subregion_t &set0, const subregion_t &set1) {
+          return set0 ^ set1;
+        },
+        other);
+  }
+  region &operator&=(const region &other) {
+    return binary_operator_inplace(
+        [](const subregion_t &set0, const subregion_t &set1) {
+          return set0 & set1;
+        },
+        other);
+  }
+  region &operator|=(const region &other) {
+    return binary_operator_inplace(
+        [](const subregion_t &set0, const subregion_t &set1) {
+          return set0 | set1;
+        },
+        other);
+  }
+  region &operator-=(const region &other) {
+    return binary_operator_inplace(
+        [](const subregion_t &set0, const subregion_t &set1) {
+          return set0 - set1;
+        },
+        other);
+  }
 
   region intersection(const region &other) const { return *this & other; }
   region setunion(const region &other) const { return *this | other; }
@@ -1851,15 +2110,78 @@ public:
   }
   region difference(const region &other) const { return *this - other; }
 
+  // Multi-way set operations. All boundaries are merged in a single sweep,
+  // counting the number of regions that contain the current position.
+private:
+  static region combine_all(const vector<const region *> &regions,
+                            const bool intersect) {
+    const size_t nregions = regions.size();
+    if (nregions == 1)
+      return *regions[0];
+    typedef pair<T, size_t> item_t;
+    vector<item_t> items;
+    for (size_t i = 0; i < nregions; ++i)
+      if (!regions[i]->subregions.empty())
+        items.emplace_back(regions[i]->subregions[0], i);
+    std::priority_queue<item_t, vector<item_t>, std::greater<item_t>> heap(
+        std::greater<item_t>(), move(items));
+    vector<size_t> next(nregions, 0);
+    size_t count = 0;
+    bool old_state = false;
+    region res;
+    while (!heap.empty()) {
+      const T pos = heap.top().first;
+      while (!heap.empty() && heap.top().first == pos) {
+        const size_t i = heap.top().second;
+        heap.pop();
+        // Even boundaries enter a region, odd ones leave it
+        if (next[i] % 2 == 0)
+          ++count;
+        else
+          --count;
+        if (++next[i] < regions[i]->subregions.size())
+          heap.emplace(regions[i]->subregions[next[i]], i);
+      }
+      const bool state = intersect ? count == nregions : count > 0;
+      if (state != old_state)
+        res.subregions.push_back(pos);
+      old_state = state;
+    }
+    assert(!old_state);
+    assert(res.invariant());
+    return res;
+  }
+
+public:
+  static region union_all(const vector<const region *> &regions) {
+    return combine_all(regions, false);
+  }
+  static region intersect_all(const vector<const region *> &regions) {
+    assert(!regions.empty());
+    return combine_all(regions, true);
+  }
+  static region union_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return union_all(rs);
+  }
+  static region intersect_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return intersect_all(rs);
+  }
+
   // Set comparison operators
   bool contains(const point<T, D> &p) const {
     if (subregions.empty())
       return false;
     if (p[0] < *subregions.begin() || p[0] >= *subregions.rbegin())
       return false;
-    const auto pos = std::find_if(subregions.begin(), subregions.end(),
-                                  [p](T pos) { return p[0] >= pos; });
-    return (pos - subregions.begin()) % 2 == 0;
+    const auto pos =
+        std::upper_bound(subregions.begin(), subregions.end(), p[0]);
+    return (pos - subregions.begin()) % 2 == 1;
   }
   bool isdisjoint(const region &other) const { return (*this & other).empty(); }
 
@@ -2059,6 +2381,103 @@ private:
     return res;
   }
 
+  // Sweep over slabs [starts[i], ends[i]) carrying the subregions
+  // values[i]; both starts and ends must be strictly increasing. At
+  // each position, the result is post(op(values[a], ..., values[b-1]))
+  // for the slabs [a, b) covering that position. The window aggregate
+  // is maintained with two stacks (suffix aggregates for the front,
+  // a running aggregate for the back), so that each slab takes part in
+  // a constant number of operations.
+  template <typename Op, typename Post>
+  static region sliding_window_operator(const vector<T> &starts,
+                                        const vector<T> &ends,
+                                        const vector<subregion_t> &values,
+                                        const Op &op, const Post &post) {
+    const size_t n = values.size();
+    assert(starts.size() == n && ends.size() == n);
+    region res;
+    subregion_t old_decoded_subregion;
+    vector<subregion_t> front; // front[i - a0] = op(values[i..mid))
+    size_t a = 0, b = 0, a0 = 0, mid = 0;
+    subregion_t back; // op(values[mid..b))
+    while (b < n || a < n) {
+      const T pos = b < n ? min(starts[b], ends[a]) : ends[a];
+      for (; b < n && starts[b] == pos; ++b) {
+        if (b == mid)
+          back = values[b];
+        else
+          back = op(back, values[b]);
+      }
+      for (; a < b && ends[a] == pos; ++a)
+        ;
+      subregion_t decoded_subregion;
+      if (a < b) {
+        if (a >= mid) {
+          // The front stack is exhausted; move the back stack there
+          front.resize(b - a);
+          front.back() = values[b - 1];
+          for (size_t i = b - 1; i > a; --i)
+            front[i - 1 - a] = op(values[i - 1], front[i - a]);
+          a0 = a;
+          mid = b;
+          back = subregion_t();
+        }
+        decoded_subregion = post(b > mid ? op(front[a - a0], back)
+                                         : subregion_t(front[a - a0]));
+      }
+      auto subregion = decoded_subregion ^ old_decoded_subregion;
+      if (!subregion.empty())
+        res.subregions.emplace_back(make_pair(pos, move(subregion)));
+      old_decoded_subregion = move(decoded_subregion);
+    }
+    assert(old_decoded_subregion.empty());
+    assert(res.invariant());
+    return res;
+  }
+
+  // Whether the extents of the two regions in the outermost direction
+  // overlap. If not, set operations reduce to concatenation.
+  bool overlaps_extent(const region &other) const {
+    if (empty() || other.empty())
+      return false;
+    return subregions.front().first < other.subregions.back().first &&
+           other.subregions.front().first < subregions.back().first;
+  }
+
+  // Append the boundaries of a region that lies entirely after this
+  // one; at a common boundary, the two differences are combined
+  void append_disjoint(const region &other) {
+    assert(!overlaps_extent(other));
+    auto iter = other.subregions.begin();
+    if (!empty() && iter != other.subregions.end() &&
+        iter->first == subregions.back().first) {
+      subregions.back().second ^= iter->second;
+      if (subregions.back().second.empty())
+        subregions.pop_back();
+      ++iter;
+    }
+    subregions.insert(subregions.end(), iter, other.subregions.end());
+  }
+
+  // Union or symmetric difference with a region that does not overlap
+  // this one in the outermost direction
+  void concat_disjoint(const region &other) {
+    if (other.empty())
+      return;
+    if (empty()) {
+      *this = other;
+    } else if (subregions.back().first <= other.subregions.front().first) {
+      append_disjoint(other);
+    } else {
+      region res;
+      res.subregions.reserve(subregions.size() + other.subregions.size());
+      res.append_disjoint(other);
+      res.append_disjoint(*this);
+      *this = move(res);
+    }
+    assert(invariant());
+  }
+
 public:
   // Invariant
   bool invariant() const {
@@ -2107,19 +2526,40 @@ public:
 private:
   static region
   region_from_boxes(const typename vector<box<T, D>>::const_iterator &begin,
-                    const typename vector<box<T, D>>::const_iterator &end) {
+                    const typename vector<box<T, D>>::const_iterator &end,
+                    const size_t cutoff, const int nthreads) {
     auto sz = end - begin;
     if (sz == 0)
       return region();
     if (sz == 1)
       return region(*begin);
     const auto mid = begin + sz / 2;
-    return region_from_boxes(begin, mid) | region_from_boxes(mid, end);
+    if (nthreads > 1 && size_t(sz) > cutoff) {
+      // Build the lower half asynchronously, and the upper half in this
+      // thread. The split points are the same as in the serial case, so that
+      // the result is identical.
+      auto lower = std::async(std::launch::async, [&]() {
+        return region_from_boxes(begin, mid, cutoff, nthreads / 2);
+      });
+      auto upper = region_from_boxes(mid, end, cutoff, nthreads - nthreads / 2);
+      return lower.get() | upper;
+    }
+    return region_from_boxes(begin, mid, cutoff, 1) |
+           region_from_boxes(mid, end, cutoff, 1);
   }
 
 public:
+  // Build a region from boxes, using up to `nthreads` threads for box lists
+  // with more than `cutoff` elements
+  static region from_boxes(const vector<box<T, D>> &boxes, const size_t cutoff,
+                           const int nthreads) {
+    return region_from_boxes(boxes.begin(), boxes.end(), cutoff, nthreads);
+  }
+
   region(const vector<box<T, D>> &boxes) {
-    *this = region_from_boxes(boxes.begin(), boxes.end());
+    const auto &settings = parallel_settings();
+    *this = region_from_boxes(boxes.begin(), boxes.end(), settings.cutoff,
+                              settings.nthreads);
 #if REGIONCALCULUS_DEBUG
     {
       region reg;
@@ -2196,6 +2636,34 @@ public:
     return res;
   }
 
+  vector<box<T, D>> decompose(decomposition mode) const {
+    vector<box<T, D>> res(*this);
+    if (mode == decomposition::sweep)
+      return res;
+    detail::merge_boxes(res);
+    if (mode == decomposition::merged)
+      return res;
+    // The sweep cuts the region into slabs normal to the last direction. Try
+    // the other directions by sweeping over a rotated region.
+    const vector<box<T, D>> boxes(*this);
+    for (int k = 1; k < D; ++k) {
+      vector<box<T, D>> rotated;
+      rotated.reserve(boxes.size());
+      for (const auto &b : boxes)
+        rotated.push_back(detail::rotate_box(b, k));
+      const region rotreg(rotated);
+      vector<box<T, D>> bs(rotreg);
+      detail::merge_boxes(bs);
+      if (bs.size() < res.size()) {
+        for (auto &b : bs)
+          b = detail::rotate_box(b, D - k);
+        sort(bs.begin(), bs.end(), std::less<box<T, D>>());
+        res = move(bs);
+      }
+    }
+    return res;
+  }
+
   // Shift and scale operators
   region operator>>(const point<T, D> &d) const {
     region nr;
@@ -2214,26 +2682,87 @@ public:
   region grow(const point<T, D> &dlo, const point<T, D> &dup) const {
     // Cannot shrink
     assert(all(dlo + dup >= point<T, D>(T(0))));
-    // region nr;
-    // for (const auto &box : vector<box<T, D>>(*this))
-    //   nr |= box.grow(dlo, dup);
-    // return nr;
-    return reduce([&](const box<T, D> &b) { return region(b.grow(dlo, dup)); },
-                  [](const region &x, const region &y) { return x | y; },
-                  vector<box<T, D>>(*this));
+    // Each non-empty slab [pos, next_pos) is extended to
+    // [pos - dlo, next_pos + dup); the grown region's cross section is
+    // the grown union of all slabs covering a position.
+    const T dx0 = dlo[D - 1], dx1 = dup[D - 1];
+    const auto subdlo = dlo.subpoint(D - 1), subdup = dup.subpoint(D - 1);
+    vector<T> starts, ends;
+    vector<subregion_t> values;
+    starts.reserve(subregions.size());
+    ends.reserve(subregions.size());
+    values.reserve(subregions.size());
+    traverse_subregions([&](const T pos, const subregion_t &decoded_subregion) {
+      if (!values.empty() && ends.size() < values.size())
+        ends.push_back(pos + dx1);
+      if (!decoded_subregion.empty()) {
+        starts.push_back(pos - dx0);
+        values.push_back(decoded_subregion);
+      }
+    });
+    region nr = sliding_window_operator(
+        starts, ends, values,
+        [](const subregion_t &x, const subregion_t &y) { return x | y; },
+        [&](const subregion_t &x) { return x.grow(subdlo, subdup); });
+#if REGIONCALCULUS_DEBUG
+    assert(nr == grow_reduce(dlo, dup));
+#endif
+    return nr;
   }
   region grow(const point<T, D> &d) const { return grow(d, d); }
   region grow(T n) const { return grow(point<T, D>(n)); }
   region shrink(const point<T, D> &dlo, const point<T, D> &dup) const {
     // Cannot grow
     assert(all(dlo + dup >= point<T, D>(T(0))));
-    auto world = bounding_box().grow(1);
-    return region(world.grow(dup, dlo)) -
-           (region(world) - *this).grow(dup, dlo);
+    if (empty())
+      return region();
+    // A position lies in the shrunk region's cross section if the
+    // shrunk intersection of all slabs [pos, next_pos) that touch
+    // [pos - dlo, pos + dup] contains it. Slab [pos, next_pos) is
+    // touched from [pos - dup, next_pos + dlo). The unbounded empty
+    // slabs before and after the region terminate the sweep.
+    const T dx0 = dlo[D - 1], dx1 = dup[D - 1];
+    const auto subdlo = dlo.subpoint(D - 1), subdup = dup.subpoint(D - 1);
+    vector<T> starts, ends;
+    vector<subregion_t> values;
+    starts.reserve(subregions.size() + 1);
+    ends.reserve(subregions.size() + 1);
+    values.reserve(subregions.size() + 1);
+    starts.push_back(numeric_limits<T>::lowest());
+    values.push_back(subregion_t());
+    traverse_subregions([&](const T pos, const subregion_t &decoded_subregion) {
+      ends.push_back(pos + dx0);
+      starts.push_back(pos - dx1);
+      values.push_back(decoded_subregion);
+    });
+    ends.push_back(numeric_limits<T>::max());
+    region nr = sliding_window_operator(
+        starts, ends, values,
+        [](const subregion_t &x, const subregion_t &y) { return x & y; },
+        [&](const subregion_t &x) { return x.shrink(subdlo, subdup); });
+#if REGIONCALCULUS_DEBUG
+    assert(nr == shrink_reduce(dlo, dup));
+#endif
+    return nr;
   }
   region shrink(const point<T, D> &d) const { return shrink(d, d); }
   region shrink(T n) const { return shrink(point<T, D>(n)); }
 
+  // Reference implementations via box lists and set operations, used
+  // for testing and benchmarking
+  region grow_reduce(const point<T, D> &dlo, const point<T, D> &dup) const {
+    assert(all(dlo + dup >= point<T, D>(T(0))));
+    return reduce([&](const box<T, D> &b) { return region(b.grow(dlo, dup)); },
+                  [](const region &x, const region &y) { return x | y; },
+                  vector<box<T, D>>(*this));
+  }
+  region shrink_reduce(const point<T, D> &dlo, const point<T, D> &dup) const {
+    assert(all(dlo + dup >= point<T, D>(T(0))));
+    auto world = bounding_box().grow(1);
+    return region(world.grow(dup, dlo)) -
+           (region(world) - *this).grow_reduce(dup, dlo);
+  }
+
   // Set operations
   box<T, D> bounding_box() const {
     if (empty())
@@ -2278,10 +2807,29 @@ public:
                            other);
   }
 
-  region &operator^=(const region &other) { return *this = *this ^ other; }
-  region &operator&=(const region &other) { return *this = *this & other; }
-  region &operator|=(const region &other) { return *this = *this | other; }
-  region &operator-=(const region &other) { return *this = *this - other; }
+  region &operator^=(const region &other) {
+    if (overlaps_extent(other))
+      return *this = *this ^ other;
+    concat_disjoint(other);
+    return *this;
+  }
+  region &operator&=(const region &other) {
+    if (overlaps_extent(other))
+      return *this = *this & other;
+    subregions.clear();
+    return *this;
+  }
+  region &operator|=(const region &other) {
+    if (overlaps_extent(other))
+      return *this = *this | other;
+    concat_disjoint(other);
+    return *this;
+  }
+  region &operator-=(const region &other) {
+    if (overlaps_extent(other))
+      return *this = *this - other;
+    return *this;
+  }
 
   region intersection(const region &other) const { return *this & other; }
   region setunion(const region &other) const { return *this | other; }
@@ -2290,6 +2838,90 @@ public:
   }
   region difference(const region &other) const { return *this - other; }
 
+  // Multi-way set operations. The positions of all regions are merged in a
+  // single sweep; at each position, the cross sections of the regions that
+  // are active there are combined recursively.
+private:
+  static region combine_all(const vector<const region *> &regions,
+                            const bool intersect) {
+    const size_t nregions = regions.size();
+    if (nregions == 1)
+      return *regions[0];
+    typedef pair<T, size_t> item_t;
+    vector<item_t> items;
+    for (size_t i = 0; i < nregions; ++i)
+      if (!regions[i]->subregions.empty())
+        items.emplace_back(regions[i]->subregions[0].first, i);
+    std::priority_queue<item_t, vector<item_t>, std::greater<item_t>> heap(
+        std::greater<item_t>(), move(items));
+    vector<size_t> next(nregions, 0);
+    vector<subregion_t> decoded_subregions(nregions);
+    // Regions with a non-empty cross section, and their index in `active`
+    vector<size_t> active;
+    vector<size_t> active_index(nregions);
+    vector<const subregion_t *> subregions_ptrs;
+    region res;
+    subregion_t old_decoded_subregion;
+    while (!heap.empty()) {
+      const T pos = heap.top().first;
+      while (!heap.empty() && heap.top().first == pos) {
+        const size_t i = heap.top().second;
+        heap.pop();
+        const bool was_empty = decoded_subregions[i].empty();
+        decoded_subregions[i] ^= regions[i]->subregions[next[i]].second;
+        const bool is_empty = decoded_subregions[i].empty();
+        if (was_empty && !is_empty) {
+          active_index[i] = active.size();
+          active.push_back(i);
+        } else if (!was_empty && is_empty) {
+          const size_t j = active.back();
+          active[active_index[i]] = j;
+          active_index[j] = active_index[i];
+          active.pop_back();
+        }
+        if (++next[i] < regions[i]->subregions.size())
+          heap.emplace(regions[i]->subregions[next[i]].first, i);
+      }
+      subregion_t decoded_subregion;
+      if (!active.empty() && (!intersect || active.size() == nregions)) {
+        subregions_ptrs.clear();
+        for (const size_t i : active)
+          subregions_ptrs.push_back(&decoded_subregions[i]);
+        decoded_subregion =
+            intersect ? subregion_t::intersect_all(subregions_ptrs)
+                      : subregion_t::union_all(subregions_ptrs);
+      }
+      auto subregion = decoded_subregion ^ old_decoded_subregion;
+      if (!subregion.empty())
+        res.subregions.emplace_back(make_pair(pos, move(subregion)));
+      old_decoded_subregion = move(decoded_subregion);
+    }
+    assert(old_decoded_subregion.empty());
+    assert(res.invariant());
+    return res;
+  }
+
+public:
+  static region union_all(const vector<const region *> &regions) {
+    return combine_all(regions, false);
+  }
+  static region intersect_all(const vector<const region *> &regions) {
+    assert(!regions.empty());
+    return combine_all(regions, true);
+  }
+  static region union_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return union_all(rs);
+  }
+  static region intersect_all(const vector<region> &regions) {
+    vector<const region *> rs;
+    for (const auto &r : regions)
+      rs.push_back(&r);
+    return intersect_all(rs);
+  }
+
   // Set comparison operators
   bool contains(const point<T, D> &p) const { return !isdisjoint(region(p)); }
   bool isdisjoint(const region &other) const { return (*this & other).empty(); }
@@ -2315,8 +2947,16 @@ public:
     return eq(subregions, other.subregions);
   }
   bool less(const region &other) const {
-    std::less<subregions_t> lt;
-    return lt(subregions, other.subregions);
+    // Compare subregions with less, not with operator< (which tests for
+    // strict subsets and is thus not a total order)
+    return std::lexicographical_compare(
+        subregions.begin(), subregions.end(), other.subregions.begin(),
+        other.subregions.end(),
+        [](const pair<T, subregion_t> &a, const pair<T, subregion_t> &b) {
+          if (a.first != b.first)
+            return a.first < b.first;
+          return a.second.less(b.second);
+        });
   }
   size_t hash() const {
     size_t r = size_t(0x4eecc6384bcd469dULL);
@@ -2399,74 +3039,616 @@ template <typename T, int D> struct hash<RegionCalculus::region<T, D>> {
 };
 } // namespace std
 
-#endif // #if REGIONCALCULUS_TREE
-
 ////////////////////////////////////////////////////////////////////////////////
-// Dimension-independent wrappers
+// Flat region
 ////////////////////////////////////////////////////////////////////////////////
 
-namespace RegionCalculus {
+// A flat region has the same structure as a tree-based region, but stores all
+// levels contiguously in two buffers: one for the coordinates, and one for the
+// offsets (CSR style). A node of dimension D is stored in pre-order:
+//
+// D = 1:  offsets: [ncoords]
+//         coords:  [pos, ...]
+// D > 1:  offsets: [nentries, ncoords, noffsets, <subregion offsets>...]
+//         coords:  [pos, <subregion coords>..., ...]
+//
+// Here ncoords and noffsets are the numbers of coordinates and offsets used by
+// the entries (excluding the node's own header). Set operations write into
+// buffers that are reused between steps, which avoids most of the small heap
+// allocations of the tree-based representation.
 
-// Virtual classes
+namespace RegionCalculus {
+namespace detail {
+struct bool_xor {
+  bool operator()(bool set0, bool set1) const { return set0 ^ set1; }
+};
+struct bool_and {
+  bool operator()(bool set0, bool set1) const { return set0 & set1; }
+};
+struct bool_or {
+  bool operator()(bool set0, bool set1) const { return set0 | set1; }
+};
+struct bool_difference {
+  bool operator()(bool set0, bool set1) const { return set0 & !set1; }
+};
+} // namespace detail
 
-template <typename T> struct vpoint {
-  virtual ~vpoint() {}
+template <typename T, int D> struct flat_region;
+template <typename T, int D> struct flat_workspace;
 
-  virtual unique_ptr<vpoint> copy() const = 0;
+// Scratch buffers for set operations, one set per dimension
+template <typename T> struct flat_workspace<T, 1> {};
+template <typename T, int D> struct flat_workspace {
+  flat_region<T, D - 1> decoded_subregion0, decoded_subregion1,
+      decoded_subregion, old_decoded_subregion, tmp;
+  flat_workspace<T, D - 1> subworkspace;
+};
 
-  static unique_ptr<vpoint> make(int d);
-  static unique_ptr<vpoint> make(int d, T x);
-  static unique_ptr<vpoint> make(const vector<T> &val);
-  template <typename U> static unique_ptr<vpoint> make(const vector<U> &val);
-  virtual operator vector<T>() const = 0;
-  template <typename U> operator vector<U>() const {
-    auto rT(vector<T>(*this));
-    vector<U> rU(rT.size());
-    for (size_t i = 0; i < rU.size(); ++i)
-      rU[i] = U(move(rT[i]));
-    return rU;
-  }
-  template <typename U> static unique_ptr<vpoint> make(const vpoint<U> &p);
+template <typename T> struct flat_region<T, 1> {
+  constexpr static int D = 1;
+  constexpr static size_t header_size = 1;
 
-  virtual int rank() const = 0;
+  vector<T> coords;
+  vector<size_t> offsets;
 
-  // Access and conversion
-  virtual T operator[](int d) const = 0;
-  virtual T &operator[](int d) = 0;
-  virtual unique_ptr<vpoint> subpoint(int dir) const = 0;
-  virtual unique_ptr<vpoint> superpoint(int dir, T x) const = 0;
-  virtual unique_ptr<vpoint> reversed() const = 0;
+  flat_region() : offsets(header_size, 0) {}
+  flat_region(const flat_region &) = default;
+  flat_region(flat_region &&) = default;
+  flat_region &operator=(const flat_region &) = default;
+  flat_region &operator=(flat_region &&) = default;
 
-  // Unary operators
-  virtual unique_ptr<vpoint> operator+() const = 0;
-  virtual unique_ptr<vpoint> operator-() const = 0;
-  virtual unique_ptr<vpoint> operator~() const = 0;
-  virtual unique_ptr<vpoint<bool>> operator!() const = 0;
+  flat_region(const box<T, D> &b) : flat_region(region<T, D>(b)) {}
+  flat_region(const vector<box<T, D>> &bs) : flat_region(region<T, D>(bs)) {}
+  flat_region(const region<T, D> &r) {
+    append(r, coords, offsets);
+    assert(invariant());
+  }
+  operator region<T, D>() const { return extract(coords.data(), offsets.data()); }
+  explicit operator vector<box<T, D>>() const {
+    return vector<box<T, D>>(region<T, D>(*this));
+  }
 
-  // Assignment operators
-  virtual vpoint &operator+=(const vpoint &p) = 0;
-  virtual vpoint &operator-=(const vpoint &p) = 0;
-  virtual vpoint &operator*=(const vpoint &p) = 0;
-  virtual vpoint &operator/=(const vpoint &p) = 0;
-  virtual vpoint &operator%=(const vpoint &p) = 0;
-  virtual vpoint &operator&=(const vpoint &p) = 0;
-  virtual vpoint &operator|=(const vpoint &p) = 0;
-  virtual vpoint &operator^=(const vpoint &p) = 0;
+  void clear() {
+    coords.clear();
+    offsets.assign(header_size, 0);
+  }
+  void swap(flat_region &other) {
+    coords.swap(other.coords);
+    offsets.swap(other.offsets);
+  }
 
-  // Binary operators
-  virtual unique_ptr<vpoint> operator+(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator-(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator*(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator/(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator%(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator&(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator|(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint> operator^(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint<bool>> operator&&(const vpoint &p) const = 0;
-  virtual unique_ptr<vpoint<bool>> operator||(const vpoint &p) const = 0;
+  // Node layout
+  static size_t nentries(const size_t *offs) { return offs[0]; }
+  static size_t ncoords(const size_t *offs) { return offs[0]; }
+  static size_t noffsets(const size_t *offs) { return header_size; }
 
-  // Unary functions
-  virtual unique_ptr<vpoint> abs() const = 0;
+  static void append(const region<T, D> &r, vector<T> &rcoords,
+                     vector<size_t> &roffsets) {
+    roffsets.push_back(r.subregions.size());
+    rcoords.insert(rcoords.end(), r.subregions.begin(), r.subregions.end());
+  }
+
+  static region<T, D> extract(const T *crds, const size_t *offs) {
+    region<T, D> r;
+    r.subregions.assign(crds, crds + ncoords(offs));
+    return r;
+  }
+
+  template <typename F>
+  static void binary_operator(const F &op, const T *coords0,
+                              const size_t *offsets0, const T *coords1,
+                              const size_t *offsets1, vector<T> &rcoords,
+                              vector<size_t> &roffsets,
+                              flat_workspace<T, D> &ws) {
+    unsigned table = 0;
+    for (int s = 0; s < 4; ++s)
+      table |= unsigned(op(bool(s & 1), bool(s & 2))) << s;
+    const size_t n0 = ncoords(offsets0), n1 = ncoords(offsets1);
+    const size_t coords_begin = rcoords.size();
+    rcoords.resize(coords_begin + n0 + n1);
+    const size_t nres = detail::merge_boundaries(
+        table, coords0, n0, coords1, n1, rcoords.data() + coords_begin);
+    rcoords.resize(coords_begin + nres);
+    roffsets.push_back(nres);
+  }
+
+  template <typename F>
+  flat_region binary_operator(const F &op, const flat_region &other) const {
+    flat_region res;
+    res.offsets.clear();
+    flat_workspace<T, D> ws;
+    binary_operator(op, coords.data(), offsets.data(), other.coords.data(),
+                    other.offsets.data(), res.coords, res.offsets, ws);
+    assert(res.invariant());
+    return res;
+  }
+
+  template <typename F> void traverse_subregions(const F &f) const {
+    bool decoded_subregion = false;
+    for (const auto &pos : coords) {
+      decoded_subregion ^= true;
+      f(pos, decoded_subregion);
+    }
+    assert(!decoded_subregion);
+  }
+
+  // Invariant
+  bool invariant() const {
+    if (offsets.size() != header_size || ncoords(offsets.data()) != coords.size())
+      return false;
+#if REGIONCALCULUS_DEBUG
+    for (size_t i = 1; i < coords.size(); ++i)
+      if (coords[i] <= coords[i - 1])
+        return false;
+    if (coords.size() % 2 != 0)
+      return false;
+#endif
+    return true;
+  }
+
+  // Predicates
+  bool empty() const { return coords.empty(); }
+  typedef typename point<T, D>::prod_t prod_t;
+  prod_t size() const {
+    prod_t total_size = 0;
+    for (size_t i = 0; i < coords.size(); i += 2)
+      total_size += coords[i + 1] - coords[i];
+    return total_size;
+  }
+
+  // Set operations
+  flat_region operator^(const flat_region &other) const {
+    return binary_operator(detail::bool_xor(), other);
+  }
+  flat_region operator&(const flat_region &other) const {
+    return binary_operator(detail::bool_and(), other);
+  }
+  flat_region operator|(const flat_region &other) const {
+    return binary_operator(detail::bool_or(), other);
+  }
+  flat_region operator-(const flat_region &other) const {
+    return binary_operator(detail::bool_difference(), other);
+  }
+
+  flat_region &operator^=(const flat_region &other) {
+    return *this = *this ^ other;
+  }
+  flat_region &operator&=(const flat_region &other) {
+    return *this = *this & other;
+  }
+  flat_region &operator|=(const flat_region &other) {
+    return *this = *this | other;
+  }
+  flat_region &operator-=(const flat_region &other) {
+    return *this = *this - other;
+  }
+
+  // Comparison operators
+  bool operator<=(const flat_region &other) const {
+    return (*this - other).empty();
+  }
+  bool operator>=(const flat_region &other) const { return other <= *this; }
+  bool operator==(const flat_region &other) const {
+    return coords == other.coords;
+  }
+  bool operator!=(const flat_region &other) const { return !(*this == other); }
+  bool isdisjoint(const flat_region &other) const {
+    return (*this & other).empty();
+  }
+
+  // I/O
+  ostream &output(ostream &os) const { return region<T, D>(*this).output(os); }
+  friend ostream &operator<<(ostream &os, const flat_region &r) {
+    return r.output(os);
+  }
+};
+
+template <typename T, int D> struct flat_region {
+  typedef flat_region<T, D - 1> subregion_t;
+  constexpr static size_t header_size = 3;
+
+  vector<T> coords;
+  vector<size_t> offsets;
+
+  flat_region() : offsets(header_size, 0) {}
+  flat_region(const flat_region &) = default;
+  flat_region(flat_region &&) = default;
+  flat_region &operator=(const flat_region &) = default;
+  flat_region &operator=(flat_region &&) = default;
+
+  flat_region(const box<T, D> &b) : flat_region(region<T, D>(b)) {}
+  flat_region(const vector<box<T, D>> &bs) : flat_region(region<T, D>(bs)) {}
+  flat_region(const region<T, D> &r) {
+    append(r, coords, offsets);
+    assert(invariant());
+  }
+  operator region<T, D>() const { return extract(coords.data(), offsets.data()); }
+  explicit operator vector<box<T, D>>() const {
+    return vector<box<T, D>>(region<T, D>(*this));
+  }
+
+  void clear() {
+    coords.clear();
+    offsets.assign(header_size, 0);
+  }
+  void swap(flat_region &other) {
+    coords.swap(other.coords);
+    offsets.swap(other.offsets);
+  }
+
+  // Node layout
+  static size_t nentries(const size_t *offs) { return offs[0]; }
+  static size_t ncoords(const size_t *offs) { return offs[1]; }
+  static size_t noffsets(const size_t *offs) { return header_size + offs[2]; }
+
+  static void append(const region<T, D> &r, vector<T> &rcoords,
+                     vector<size_t> &roffsets) {
+    const size_t header = roffsets.size();
+    roffsets.resize(header + header_size);
+    const size_t coords_begin = rcoords.size();
+    const size_t offsets_begin = roffsets.size();
+    for (const auto &pos_subregion : r.subregions) {
+      rcoords.push_back(pos_subregion.first);
+      subregion_t::append(pos_subregion.second, rcoords, roffsets);
+    }
+    roffsets[header] = r.subregions.size();
+    roffsets[header + 1] = rcoords.size() - coords_begin;
+    roffsets[header + 2] = roffsets.size() - offsets_begin;
+  }
+
+  static region<T, D> extract(const T *crds, const size_t *offs) {
+    region<T, D> r;
+    const size_t n = nentries(offs);
+    r.subregions.reserve(n);
+    offs += header_size;
+    for (size_t i = 0; i < n; ++i) {
+      const T pos = *crds++;
+      r.subregions.emplace_back(make_pair(pos, subregion_t::extract(crds, offs)));
+      crds += subregion_t::ncoords(offs);
+      offs += subregion_t::noffsets(offs);
+    }
+    return r;
+  }
+
+  template <typename F>
+  static void binary_operator(const F &op, const T *coords0,
+                              const size_t *offsets0, const T *coords1,
+                              const size_t *offsets1, vector<T> &rcoords,
+                              vector<size_t> &roffsets,
+                              flat_workspace<T, D> &ws) {
+    const size_t header = roffsets.size();
+    roffsets.resize(header + header_size);
+    const size_t coords_begin = rcoords.size();
+    const size_t offsets_begin = roffsets.size();
+    size_t nentries_res = 0;
+
+    size_t n0 = nentries(offsets0), n1 = nentries(offsets1);
+    offsets0 += header_size;
+    offsets1 += header_size;
+    ws.decoded_subregion0.clear();
+    ws.decoded_subregion1.clear();
+    ws.old_decoded_subregion.clear();
+    while (n0 > 0 || n1 > 0) {
+      const bool active0 = n0 > 0 && (n1 == 0 || *coords0 <= *coords1);
+      const bool active1 = n1 > 0 && (n0 == 0 || *coords1 <= *coords0);
+      const T pos = active0 ? *coords0 : *coords1;
+      if (active0) {
+        ++coords0;
+        ws.tmp.coords.clear();
+        ws.tmp.offsets.clear();
+        subregion_t::binary_operator(
+            detail::bool_xor(), ws.decoded_subregion0.coords.data(),
+            ws.decoded_subregion0.offsets.data(), coords0, offsets0,
+            ws.tmp.coords, ws.tmp.offsets, ws.subworkspace);
+        ws.decoded_subregion0.swap(ws.tmp);
+        coords0 += subregion_t::ncoords(offsets0);
+        offsets0 += subregion_t::noffsets(offsets0);
+        --n0;
+      }
+      if (active1) {
+        ++coords1;
+        ws.tmp.coords.clear();
+        ws.tmp.offsets.clear();
+        subregion_t::binary_operator(
+            detail::bool_xor(), ws.decoded_subregion1.coords.data(),
+            ws.decoded_subregion1.offsets.data(), coords1, offsets1,
+            ws.tmp.coords, ws.tmp.offsets, ws.subworkspace);
+        ws.decoded_subregion1.swap(ws.tmp);
+        coords1 += subregion_t::ncoords(offsets1);
+        offsets1 += subregion_t::noffsets(offsets1);
+        --n1;
+      }
+
+      ws.decoded_subregion.coords.clear();
+      ws.decoded_subregion.offsets.clear();
+      subregion_t::binary_operator(
+          op, ws.decoded_subregion0.coords.data(),
+          ws.decoded_subregion0.offsets.data(),
+          ws.decoded_subregion1.coords.data(),
+          ws.decoded_subregion1.offsets.data(), ws.decoded_subregion.coords,
+          ws.decoded_subregion.offsets, ws.subworkspace);
+
+      // Append the change in the decoded subregion directly to the result,
+      // and remove it again if it is empty
+      const size_t old_ncoords = rcoords.size();
+      const size_t old_noffsets = roffsets.size();
+      rcoords.push_back(pos);
+      subregion_t::binary_operator(
+          detail::bool_xor(), ws.decoded_subregion.coords.data(),
+          ws.decoded_subregion.offsets.data(),
+          ws.old_decoded_subregion.coords.data(),
+          ws.old_decoded_subregion.offsets.data(), rcoords, roffsets,
+          ws.subworkspace);
+      if (subregion_t::nentries(roffsets.data() + old_noffsets) == 0) {
+        rcoords.resize(old_ncoords);
+        roffsets.resize(old_noffsets);
+      } else {
+        ++nentries_res;
+      }
+      ws.old_decoded_subregion.swap(ws.decoded_subregion);
+    }
+    assert(ws.old_decoded_subregion.empty());
+
+    roffsets[header] = nentries_res;
+    roffsets[header + 1] = rcoords.size() - coords_begin;
+    roffsets[header + 2] = roffsets.size() - offsets_begin;
+  }
+
+  template <typename F>
+  flat_region binary_operator(const F &op, const flat_region &other) const {
+    flat_region res;
+    res.offsets.clear();
+    flat_workspace<T, D> ws;
+    binary_operator(op, coords.data(), offsets.data(), other.coords.data(),
+                    other.offsets.data(), res.coords, res.offsets, ws);
+    assert(res.invariant());
+    return res;
+  }
+
+  template <typename F> void traverse_subregions(const F &f) const {
+    subregion_t decoded_subregion, tmp;
+    flat_workspace<T, D - 1> ws;
+    const T *crds = coords.data();
+    const size_t *offs = offsets.data();
+    const size_t n = nentries(offs);
+    offs += header_size;
+    for (size_t i = 0; i < n; ++i) {
+      const T pos = *crds++;
+      tmp.coords.clear();
+      tmp.offsets.clear();
+      subregion_t::binary_operator(
+          detail::bool_xor(), decoded_subregion.coords.data(),
+          decoded_subregion.offsets.data(), crds, offs, tmp.coords,
+          tmp.offsets, ws);
+      decoded_subregion.swap(tmp);
+      f(pos, decoded_subregion);
+      crds += subregion_t::ncoords(offs);
+      offs += subregion_t::noffsets(offs);
+    }
+    assert(decoded_subregion.empty());
+  }
+
+  // Invariant
+  bool invariant() const {
+    if (offsets.size() != noffsets(offsets.data()) ||
+        coords.size() != ncoords(offsets.data()))
+      return false;
+#if REGIONCALCULUS_DEBUG
+    if (!region<T, D>(*this).invariant())
+      return false;
+#endif
+    return true;
+  }
+
+  // Predicates
+  bool empty() const { return nentries(offsets.data()) == 0; }
+  typedef typename point<T, D>::prod_t prod_t;
+  prod_t size() const {
+    prod_t total_size = 0;
+    T old_pos = numeric_limits<T>::min();
+    prod_t old_subregion_size = 0;
+    traverse_subregions([&](const T pos, const subregion_t &subregion) {
+      const prod_t subregion_size = subregion.size();
+      total_size += old_subregion_size == 0
+                        ? 0
+                        : prod_t(pos - old_pos) * old_subregion_size;
+      old_pos = pos;
+      old_subregion_size = subregion_size;
+    });
+    assert(old_subregion_size == 0);
+    return total_size;
+  }
+
+  // Set operations
+  flat_region operator^(const flat_region &other) const {
+    return binary_operator(detail::bool_xor(), other);
+  }
+  flat_region operator&(const flat_region &other) const {
+    return binary_operator(detail::bool_and(), other);
+  }
+  flat_region operator|(const flat_region &other) const {
+    return binary_operator(detail::bool_or(), other);
+  }
+  flat_region operator-(const flat_region &other) const {
+    return binary_operator(detail::bool_difference(), other);
+  }
+
+  flat_region &operator^=(const flat_region &other) {
+    return *this = *this ^ other;
+  }
+  flat_region &operator&=(const flat_region &other) {
+    return *this = *this & other;
+  }
+  flat_region &operator|=(const flat_region &other) {
+    return *this = *this | other;
+  }
+  flat_region &operator-=(const flat_region &other) {
+    return *this = *this - other;
+  }
+
+  // Comparison operators
+  bool operator<=(const flat_region &other) const {
+    return (*this - other).empty();
+  }
+  bool operator>=(const flat_region &other) const { return other <= *this; }
+  bool operator==(const flat_region &other) const {
+    return coords == other.coords && offsets == other.offsets;
+  }
+  bool operator!=(const flat_region &other) const { return !(*this == other); }
+  bool isdisjoint(const flat_region &other) const {
+    return (*this & other).empty();
+  }
+
+  // I/O
+  ostream &output(ostream &os) const { return region<T, D>(*this).output(os); }
+  friend ostream &operator<<(ostream &os, const flat_region &r) {
+    return r.output(os);
+  }
+};
+} // namespace RegionCalculus
+
+#endif // #if REGIONCALCULUS_TREE
+
+////////////////////////////////////////////////////////////////////////////////
+// Region builder
+////////////////////////////////////////////////////////////////////////////////
+
+namespace RegionCalculus {
+
+// Accumulate the union of many boxes or regions. Boxes are collected in
+// batches, and each batch is converted to a region at once. Partial regions
+// are kept in a binary counter where level k holds about 2^k batches, so that
+// only regions of similar size are combined. This makes building a region
+// incrementally take O(n log n) set operations instead of O(n^2).
+template <typename T, int D> class region_builder {
+  size_t batch_size;
+  vector<box<T, D>> boxes;
+  vector<region<T, D>> levels;
+
+  void carry(region<T, D> reg) {
+    size_t k = 0;
+    for (; k < levels.size() && !levels[k].empty(); ++k) {
+      reg = levels[k] | reg;
+      levels[k] = region<T, D>();
+    }
+    if (k == levels.size())
+      levels.push_back(move(reg));
+    else
+      levels[k] = move(reg);
+  }
+
+  void flush() {
+    if (boxes.empty())
+      return;
+    carry(region<T, D>(boxes));
+    boxes.clear();
+  }
+
+public:
+  explicit region_builder(size_t batch_size = 1000) : batch_size(batch_size) {
+    assert(batch_size > 0);
+  }
+
+  void clear() {
+    boxes.clear();
+    levels.clear();
+  }
+
+  region_builder &operator|=(const box<T, D> &b) {
+    if (b.empty())
+      return *this;
+    boxes.push_back(b);
+    if (boxes.size() >= batch_size)
+      flush();
+    return *this;
+  }
+  region_builder &operator|=(const region<T, D> &r) {
+    if (!r.empty())
+      carry(r);
+    return *this;
+  }
+
+  // Combine all accumulated boxes and regions
+  region<T, D> build() {
+    flush();
+    region<T, D> reg;
+    for (auto &level : levels)
+      if (!level.empty())
+        reg = level | reg;
+    levels.clear();
+    if (!reg.empty())
+      levels.push_back(reg);
+    return reg;
+  }
+};
+} // namespace RegionCalculus
+
+////////////////////////////////////////////////////////////////////////////////
+// Dimension-independent wrappers
+////////////////////////////////////////////////////////////////////////////////
+
+namespace RegionCalculus {
+
+// Virtual classes
+
+template <typename T> struct vpoint {
+  virtual ~vpoint() {}
+
+  virtual unique_ptr<vpoint> copy() const = 0;
+
+  static unique_ptr<vpoint> make(int d);
+  static unique_ptr<vpoint> make(int d, T x);
+  static unique_ptr<vpoint> make(const vector<T> &val);
+  template <typename U> static unique_ptr<vpoint> make(const vector<U> &val);
+  virtual operator vector<T>() const = 0;
+  template <typename U> operator vector<U>() const {
+    auto rT(vector<T>(*this));
+    vector<U> rU(rT.size());
+    for (size_t i = 0; i < rU.size(); ++i)
+      rU[i] = U(move(rT[i]));
+    return rU;
+  }
+  template <typename U> static unique_ptr<vpoint> make(const vpoint<U> &p);
+
+  virtual int rank() const = 0;
+
+  // Access and conversion
+  virtual T operator[](int d) const = 0;
+  virtual T &operator[](int d) = 0;
+  virtual unique_ptr<vpoint> subpoint(int dir) const = 0;
+  virtual unique_ptr<vpoint> superpoint(int dir, T x) const = 0;
+  virtual unique_ptr<vpoint> reversed() const = 0;
+
+  // Unary operators
+  virtual unique_ptr<vpoint> operator+() const = 0;
+  virtual unique_ptr<vpoint> operator-() const = 0;
+  virtual unique_ptr<vpoint> operator~() const = 0;
+  virtual unique_ptr<vpoint<bool>> operator!() const = 0;
+
+  // Assignment operators
+  virtual vpoint &operator+=(const vpoint &p) = 0;
+  virtual vpoint &operator-=(const vpoint &p) = 0;
+  virtual vpoint &operator*=(const vpoint &p) = 0;
+  virtual vpoint &operator/=(const vpoint &p) = 0;
+  virtual vpoint &operator%=(const vpoint &p) = 0;
+  virtual vpoint &operator&=(const vpoint &p) = 0;
+  virtual vpoint &operator|=(const vpoint &p) = 0;
+  virtual vpoint &operator^=(const vpoint &p) = 0;
+
+  // Binary operators
+  virtual unique_ptr<vpoint> operator+(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator-(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator*(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator/(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator%(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator&(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator|(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint> operator^(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint<bool>> operator&&(const vpoint &p) const = 0;
+  virtual unique_ptr<vpoint<bool>> operator||(const vpoint &p) const = 0;
+
+  // Unary functions
+  virtual unique_ptr<vpoint> abs() const = 0;
 
   // Binary functions
   virtual unique_ptr<vpoint> min(const vpoint &p) const = 0;
@@ -3469,174 +4651,327 @@ unique_ptr<vregion<T>> vregion<T>::make(const YAML::Node &node) {
 
 // Dimension-independent classes (hiding the pointers)
 
+// Points and boxes are stored inline; only regions live on the heap.
+
 template <typename T> struct dpoint {
-  unique_ptr<vpoint<T>> val;
+  // Points of up to this rank are stored inline, without heap allocation
+  enum { max_rank = 4 };
 
-  dpoint() = default;
+private:
+  template <typename U> friend struct dpoint;
 
-  dpoint(const dpoint &p) {
-    if (p.val)
-      val = p.val->copy();
+  int m_rank; // negative for an invalid point
+  array<T, max_rank> m_elt;
+
+  template <typename R, typename F> dpoint<R> map(const F &f) const {
+    dpoint<R> r;
+    r.m_rank = rank();
+    for (int d = 0; d < m_rank; ++d)
+      r.m_elt[d] = f(m_elt[d]);
+    return r;
   }
-  dpoint(dpoint &&p) = default;
-  dpoint &operator=(const dpoint &p) {
-    if (p.val)
-      val = p.val->copy();
-    else
-      val = nullptr;
-    return *this;
+  template <typename R, typename F>
+  dpoint<R> map(const dpoint &p, const F &f) const {
+    assert(p.rank() == rank());
+    dpoint<R> r;
+    r.m_rank = m_rank;
+    for (int d = 0; d < m_rank; ++d)
+      r.m_elt[d] = f(m_elt[d], p.m_elt[d]);
+    return r;
   }
+
+public:
+  dpoint() : m_rank(-1) {}
+
+  dpoint(const dpoint &p) = default;
+  dpoint(dpoint &&p) = default;
+  dpoint &operator=(const dpoint &p) = default;
   dpoint &operator=(dpoint &&p) = default;
 
-  template <int D>
-  dpoint(const point<T, D> &p) : val(make_unique1<wpoint<T, D>>(p)) {}
-  dpoint(const vpoint<T> &p) : val(p.copy()) {}
-  dpoint(const unique_ptr<vpoint<T>> &val) {
+  template <int D> dpoint(const point<T, D> &p) : m_rank(D) {
+    static_assert(D <= max_rank, "");
+    for (int d = 0; d < D; ++d)
+      m_elt[d] = p[d];
+  }
+  dpoint(const vpoint<T> &p) : m_rank(p.rank()) {
+    assert(m_rank <= max_rank);
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = p[d];
+  }
+  dpoint(const unique_ptr<vpoint<T>> &val) : m_rank(-1) {
     if (val)
-      this->val = val->copy();
+      *this = dpoint(*val);
+  }
+  dpoint(unique_ptr<vpoint<T>> &&val) : m_rank(-1) {
+    if (val)
+      *this = dpoint(*val);
   }
-  dpoint(unique_ptr<vpoint<T>> &&val) : val(move(val)) {}
 
-  explicit dpoint(int d) : val(vpoint<T>::make(d)) {}
-  dpoint(int d, T x) : val(vpoint<T>::make(d, x)) {}
-  template <size_t D>
-  dpoint(const array<T, D> &p) : val(make_unique1<wpoint<T, D>>(p)) {}
+  explicit dpoint(int d) : dpoint(d, T(0)) {}
+  dpoint(int d, T x) : m_rank(d) {
+    assert(d >= 0 && d <= max_rank);
+    for (int i = 0; i < m_rank; ++i)
+      m_elt[i] = x;
+  }
+  template <size_t D> dpoint(const array<T, D> &p) : m_rank(D) {
+    static_assert(D <= max_rank, "");
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = p[d];
+  }
   template <typename U, size_t D>
-  explicit dpoint(const array<U, D> &p) : val(make_unique1<wpoint<T, D>>(p)) {}
-  dpoint(const vector<T> &p) : val(vpoint<T>::make(p)) {}
+  explicit dpoint(const array<U, D> &p) : m_rank(D) {
+    static_assert(D <= max_rank, "");
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = T(p[d]);
+  }
+  dpoint(const vector<T> &p) : m_rank(p.size()) {
+    assert(m_rank <= max_rank);
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = p[d];
+  }
   template <typename U>
-  explicit dpoint(const vector<U> &p) : val(vpoint<T>::make(p)) {}
-  operator vector<T>() const { return vector<T>(*val); }
+  explicit dpoint(const vector<U> &p) : m_rank(p.size()) {
+    assert(m_rank <= max_rank);
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = T(p[d]);
+  }
+  operator vector<T>() const {
+    return vector<T>(m_elt.begin(), m_elt.begin() + rank());
+  }
   template <typename U> explicit operator vector<U>() const {
-    return vector<U>(*val);
+    vector<U> r(rank());
+    for (int d = 0; d < m_rank; ++d)
+      r[d] = U(m_elt[d]);
+    return r;
   }
-  template <typename U> dpoint(const dpoint<U> &p) {
-    if (p.val)
-      val = vpoint<T>::make(*p.val);
+  template <typename U> dpoint(const dpoint<U> &p) : m_rank(p.m_rank) {
+    for (int d = 0; d < m_rank; ++d)
+      m_elt[d] = T(p.m_elt[d]);
   }
   template <int D> operator point<T, D>() const {
     assert(valid());
     assert(rank() == D);
-    return dynamic_cast<const RegionCalculus::wpoint<T, D> *>(val.get())->val;
+    point<T, D> r;
+    for (int d = 0; d < D; ++d)
+      r[d] = m_elt[d];
+    return r;
   }
 
-  bool valid() const { return bool(val); }
-  void reset() { val.reset(); }
-  int rank() const { return val->rank(); }
+  bool valid() const { return m_rank >= 0; }
+  void reset() { m_rank = -1; }
+  int rank() const {
+    assert(valid());
+    return m_rank;
+  }
 
   // Access and conversion
-  T operator[](int d) const { return (*val)[d]; }
-  T &operator[](int d) { return (*val)[d]; }
-  dpoint subpoint(int dir) const { return dpoint(val->subpoint(dir)); }
-  dpoint superpoint(int dir, T x) const { return dpoint(val->subpoint(dir)); }
-  dpoint reversed() const { return dpoint(val->reversed()); }
+  T operator[](int d) const {
+    assert(d >= 0 && d < rank());
+    return m_elt[d];
+  }
+  T &operator[](int d) {
+    assert(d >= 0 && d < rank());
+    return m_elt[d];
+  }
+  dpoint subpoint(int dir) const {
+    assert(dir >= 0 && dir < rank());
+    dpoint r;
+    r.m_rank = m_rank - 1;
+    for (int d = 0; d < r.m_rank; ++d)
+      r.m_elt[d] = m_elt[d + (d >= dir)];
+    return r;
+  }
+  dpoint superpoint(int dir, T x) const {
+    assert(rank() < max_rank);
+    assert(dir >= 0 && dir <= m_rank);
+    dpoint r;
+    r.m_rank = m_rank + 1;
+    for (int d = 0; d < m_rank; ++d)
+      r.m_elt[d + (d >= dir)] = m_elt[d];
+    r.m_elt[dir] = x;
+    return r;
+  }
+  dpoint reversed() const {
+    dpoint r;
+    r.m_rank = rank();
+    for (int d = 0; d < m_rank; ++d)
+      r.m_elt[d] = m_elt[m_rank - 1 - d];
+    return r;
+  }
 
   // Unary operators
-  dpoint operator+() const { return dpoint(+*val); }
-  dpoint operator-() const { return dpoint(-*val); }
-  dpoint operator~() const { return dpoint(~*val); }
-  dpoint<bool> operator!() const { return dpoint<bool>(!*val); }
+  dpoint operator+() const {
+    return map<T>([](T x) { return +x; });
+  }
+  dpoint operator-() const {
+    return map<T>([](T x) { return -x; });
+  }
+  dpoint operator~() const {
+    return map<T>([](T x) { return ~x; });
+  }
+  dpoint<bool> operator!() const {
+    return map<bool>([](T x) { return !x; });
+  }
 
   // Assignment operators
-  dpoint &operator+=(const dpoint &p) {
-    *val += *p.val;
-    return *this;
+  dpoint &operator+=(const dpoint &p) { return *this = *this + p; }
+  dpoint &operator-=(const dpoint &p) { return *this = *this - p; }
+  dpoint &operator*=(const dpoint &p) { return *this = *this * p; }
+  dpoint &operator/=(const dpoint &p) { return *this = *this / p; }
+  dpoint &operator%=(const dpoint &p) { return *this = *this % p; }
+  dpoint &operator&=(const dpoint &p) { return *this = *this & p; }
+  dpoint &operator|=(const dpoint &p) { return *this = *this | p; }
+  dpoint &operator^=(const dpoint &p) { return *this = *this ^ p; }
+
+  // Binary operators
+  dpoint operator+(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x + y; });
   }
-  dpoint &operator-=(const dpoint &p) {
-    *val -= *p.val;
-    return *this;
+  dpoint operator-(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x - y; });
   }
-  dpoint &operator*=(const dpoint &p) {
-    *val *= *p.val;
-    return *this;
+  dpoint operator*(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x * y; });
   }
-  dpoint &operator/=(const dpoint &p) {
-    *val /= *p.val;
-    return *this;
+  dpoint operator/(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x / y; });
   }
-  dpoint &operator%=(const dpoint &p) {
-    *val %= *p.val;
-    return *this;
+  dpoint operator%(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x % y; });
   }
-  dpoint &operator&=(const dpoint &p) {
-    *val &= *p.val;
-    return *this;
+  dpoint operator&(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x & y; });
   }
-  dpoint &operator|=(const dpoint &p) {
-    *val |= *p.val;
-    return *this;
+  dpoint operator|(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x | y; });
   }
-  dpoint &operator^=(const dpoint &p) {
-    *val ^= *p.val;
-    return *this;
+  dpoint operator^(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return x ^ y; });
   }
-
-  // Binary operators
-  dpoint operator+(const dpoint &p) const { return dpoint(*val + *p.val); }
-  dpoint operator-(const dpoint &p) const { return dpoint(*val - *p.val); }
-  dpoint operator*(const dpoint &p) const { return dpoint(*val * *p.val); }
-  dpoint operator/(const dpoint &p) const { return dpoint(*val / *p.val); }
-  dpoint operator%(const dpoint &p) const { return dpoint(*val % *p.val); }
-  dpoint operator&(const dpoint &p) const { return dpoint(*val & *p.val); }
-  dpoint operator|(const dpoint &p) const { return dpoint(*val | *p.val); }
-  dpoint operator^(const dpoint &p) const { return dpoint(*val ^ *p.val); }
   dpoint<bool> operator&&(const dpoint &p) const {
-    return dpoint<bool>(*val && *p.val);
+    return map<bool>(p, [](T x, T y) { return bool(x) && bool(y); });
   }
   dpoint<bool> operator||(const dpoint &p) const {
-    return dpoint<bool>(*val || *p.val);
+    return map<bool>(p, [](T x, T y) { return bool(x) || bool(y); });
   }
 
   // Unary functions
-  dpoint abs() const { return dpoint(val->abs()); }
+  dpoint abs() const {
+    return map<T>([](T x) { return detail::abs_wrapper(x); });
+  }
 
   // Binary functions
-  dpoint min(const dpoint &p) const { return dpoint(val->min(*p.val)); }
-  dpoint max(const dpoint &p) const { return dpoint(val->max(*p.val)); }
+  dpoint min(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return std::min(x, y); });
+  }
+  dpoint max(const dpoint &p) const {
+    return map<T>(p, [](T x, T y) { return std::max(x, y); });
+  }
 
   // Comparison operators
   dpoint<bool> operator==(const dpoint &p) const {
-    return dpoint<bool>(*val == *p.val);
+    return map<bool>(p, [](T x, T y) { return x == y; });
   }
   dpoint<bool> operator!=(const dpoint &p) const {
-    return dpoint<bool>(*val != *p.val);
+    return map<bool>(p, [](T x, T y) { return x != y; });
   }
   dpoint<bool> operator<(const dpoint &p) const {
-    return dpoint<bool>(*val < *p.val);
+    return map<bool>(p, [](T x, T y) { return x < y; });
   }
   dpoint<bool> operator>(const dpoint &p) const {
-    return dpoint<bool>(*val > *p.val);
+    return map<bool>(p, [](T x, T y) { return y < x; });
   }
   dpoint<bool> operator<=(const dpoint &p) const {
-    return dpoint<bool>(*val <= *p.val);
+    return map<bool>(p, [](T x, T y) { return !(y < x); });
   }
   dpoint<bool> operator>=(const dpoint &p) const {
-    return dpoint<bool>(*val >= *p.val);
+    return map<bool>(p, [](T x, T y) { return !(x < y); });
   }
 
-  bool equal_to(const dpoint &p) const { return val->equal_to(*p.val); }
-  bool less(const dpoint &p) const { return val->less(*p.val); }
-  size_t hash() const { return val->hash(); }
+  bool equal_to(const dpoint &p) const {
+    assert(p.rank() == rank());
+    std::equal_to<T> eq;
+    for (int d = 0; d < m_rank; ++d)
+      if (!eq(m_elt[d], p.m_elt[d]))
+        return false;
+    return true;
+  }
+  bool less(const dpoint &p) const {
+    assert(p.rank() == rank());
+    std::less<T> lt;
+    // Use Fortran array index ordering, as for point
+    for (int d = m_rank - 1; d >= 0; --d) {
+      if (lt(m_elt[d], p.m_elt[d]))
+        return true;
+      if (lt(p.m_elt[d], m_elt[d]))
+        return false;
+    }
+    return false;
+  }
+  size_t hash() const {
+    // This agrees with point::hash
+    size_t r = size_t(0xb89a122a8c3f540eULL);
+    for (int d = 0; d < rank(); ++d)
+      r = hash_combine(r, m_elt[d]);
+    return r;
+  }
 
   // Reductions
-  bool all() const { return val->all(); }
-  bool any() const { return val->any(); }
-  T minval() const { return val->minval(); }
-  T maxval() const { return val->maxval(); }
-  T sum() const { return val->sum(); }
-  typedef typename vpoint<T>::prod_t prod_t;
-  prod_t prod() const { return val->prod(); }
+  bool all() const {
+    bool r = true;
+    for (int d = 0; d < rank(); ++d)
+      r = r && m_elt[d];
+    return r;
+  }
+  bool any() const {
+    bool r = false;
+    for (int d = 0; d < rank(); ++d)
+      r = r || m_elt[d];
+    return r;
+  }
+  T minval() const {
+    T r = numeric_limits<T>::max();
+    for (int d = 0; d < rank(); ++d)
+      r = std::min(r, m_elt[d]);
+    return r;
+  }
+  T maxval() const {
+    T r = numeric_limits<T>::min();
+    for (int d = 0; d < rank(); ++d)
+      r = std::max(r, m_elt[d]);
+    return r;
+  }
+  T sum() const {
+    T r = T(0);
+    for (int d = 0; d < rank(); ++d)
+      r += m_elt[d];
+    return r;
+  }
+  typedef typename point<T, 0>::prod_t prod_t;
+  prod_t prod() const {
+    prod_t r = prod_t(1);
+    for (int d = 0; d < rank(); ++d)
+      r *= m_elt[d];
+    return r;
+  }
 
   // I/O
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
-  explicit dpoint(const YAML::Node &node) : val(vpoint<T>::make(node)) {}
+  explicit dpoint(const YAML::Node &node) : dpoint(node.as<vector<T>>()) {}
 #endif
 
   ostream &output(ostream &os) const {
-    if (!val)
+    if (!valid())
       return os << "dpoint()";
-    return val->output(os);
+    os << "[";
+    for (int d = 0; d < m_rank; ++d) {
+      if (d > 0)
+        os << ",";
+      os << m_elt[d];
+    }
+    os << "]";
+    return os;
   }
   friend ostream &operator<<(ostream &os, const dpoint &p) {
     return p.output(os);
@@ -3644,9 +4979,14 @@ template <typename T> struct dpoint {
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
   YAML::Emitter &output(YAML::Emitter &w) const {
-    if (!val)
-      return w << YAML::LocalTag("sio", "point-1.0.0");
-    return val->output(w);
+    w << YAML::LocalTag("sio", "point-1.0.0");
+    if (!valid())
+      return w;
+    w << YAML::Flow << YAML::BeginSeq;
+    for (int d = 0; d < m_rank; ++d)
+      w << m_elt[d];
+    w << YAML::EndSeq;
+    return w;
   }
   friend YAML::Emitter &operator<<(YAML::Emitter &w, const dpoint &p) {
     return p.output(w);
@@ -3699,98 +5039,177 @@ template <typename T> struct hash<RegionCalculus::dpoint<T>> {
 
 namespace RegionCalculus {
 template <typename T> struct dbox {
-  unique_ptr<vbox<T>> val;
+private:
+  template <typename U> friend struct dbox;
+
+  dpoint<T> m_lo, m_hi;
+  // Rank-0 boxes have no extent and are either full or empty
+  bool m_full;
 
-  dbox() = default;
+public:
+  dbox() : m_full(false) {}
 
-  dbox(const dbox &b) {
-    if (b.val)
-      val = b.val->copy();
-  }
+  dbox(const dbox &b) = default;
   dbox(dbox &&b) = default;
-  dbox &operator=(const dbox &b) {
-    if (b.val)
-      val = b.val->copy();
-    else
-      val = nullptr;
-    return *this;
-  }
+  dbox &operator=(const dbox &b) = default;
   dbox &operator=(dbox &&b) = default;
 
   template <int D>
-  dbox(const box<T, D> &b) : val(make_unique1<wbox<T, D>>(b)) {}
-  dbox(const vbox<T> &b) : val(b.copy()) {}
-  dbox(const unique_ptr<vbox<T>> &val) {
+  dbox(const box<T, D> &b)
+      : m_lo(b.lower()), m_hi(b.upper()), m_full(!b.empty()) {}
+  dbox(const vbox<T> &b) : m_full(false) {
+    switch (b.rank()) {
+    case 0:
+      *this = dbox(dynamic_cast<const wbox<T, 0> &>(b).val);
+      break;
+    case 1:
+      *this = dbox(dynamic_cast<const wbox<T, 1> &>(b).val);
+      break;
+    case 2:
+      *this = dbox(dynamic_cast<const wbox<T, 2> &>(b).val);
+      break;
+    case 3:
+      *this = dbox(dynamic_cast<const wbox<T, 3> &>(b).val);
+      break;
+    case 4:
+      *this = dbox(dynamic_cast<const wbox<T, 4> &>(b).val);
+      break;
+    default:
+      assert(0);
+    }
+  }
+  dbox(const unique_ptr<vbox<T>> &val) : m_full(false) {
     if (val)
-      this->val = val->copy();
+      *this = dbox(*val);
+  }
+  dbox(unique_ptr<vbox<T>> &&val) : m_full(false) {
+    if (val)
+      *this = dbox(*val);
   }
-  dbox(unique_ptr<vbox<T>> &&val) : val(move(val)) {}
 
-  explicit dbox(int d) : val(vbox<T>::make(d)) {}
+  explicit dbox(int d) : m_lo(d), m_hi(d), m_full(false) {}
   dbox(const dpoint<T> &lo, const dpoint<T> &hi)
-      : val(vbox<T>::make(*lo.val, *hi.val)) {}
-  template <typename U> dbox(const dbox<U> &p) {
-    if (p.val)
-      val = vbox<T>::make(*p.val);
+      : m_lo(lo), m_hi(hi), m_full(true) {
+    assert(lo.rank() == hi.rank());
   }
+  template <typename U>
+  dbox(const dbox<U> &b) : m_lo(b.m_lo), m_hi(b.m_hi), m_full(b.m_full) {}
   template <int D> operator box<T, D>() const {
     assert(valid());
     assert(rank() == D);
-    return dynamic_cast<const RegionCalculus::wbox<T, D> *>(val.get())->val;
+    if (D == 0 && empty())
+      return box<T, D>();
+    const point<T, D> lo = m_lo, hi = m_hi;
+    return box<T, D>(lo, hi);
   }
 
-  bool valid() const { return bool(val); }
-  void reset() { val.reset(); }
-  int rank() const { return val->rank(); }
+  bool valid() const { return m_lo.valid(); }
+  void reset() {
+    m_lo.reset();
+    m_hi.reset();
+    m_full = false;
+  }
+  int rank() const { return m_lo.rank(); }
 
   // Predicates
-  bool empty() const { return val->empty(); }
-  dpoint<T> lower() const { return dpoint<T>(val->lower()); }
-  dpoint<T> upper() const { return dpoint<T>(val->upper()); }
-  dpoint<T> shape() const { return dpoint<T>(val->shape()); }
-  typedef typename vbox<T>::prod_t prod_t;
-  prod_t size() const { return val->size(); }
+  bool empty() const {
+    if (rank() == 0)
+      return !m_full;
+    return any(m_hi <= m_lo);
+  }
+  dpoint<T> lower() const { return m_lo; }
+  dpoint<T> upper() const { return m_hi; }
+  dpoint<T> shape() const { return max(m_hi - m_lo, dpoint<T>(rank())); }
+  typedef typename box<T, 0>::prod_t prod_t;
+  prod_t size() const {
+    if (rank() == 0)
+      return m_full;
+    return prod(shape());
+  }
 
   // Shift and scale operators
   dbox &operator>>=(const dpoint<T> &p) {
-    *val >>= *p.val;
+    m_lo += p;
+    m_hi += p;
     return *this;
   }
   dbox &operator<<=(const dpoint<T> &p) {
-    *val <<= *p.val;
+    m_lo -= p;
+    m_hi -= p;
     return *this;
   }
   dbox &operator*=(const dpoint<T> &p) {
-    *val *= *p.val;
+    m_lo *= p;
+    m_hi *= p;
     return *this;
   }
-  dbox operator>>(const dpoint<T> &p) const { return dbox(*val >> *p.val); }
-  dbox operator<<(const dpoint<T> &p) const { return dbox(*val << *p.val); }
-  dbox operator*(const dpoint<T> &p) const { return dbox(*val * *p.val); }
+  dbox operator>>(const dpoint<T> &p) const { return dbox(*this) >>= p; }
+  dbox operator<<(const dpoint<T> &p) const { return dbox(*this) <<= p; }
+  dbox operator*(const dpoint<T> &p) const { return dbox(*this) *= p; }
   dbox grow(const dpoint<T> &dlo, const dpoint<T> &dup) const {
-    return dbox(val->grow(*dlo.val, *dup.val));
+    dbox nb(*this);
+    if (!empty()) {
+      nb.m_lo -= dlo;
+      nb.m_hi += dup;
+    }
+    return nb;
   }
-  dbox grow(const dpoint<T> &d) const { return dbox(val->grow(*d)); }
-  dbox grow(T n) const { return dbox(val->grow(n)); }
+  dbox grow(const dpoint<T> &d) const { return grow(d, d); }
+  dbox grow(T n) const { return grow(dpoint<T>(rank(), n)); }
   dbox shrink(const dpoint<T> &dlo, const dpoint<T> &dup) const {
-    return dbox(val->shrink(*dlo.val, *dup.val));
+    return grow(-dlo, -dup);
   }
-  dbox shrink(const dpoint<T> &d) const { return dbox(val->shrink(*d)); }
-  dbox shrink(T n) const { return dbox(val->shrink(n)); }
+  dbox shrink(const dpoint<T> &d) const { return shrink(d, d); }
+  dbox shrink(T n) const { return shrink(dpoint<T>(rank(), n)); }
 
   // Comparison operators
-  bool operator==(const dbox &b) const { return *val == *b.val; }
+  bool operator==(const dbox &b) const { return equal_to(b); }
   bool operator!=(const dbox &b) const { return !(*this == b); }
-  bool equal_to(const dbox &b) const { return val->equal_to(*b.val); }
-  bool less(const dbox &b) const { return val->less(*b.val); }
-  size_t hash() const { return val->hash(); }
+  bool equal_to(const dbox &b) const {
+    assert(b.rank() == rank());
+    if (empty() && b.empty())
+      return true;
+    if (empty() || b.empty())
+      return false;
+    return m_lo.equal_to(b.m_lo) && m_hi.equal_to(b.m_hi);
+  }
+  bool less(const dbox &b) const {
+    assert(b.rank() == rank());
+    // Empty boxes are less than non-empty ones
+    if (b.empty())
+      return false;
+    if (empty())
+      return true;
+    if (m_lo.less(b.m_lo))
+      return true;
+    if (b.m_lo.less(m_lo))
+      return false;
+    return m_hi.less(b.m_hi);
+  }
+  size_t hash() const {
+    // This agrees with box::hash
+    if (rank() == 0)
+      return std::hash<bool>()(m_full) ^ size_t(0x4a473053c081f0efULL);
+    return hash_combine(hash_combine(size_t(0x8ba458a873481993ULL), m_lo),
+                        m_hi);
+  }
 
   // Set comparison operators
-  bool contains(const dpoint<T> &p) const { return val->contains(*p.val); }
-  bool isdisjoint(const dbox &b) const { return val->isdisjoint(*b.val); }
-  bool operator<=(const dbox &b) const { return *val <= *b.val; }
+  bool contains(const dpoint<T> &p) const {
+    if (empty())
+      return false;
+    return all(p >= m_lo && p < m_hi);
+  }
+  bool isdisjoint(const dbox &b) const { return (*this & b).empty(); }
+  bool operator<=(const dbox &b) const {
+    if (empty())
+      return true;
+    if (b.empty())
+      return false;
+    return all(m_lo >= b.m_lo && m_hi <= b.m_hi);
+  }
   bool operator>=(const dbox &b) const { return b <= *this; }
-  bool operator<(const dbox &b) const { return *val < *b.val; }
+  bool operator<(const dbox &b) const { return *this <= b && *this != b; }
   bool operator>(const dbox &b) const { return b < *this; }
   bool issubset(const dbox &b) const { return *this <= b; }
   bool issuperset(const dbox &b) const { return *this >= b; }
@@ -3799,9 +5218,17 @@ template <typename T> struct dbox {
 
   // Set operations
   dbox bounding_box(const dbox &b) const {
-    return dbox(val->bounding_box(*b.val));
+    if (empty())
+      return b;
+    if (b.empty())
+      return *this;
+    return dbox(min(m_lo, b.m_lo), max(m_hi, b.m_hi));
+  }
+  dbox operator&(const dbox &b) const {
+    dbox r(max(m_lo, b.m_lo), min(m_hi, b.m_hi));
+    r.m_full = m_full && b.m_full;
+    return r;
   }
-  dbox operator&(const dbox &b) const { return dbox(*val & *b.val); }
   // dbox operator-(const dbox &b) const { return dbox(*val - *b.val); }
   // dbox operator|(const dbox &b) const { return dbox(*val | *b.val); }
   // dbox operator^(const dbox &b) const { return dbox(*val ^ *b.val); }
@@ -3813,13 +5240,24 @@ template <typename T> struct dbox {
   // I/O
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
-  explicit dbox(const YAML::Node &node) : val(vbox<T>::make(node)) {}
+  explicit dbox(const YAML::Node &node) : m_full(false) {
+    const auto &full = node["full"];
+    if (full.IsDefined()) {
+      *this = dbox(box<T, 0>(full.as<bool>()));
+    } else {
+      m_lo = dpoint<T>(node["low"]);
+      m_hi = dpoint<T>(node["high"]);
+      m_full = true;
+    }
+  }
 #endif
 
   ostream &output(ostream &os) const {
-    if (!val)
+    if (!valid())
       return os << "dbox()";
-    return val->output(os);
+    if (rank() == 0)
+      return os << "(" << m_full << ")";
+    return os << "(" << m_lo << ":" << m_hi << ")";
   }
   friend ostream &operator<<(ostream &os, const dbox &b) {
     return b.output(os);
@@ -3827,9 +5265,18 @@ template <typename T> struct dbox {
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
   YAML::Emitter &output(YAML::Emitter &w) const {
-    if (!val)
-      return w << YAML::LocalTag("sio", "box-1.0.0");
-    return val->output(w);
+    w << YAML::LocalTag("sio", "box-1.0.0");
+    if (!valid())
+      return w;
+    w << YAML::Flow << YAML::BeginMap;
+    if (rank() == 0) {
+      w << YAML::Key << "full" << YAML::Value << m_full;
+    } else {
+      w << YAML::Key << "low" << YAML::Value << m_lo;
+      w << YAML::Key << "high" << YAML::Value << m_hi;
+    }
+    w << YAML::EndMap;
+    return w;
   }
   friend YAML::Emitter &operator<<(YAML::Emitter &w, const dbox &b) {
     return b.output(w);
@@ -3857,9 +5304,108 @@ template <typename T> struct hash<RegionCalculus::dbox<T>> {
 } // namespace std
 
 namespace RegionCalculus {
+namespace detail {
+// A wpoint or wbox of any rank, constructed in place. This passes dpoint and
+// dbox to the virtual vregion interface without allocating.
+template <typename T> class vpoint_ref {
+  typename std::aligned_storage<sizeof(wpoint<T, 4>),
+                                alignof(wpoint<T, 4>)>::type m_storage;
+  vpoint<T> *m_ptr;
+
+  template <int D> void emplace(const dpoint<T> &p) {
+    const point<T, D> q = p;
+    m_ptr = new (&m_storage) wpoint<T, D>(q);
+  }
+
+public:
+  vpoint_ref(const dpoint<T> &p) {
+    switch (p.rank()) {
+    case 0:
+      emplace<0>(p);
+      break;
+    case 1:
+      emplace<1>(p);
+      break;
+    case 2:
+      emplace<2>(p);
+      break;
+    case 3:
+      emplace<3>(p);
+      break;
+    case 4:
+      emplace<4>(p);
+      break;
+    default:
+      assert(0);
+    }
+  }
+  vpoint_ref(const vpoint_ref &) = delete;
+  vpoint_ref &operator=(const vpoint_ref &) = delete;
+  ~vpoint_ref() { m_ptr->~vpoint<T>(); }
+  operator const vpoint<T> &() const { return *m_ptr; }
+};
+
+template <typename T> class vbox_ref {
+  typename std::aligned_storage<sizeof(wbox<T, 4>), alignof(wbox<T, 4>)>::type
+      m_storage;
+  vbox<T> *m_ptr;
+
+  template <int D> void emplace(const dbox<T> &b) {
+    const box<T, D> c = b;
+    m_ptr = new (&m_storage) wbox<T, D>(c);
+  }
+
+public:
+  vbox_ref(const dbox<T> &b) {
+    switch (b.rank()) {
+    case 0:
+      emplace<0>(b);
+      break;
+    case 1:
+      emplace<1>(b);
+      break;
+    case 2:
+      emplace<2>(b);
+      break;
+    case 3:
+      emplace<3>(b);
+      break;
+    case 4:
+      emplace<4>(b);
+      break;
+    default:
+      assert(0);
+    }
+  }
+  vbox_ref(const vbox_ref &) = delete;
+  vbox_ref &operator=(const vbox_ref &) = delete;
+  ~vbox_ref() { m_ptr->~vbox<T>(); }
+  operator const vbox<T> &() const { return *m_ptr; }
+};
+} // namespace detail
+
 template <typename T> struct dregion {
   unique_ptr<vregion<T>> val;
 
+private:
+  // Convert boxes directly, without going through vbox
+  template <int D>
+  static unique_ptr<vregion<T>> make_from_boxes(const vector<dbox<T>> &bs) {
+    vector<box<T, D>> rs;
+    rs.reserve(bs.size());
+    for (const auto &b : bs)
+      rs.push_back(box<T, D>(b));
+    return make_unique1<wregion<T, D>>(region<T, D>(rs));
+  }
+  template <int D> vector<dbox<T>> boxes(decomposition mode) const {
+    const auto &r = dynamic_cast<const wregion<T, D> &>(*val).val;
+    vector<dbox<T>> rs;
+    for (const auto &b : r.decompose(mode))
+      rs.push_back(dbox<T>(b));
+    return rs;
+  }
+
+public:
   dregion() = default;
 
   dregion(const dregion &r) {
@@ -3886,25 +5432,48 @@ template <typename T> struct dregion {
   dregion(unique_ptr<vregion<T>> &&val) : val(move(val)) {}
 
   explicit dregion(int d) : val(vregion<T>::make(d)) {}
-  dregion(const dbox<T> &b) : val(vregion<T>::make(*b.val)) {}
+  dregion(const dbox<T> &b)
+      : val(vregion<T>::make(detail::vbox_ref<T>(b))) {}
   dregion(const vector<dbox<T>> &bs) {
-    vector<unique_ptr<vbox<T>>> rs;
-    for (const auto &b : bs)
-      rs.push_back(b.val->copy());
-    val = vregion<T>::make(move(rs));
-  }
-  dregion(vector<dbox<T>> &&bs) {
-    vector<unique_ptr<vbox<T>>> rs;
-    for (auto &b : bs)
-      rs.push_back(move(b.val));
-    val = vregion<T>::make(move(rs));
+    if (bs.empty())
+      // Cannot determine rank
+      return;
+    switch (bs[0].rank()) {
+    case 0:
+      val = make_from_boxes<0>(bs);
+      break;
+    case 1:
+      val = make_from_boxes<1>(bs);
+      break;
+    case 2:
+      val = make_from_boxes<2>(bs);
+      break;
+    case 3:
+      val = make_from_boxes<3>(bs);
+      break;
+    case 4:
+      val = make_from_boxes<4>(bs);
+      break;
+    default:
+      assert(0);
+    }
   }
-  operator vector<dbox<T>>() const {
-    vector<unique_ptr<vbox<T>>> bs(*val);
-    vector<dbox<T>> rs;
-    for (auto &b : bs)
-      rs.push_back(dbox<T>(move(b)));
-    return rs;
+  operator vector<dbox<T>>() const { return decompose(decomposition::sweep); }
+  vector<dbox<T>> decompose(decomposition mode) const {
+    switch (rank()) {
+    case 0:
+      return boxes<0>(mode);
+    case 1:
+      return boxes<1>(mode);
+    case 2:
+      return boxes<2>(mode);
+    case 3:
+      return boxes<3>(mode);
+    case 4:
+      return boxes<4>(mode);
+    default:
+      assert(0);
+    }
   }
   template <typename U> dregion(const dregion<U> &p) {
     if (p.val)
@@ -3928,33 +5497,45 @@ template <typename T> struct dregion {
 
   // Shift and scale operators
   dregion operator>>(const dpoint<T> &d) const {
-    return dregion(*val >> *d.val);
+    return dregion(*val >> detail::vpoint_ref<T>(d));
   }
   dregion operator<<(const dpoint<T> &d) const {
-    return dregion(*val << *d.val);
+    return dregion(*val << detail::vpoint_ref<T>(d));
   }
   dregion grow(const dpoint<T> &dlo, const dpoint<T> &dup) const {
-    return dregion(val->grow(*dlo, *dup));
+    return dregion(
+        val->grow(detail::vpoint_ref<T>(dlo), detail::vpoint_ref<T>(dup)));
+  }
+  dregion grow(const dpoint<T> &d) const {
+    return dregion(val->grow(detail::vpoint_ref<T>(d)));
   }
-  dregion grow(const dpoint<T> &d) const { return dregion(val->grow(*d.val)); }
   dregion grow(T n) const { return dregion(val->grow(n)); }
   dregion shrink(const dpoint<T> &dlo, const dpoint<T> &dup) const {
-    return dregion(val->shrink(*dlo.val, *dup.val));
+    return dregion(
+        val->shrink(detail::vpoint_ref<T>(dlo), detail::vpoint_ref<T>(dup)));
   }
   dregion shrink(const dpoint<T> &d) const {
-    return dregion(val->shrink(*d.val));
+    return dregion(val->shrink(detail::vpoint_ref<T>(d)));
   }
   dregion shrink(T n) const { return dregion(val->shrink(n)); }
 
   // Set operations
   dbox<T> bounding_box() const { return dbox<T>(val->bounding_box()); }
-  dregion operator&(const dbox<T> &b) const { return dregion(*val & *b.val); }
+  dregion operator&(const dbox<T> &b) const {
+    return dregion(*val & detail::vbox_ref<T>(b));
+  }
   dregion operator&(const dregion &r) const { return dregion(*val & *r.val); }
-  dregion operator-(const dbox<T> &b) const { return dregion(*val - *b.val); }
+  dregion operator-(const dbox<T> &b) const {
+    return dregion(*val - detail::vbox_ref<T>(b));
+  }
   dregion operator-(const dregion &r) const { return dregion(*val - *r.val); }
-  dregion operator|(const dbox<T> &b) const { return dregion(*val | *b.val); }
+  dregion operator|(const dbox<T> &b) const {
+    return dregion(*val | detail::vbox_ref<T>(b));
+  }
   dregion operator|(const dregion &r) const { return dregion(*val | *r.val); }
-  dregion operator^(const dbox<T> &b) const { return dregion(*val ^ *b.val); }
+  dregion operator^(const dbox<T> &b) const {
+    return dregion(*val ^ detail::vbox_ref<T>(b));
+  }
   dregion operator^(const dregion &r) const { return dregion(*val ^ *r.val); }
 
   dregion &operator^=(const dregion &other) { return *this = *this ^ other; }
@@ -3972,8 +5553,12 @@ template <typename T> struct dregion {
   dregion symmetric_difference(const dregion &r) const { return *this ^ r; }
 
   // Set comparison operators
-  bool contains(const dpoint<T> &p) const { return val->contains(*p.val); }
-  bool isdisjoint(const dbox<T> &b) const { return val->isdisjoint(*b.val); }
+  bool contains(const dpoint<T> &p) const {
+    return val->contains(detail::vpoint_ref<T>(p));
+  }
+  bool isdisjoint(const dbox<T> &b) const {
+    return val->isdisjoint(detail::vbox_ref<T>(b));
+  }
   bool isdisjoint(const dregion &r) const { return val->isdisjoint(*r.val); }
 
   // Comparison operators
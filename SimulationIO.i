@@ -303,7 +303,7 @@ struct TensorType;
 %nodefaultctor;
 
 struct WriteOptions {
-  enum class compression_method_t { bzip2, szip, zlib };
+  enum class compression_method_t { bzip2, szip, zlib, lz4 };
 
   bool chunk;
   bool compress;
@@ -311,8 +311,15 @@ struct WriteOptions {
   int compression_level;
   bool shuffle;
   bool checksum;
+  bool parallel_filters;
+
+  enum class access_pattern_t { block, slice, point };
+  access_pattern_t access_pattern;
+  int slice_dir;
+  long long chunk_bytes;
 
   WriteOptions();
+  point_t chunk_shape(const point_t &shape, long long type_size) const;
 };
 
 struct DataBlock {
@@ -326,6 +333,20 @@ struct DataBlock {
 struct DataRange: DataBlock {
   double origin() const;
   std::vector<double> delta() const;
+  %extend {
+    std::vector<int> readData_int(const box_t& databox) const {
+      return self->readData<int>(databox);
+    }
+    std::vector<double> readData_double(const box_t& databox) const {
+      return self->readData<double>(databox);
+    }
+    std::vector<int> readData_int() const {
+      return self->readData<int>();
+    }
+    std::vector<double> readData_double() const {
+      return self->readData<double>();
+    }
+  }
 };
 
 #ifdef SIMULATIONIO_HAVE_HDF5
@@ -362,6 +383,8 @@ struct DataSet: DataBlock {
 
 struct CopyObj: DataBlock {
   string name() const;
+  WriteOptions::access_pattern_t access_pattern() const;
+  void setAccessPattern(WriteOptions::access_pattern_t access_pattern);
   %extend {
     std::vector<int> readData_int(const box_t& databox) const {
       return self->readData<int>(databox);
@@ -381,6 +404,20 @@ struct CopyObj: DataBlock {
 struct ExtLink: DataBlock {
   string filename() const;
   string objname() const;
+  %extend {
+    std::vector<int> readData_int(const box_t& databox) const {
+      return self->readData<int>(databox);
+    }
+    std::vector<double> readData_double(const box_t& databox) const {
+      return self->readData<double>(databox);
+    }
+    std::vector<int> readData_int() const {
+      return self->readData<int>();
+    }
+    std::vector<double> readData_double() const {
+      return self->readData<double>();
+    }
+  }
 };
 
 #endif
@@ -0,0 +1,44 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/Basis.cpp" "CMakeFiles/SimulationIO.dir/Basis.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Basis.cpp.o.d"
+  "/root/repo/BasisVector.cpp" "CMakeFiles/SimulationIO.dir/BasisVector.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/BasisVector.cpp.o.d"
+  "/root/repo/Buffer.cpp" "CMakeFiles/SimulationIO.dir/Buffer.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Buffer.cpp.o.d"
+  "/root/repo/Common.cpp" "CMakeFiles/SimulationIO.dir/Common.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Common.cpp.o.d"
+  "/root/repo/Config.cpp" "CMakeFiles/SimulationIO.dir/Config.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Config.cpp.o.d"
+  "/root/repo/Configuration.cpp" "CMakeFiles/SimulationIO.dir/Configuration.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Configuration.cpp.o.d"
+  "/root/repo/CoordinateField.cpp" "CMakeFiles/SimulationIO.dir/CoordinateField.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/CoordinateField.cpp.o.d"
+  "/root/repo/CoordinateSystem.cpp" "CMakeFiles/SimulationIO.dir/CoordinateSystem.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/CoordinateSystem.cpp.o.d"
+  "/root/repo/DataBlock.cpp" "CMakeFiles/SimulationIO.dir/DataBlock.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/DataBlock.cpp.o.d"
+  "/root/repo/DiscreteField.cpp" "CMakeFiles/SimulationIO.dir/DiscreteField.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/DiscreteField.cpp.o.d"
+  "/root/repo/DiscreteFieldBlock.cpp" "CMakeFiles/SimulationIO.dir/DiscreteFieldBlock.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/DiscreteFieldBlock.cpp.o.d"
+  "/root/repo/DiscreteFieldBlockComponent.cpp" "CMakeFiles/SimulationIO.dir/DiscreteFieldBlockComponent.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/DiscreteFieldBlockComponent.cpp.o.d"
+  "/root/repo/Discretization.cpp" "CMakeFiles/SimulationIO.dir/Discretization.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Discretization.cpp.o.d"
+  "/root/repo/DiscretizationBlock.cpp" "CMakeFiles/SimulationIO.dir/DiscretizationBlock.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/DiscretizationBlock.cpp.o.d"
+  "/root/repo/Field.cpp" "CMakeFiles/SimulationIO.dir/Field.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Field.cpp.o.d"
+  "/root/repo/H5Filters.cpp" "CMakeFiles/SimulationIO.dir/H5Filters.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/H5Filters.cpp.o.d"
+  "/root/repo/H5Helpers.cpp" "CMakeFiles/SimulationIO.dir/H5Helpers.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/H5Helpers.cpp.o.d"
+  "/root/repo/Helpers.cpp" "CMakeFiles/SimulationIO.dir/Helpers.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Helpers.cpp.o.d"
+  "/root/repo/Manifold.cpp" "CMakeFiles/SimulationIO.dir/Manifold.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Manifold.cpp.o.d"
+  "/root/repo/Parameter.cpp" "CMakeFiles/SimulationIO.dir/Parameter.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Parameter.cpp.o.d"
+  "/root/repo/ParameterValue.cpp" "CMakeFiles/SimulationIO.dir/ParameterValue.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/ParameterValue.cpp.o.d"
+  "/root/repo/Project.cpp" "CMakeFiles/SimulationIO.dir/Project.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/Project.cpp.o.d"
+  "/root/repo/SubDiscretization.cpp" "CMakeFiles/SimulationIO.dir/SubDiscretization.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/SubDiscretization.cpp.o.d"
+  "/root/repo/TangentSpace.cpp" "CMakeFiles/SimulationIO.dir/TangentSpace.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/TangentSpace.cpp.o.d"
+  "/root/repo/TensorComponent.cpp" "CMakeFiles/SimulationIO.dir/TensorComponent.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/TensorComponent.cpp.o.d"
+  "/root/repo/TensorType.cpp" "CMakeFiles/SimulationIO.dir/TensorType.cpp.o" "gcc" "CMakeFiles/SimulationIO.dir/TensorType.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,61 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/SimulationIO.dir/Basis.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Basis.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/BasisVector.cpp.o"
+  "CMakeFiles/SimulationIO.dir/BasisVector.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Buffer.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Buffer.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Common.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Common.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Config.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Config.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Configuration.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Configuration.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/CoordinateField.cpp.o"
+  "CMakeFiles/SimulationIO.dir/CoordinateField.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/CoordinateSystem.cpp.o"
+  "CMakeFiles/SimulationIO.dir/CoordinateSystem.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/DataBlock.cpp.o"
+  "CMakeFiles/SimulationIO.dir/DataBlock.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/DiscreteField.cpp.o"
+  "CMakeFiles/SimulationIO.dir/DiscreteField.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/DiscreteFieldBlock.cpp.o"
+  "CMakeFiles/SimulationIO.dir/DiscreteFieldBlock.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/DiscreteFieldBlockComponent.cpp.o"
+  "CMakeFiles/SimulationIO.dir/DiscreteFieldBlockComponent.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Discretization.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Discretization.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/DiscretizationBlock.cpp.o"
+  "CMakeFiles/SimulationIO.dir/DiscretizationBlock.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Field.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Field.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/H5Filters.cpp.o"
+  "CMakeFiles/SimulationIO.dir/H5Filters.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/H5Helpers.cpp.o"
+  "CMakeFiles/SimulationIO.dir/H5Helpers.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Helpers.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Helpers.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Manifold.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Manifold.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Parameter.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Parameter.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/ParameterValue.cpp.o"
+  "CMakeFiles/SimulationIO.dir/ParameterValue.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/Project.cpp.o"
+  "CMakeFiles/SimulationIO.dir/Project.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/SubDiscretization.cpp.o"
+  "CMakeFiles/SimulationIO.dir/SubDiscretization.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/TangentSpace.cpp.o"
+  "CMakeFiles/SimulationIO.dir/TangentSpace.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/TensorComponent.cpp.o"
+  "CMakeFiles/SimulationIO.dir/TensorComponent.cpp.o.d"
+  "CMakeFiles/SimulationIO.dir/TensorType.cpp.o"
+  "CMakeFiles/SimulationIO.dir/TensorType.cpp.o.d"
+  "libSimulationIO.a"
+  "libSimulationIO.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/SimulationIO.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-bench-chunking.dir/bench-chunking.cpp.o"
+  "CMakeFiles/sio-bench-chunking.dir/bench-chunking.cpp.o.d"
+  "sio-bench-chunking"
+  "sio-bench-chunking.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-bench-chunking.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-bench-regioncalculus.dir/bench-regioncalculus.cpp.o"
+  "CMakeFiles/sio-bench-regioncalculus.dir/bench-regioncalculus.cpp.o.d"
+  "sio-bench-regioncalculus"
+  "sio-bench-regioncalculus.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-bench-regioncalculus.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
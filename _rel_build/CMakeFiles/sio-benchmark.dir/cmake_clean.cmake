@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-benchmark.dir/benchmark.cpp.o"
+  "CMakeFiles/sio-benchmark.dir/benchmark.cpp.o.d"
+  "sio-benchmark"
+  "sio-benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-convert-carpet-output.dir/convert-carpet-output.cpp.o"
+  "CMakeFiles/sio-convert-carpet-output.dir/convert-carpet-output.cpp.o.d"
+  "sio-convert-carpet-output"
+  "sio-convert-carpet-output.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-convert-carpet-output.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-convert-to-carpet.dir/convert-to-carpet.cpp.o"
+  "CMakeFiles/sio-convert-to-carpet.dir/convert-to-carpet.cpp.o.d"
+  "sio-convert-to-carpet"
+  "sio-convert-to-carpet.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-convert-to-carpet.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-copy.dir/copy.cpp.o"
+  "CMakeFiles/sio-copy.dir/copy.cpp.o.d"
+  "sio-copy"
+  "sio-copy.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-copy.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
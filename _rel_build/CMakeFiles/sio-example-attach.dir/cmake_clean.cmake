@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-example-attach.dir/example-attach.cpp.o"
+  "CMakeFiles/sio-example-attach.dir/example-attach.cpp.o.d"
+  "sio-example-attach"
+  "sio-example-attach.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-example-attach.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
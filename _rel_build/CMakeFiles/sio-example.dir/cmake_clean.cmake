@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-example.dir/example.cpp.o"
+  "CMakeFiles/sio-example.dir/example.cpp.o.d"
+  "sio-example"
+  "sio-example.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-example.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-filter.dir/filter.cpp.o"
+  "CMakeFiles/sio-filter.dir/filter.cpp.o.d"
+  "sio-filter"
+  "sio-filter.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-filter.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
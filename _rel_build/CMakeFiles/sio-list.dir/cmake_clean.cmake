@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-list.dir/list.cpp.o"
+  "CMakeFiles/sio-list.dir/list.cpp.o.d"
+  "sio-list"
+  "sio-list.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-list.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
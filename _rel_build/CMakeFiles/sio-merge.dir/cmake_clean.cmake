@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sio-merge.dir/merge.cpp.o"
+  "CMakeFiles/sio-merge.dir/merge.cpp.o.d"
+  "sio-merge"
+  "sio-merge.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sio-merge.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
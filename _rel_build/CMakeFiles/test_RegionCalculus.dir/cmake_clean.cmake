@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_RegionCalculus.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o"
+  "CMakeFiles/test_RegionCalculus.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o.d"
+  "CMakeFiles/test_RegionCalculus.dir/test_RegionCalculus.cpp.o"
+  "CMakeFiles/test_RegionCalculus.dir/test_RegionCalculus.cpp.o.d"
+  "test_RegionCalculus"
+  "test_RegionCalculus.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_RegionCalculus.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
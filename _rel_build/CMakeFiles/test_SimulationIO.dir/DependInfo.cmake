@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/googletest-release-1.8.0/googletest/src/gtest-all.cc" "CMakeFiles/test_SimulationIO.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o" "gcc" "CMakeFiles/test_SimulationIO.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o.d"
+  "/root/repo/test_SimulationIO.cpp" "CMakeFiles/test_SimulationIO.dir/test_SimulationIO.cpp.o" "gcc" "CMakeFiles/test_SimulationIO.dir/test_SimulationIO.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_rel_build/CMakeFiles/SimulationIO.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_SimulationIO.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o"
+  "CMakeFiles/test_SimulationIO.dir/googletest-release-1.8.0/googletest/src/gtest-all.cc.o.d"
+  "CMakeFiles/test_SimulationIO.dir/test_SimulationIO.cpp.o"
+  "CMakeFiles/test_SimulationIO.dir/test_SimulationIO.cpp.o.d"
+  "test_SimulationIO"
+  "test_SimulationIO.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_SimulationIO.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,26 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_rel_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(test_RegionCalculus "./test_RegionCalculus")
+set_tests_properties(test_RegionCalculus PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;354;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(test_SimulationIO "./test_SimulationIO")
+set_tests_properties(test_SimulationIO PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;355;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(bench-regioncalculus "./sio-bench-regioncalculus" "--repeat=1" "--nboxes=100")
+set_tests_properties(bench-regioncalculus PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;356;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(bench-chunking "./sio-bench-chunking" "--repeat=1" "--size=32" "--npoints=10" "--chunk-bytes=0,65536")
+set_tests_properties(bench-chunking PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;359;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(example "./sio-example")
+set_tests_properties(example PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;362;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(list "./sio-list" "example.s5")
+set_tests_properties(list PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;363;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(example-attach "./sio-example-attach")
+set_tests_properties(example-attach PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;364;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(list-attach "./sio-list" "example-attach.s5")
+set_tests_properties(list-attach PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;365;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(copy "./sio-copy" "example.s5" "example2.s5")
+set_tests_properties(copy PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;366;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(list2 "./sio-list" "example2.s5")
+set_tests_properties(list2 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;367;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,67 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <string>
+
+namespace SimulationIO {
+
+#define SIMULATIONIO_VERSION_MAJOR 9
+#define SIMULATIONIO_VERSION_MINOR 0
+#define SIMULATIONIO_VERSION_PATCH 3
+
+#define SIMULATIONIO_VERSION "9.0.3"
+
+int versionMajor();
+int versionMinor();
+int versionPatch();
+
+std::string Version();
+
+void checkVersion(const char *header_version);
+
+#define SIMULATIONIO_CHECK_VERSION                                             \
+  (::SimulationIO::checkVersion(SIMULATIONIO_VERSION))
+
+}
+
+#if 0
+#define SIMULATIONIO_HAVE_ASDF_CXX 1
+#else
+#undef SIMULATIONIO_HAVE_ASDF_CXX
+#endif
+
+#if 1
+#define SIMULATIONIO_HAVE_BZIP2 1
+#else
+#undef SIMULATIONIO_HAVE_BZIP2
+#endif
+
+#if 1
+#define SIMULATIONIO_HAVE_HDF5 1
+#else
+#undef SIMULATIONIO_HAVE_HDF5
+#endif
+
+#if 1
+#define SIMULATIONIO_HAVE_MMAP 1
+#else
+#undef SIMULATIONIO_HAVE_MMAP
+#endif
+
+#if 1
+#define SIMULATIONIO_HAVE_ZLIB 1
+#else
+#undef SIMULATIONIO_HAVE_ZLIB
+#endif
+
+#if 0
+#define SIMULATIONIO_HAVE_TILEDB 1
+#else
+#undef SIMULATIONIO_HAVE_TILEDB
+#endif
+
+#define CONFIG_HPP_DONE
+#endif // #ifndef CONFIG_HPP
+#ifndef CONFIG_HPP_DONE
+#error "Cyclic include depencency"
+#endif
@@ -0,0 +1,248 @@
+// Calibrate the chunk shape selection: write and read datasets with the
+// chunk shapes chosen for the different access patterns and chunk sizes, and
+// measure the throughput on the file system holding the output directory.
+//
+// Note that reads may be served from the operating system's page cache
+// unless the datasets are larger than the available memory.
+
+#include "SimulationIO.hpp"
+
+#include "H5Helpers.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace SimulationIO;
+
+using namespace std;
+
+// Options
+string format = "csv";
+int repeat = 3;
+int size = 128;
+string dir = ".";
+bool compress = false;
+vector<string> patterns = {"block", "slice", "point"};
+vector<long long> chunk_bytes_list = {0};
+int nslices = 4;
+int npoints = 1000;
+
+vector<string> split(const string &str) {
+  vector<string> strs;
+  istringstream is(str);
+  string s;
+  while (getline(is, s, ','))
+    if (!s.empty())
+      strs.push_back(s);
+  return strs;
+}
+
+WriteOptions::access_pattern_t get_access_pattern(const string &name) {
+  if (name == "block")
+    return WriteOptions::access_pattern_t::block;
+  if (name == "slice")
+    return WriteOptions::access_pattern_t::slice;
+  if (name == "point")
+    return WriteOptions::access_pattern_t::point;
+  cerr << "Unknown access pattern " << name << "\n";
+  exit(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timing
+////////////////////////////////////////////////////////////////////////////////
+
+string shape_string(const point_t &shape) {
+  ostringstream os;
+  for (int d = 0; d < shape.rank(); ++d)
+    os << (d == 0 ? "" : "x") << shape[d];
+  return os.str();
+}
+
+void output_header() {
+  if (format == "csv")
+    cout << "pattern,chunk_bytes,chunk_shape,op,nbytes,repeat,min_s,mean_s,"
+            "MB_per_s\n";
+}
+
+void output_result(const string &pattern, long long chunk_bytes,
+                   const point_t &chunk_shape, const string &op,
+                   long long nbytes, double tmin, double tavg) {
+  const double mbps = nbytes / tmin / 1.0e+6;
+  if (format == "csv") {
+    cout << pattern << "," << chunk_bytes << "," << shape_string(chunk_shape)
+         << "," << op << "," << nbytes << "," << repeat << "," << tmin << ","
+         << tavg << "," << mbps << "\n";
+  } else {
+    cout << "{\"pattern\":\"" << pattern << "\",\"chunk_bytes\":"
+         << chunk_bytes << ",\"chunk_shape\":\"" << shape_string(chunk_shape)
+         << "\",\"op\":\"" << op << "\",\"nbytes\":" << nbytes
+         << ",\"repeat\":" << repeat << ",\"min_s\":" << tmin
+         << ",\"mean_s\":" << tavg << ",\"MB_per_s\":" << mbps << "}\n";
+  }
+  cout.flush();
+}
+
+void time_op(const string &pattern, long long chunk_bytes,
+             const point_t &chunk_shape, const string &op, long long nbytes,
+             const function<void()> &f) {
+  double tmin = HUGE_VAL, tsum = 0;
+  for (int r = 0; r < repeat; ++r) {
+    const auto t0 = chrono::steady_clock::now();
+    f();
+    const auto t1 = chrono::steady_clock::now();
+    const chrono::duration<double> dt = t1 - t0;
+    tmin = min(tmin, dt.count());
+    tsum += dt.count();
+  }
+  output_result(pattern, chunk_bytes, chunk_shape, op, nbytes, tmin,
+                tsum / repeat);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+// Read a box (in our index order) from a dataset
+void read_box(const H5::DataSet &dataset, const box_t &box, double *data) {
+  const int dim = box.rank();
+  vector<hsize_t> start(dim), count(dim);
+  for (int d = 0; d < dim; ++d) {
+    start.at(dim - 1 - d) = box.lower()[d];
+    count.at(dim - 1 - d) = box.shape()[d];
+  }
+  auto filespace = dataset.getSpace();
+  filespace.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+  const auto memspace = H5::DataSpace(dim, count.data());
+  dataset.read(data, H5::PredType::NATIVE_DOUBLE, memspace, filespace);
+}
+
+void run_pattern(const string &pattern, long long chunk_bytes) {
+  const string filename = dir + "/bench-chunking.s5";
+  const int dim = 3;
+  const box_t box(point_t(dim, 0), point_t(dim, size));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i % 1000;
+
+  WriteOptions write_options;
+  write_options.compress = compress;
+  write_options.shuffle = compress;
+  write_options.checksum = false;
+  write_options.access_pattern = get_access_pattern(pattern);
+  write_options.chunk_bytes = chunk_bytes;
+  const auto chunk_shape = write_options.chunk_shape(box.shape(), 8);
+  const long long nbytes = data.size() * sizeof(double);
+
+  time_op(pattern, chunk_bytes, chunk_shape, "write", nbytes, [&]() {
+    const DataSet ds(double{}, write_options, box);
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    ds.write(file.openGroup("/"), "data");
+    ds.writeData(data, box);
+    file.flush(H5F_SCOPE_GLOBAL);
+  });
+
+  vector<double> buf(data.size());
+  time_op(pattern, chunk_bytes, chunk_shape, "read_block", nbytes, [&]() {
+    auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+    read_box(file.openDataSet("data"), box, buf.data());
+  });
+
+  // Slices normal to the slowest direction
+  const int nslices1 = min(nslices, size);
+  time_op(pattern, chunk_bytes, chunk_shape, "read_slice",
+          nslices1 * (nbytes / size), [&]() {
+            auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+            auto dataset = file.openDataSet("data");
+            for (int n = 0; n < nslices1; ++n) {
+              const int k = (long long)n * size / nslices1;
+              point_t lo(dim, 0), hi(box.upper());
+              lo[dim - 1] = k;
+              hi[dim - 1] = k + 1;
+              read_box(dataset, box_t(lo, hi), buf.data());
+            }
+          });
+
+  // Single points at random locations
+  mt19937_64 rng;
+  uniform_int_distribution<int> dist(0, size - 1);
+  vector<point_t> points;
+  for (int n = 0; n < npoints; ++n)
+    points.push_back(
+        point_t(vector<int>{dist(rng), dist(rng), dist(rng)}));
+  time_op(pattern, chunk_bytes, chunk_shape, "read_point",
+          npoints * sizeof(double), [&]() {
+            auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+            auto dataset = file.openDataSet("data");
+            for (const auto &p : points)
+              read_box(dataset, box_t(p, p + point_t(dim, 1)), buf.data());
+          });
+
+  remove(filename.c_str());
+}
+
+int main(int argc, char **argv) {
+
+  bool have_error = false;
+  for (int argi = 1; argi < argc; ++argi) {
+    string arg = argv[argi];
+    if (arg.find("--format=") == 0) {
+      format = arg.substr(string("--format=").length());
+      if (format != "csv" && format != "json")
+        have_error = true;
+    } else if (arg.find("--repeat=") == 0) {
+      repeat = stoi(arg.substr(string("--repeat=").length()));
+      if (repeat <= 0)
+        have_error = true;
+    } else if (arg.find("--size=") == 0) {
+      size = stoi(arg.substr(string("--size=").length()));
+      if (size <= 0)
+        have_error = true;
+    } else if (arg.find("--dir=") == 0) {
+      dir = arg.substr(string("--dir=").length());
+    } else if (arg == "--compress") {
+      compress = true;
+    } else if (arg.find("--patterns=") == 0) {
+      patterns = split(arg.substr(string("--patterns=").length()));
+    } else if (arg.find("--chunk-bytes=") == 0) {
+      chunk_bytes_list.clear();
+      for (const auto &s : split(arg.substr(string("--chunk-bytes=").length())))
+        chunk_bytes_list.push_back(stoll(s));
+    } else if (arg.find("--npoints=") == 0) {
+      npoints = stoi(arg.substr(string("--npoints=").length()));
+      if (npoints < 0)
+        have_error = true;
+    } else {
+      have_error = true;
+    }
+  }
+
+  if (have_error) {
+    cerr << "Synopsis:\n"
+         << argv[0]
+         << " [--format=csv|json] [--repeat=<n>] [--size=<n>] [--dir=<path>] "
+            "[--compress] [--patterns=block|slice|point{,...}] "
+            "[--chunk-bytes=<n>{,<n>}] [--npoints=<n>]\n"
+         << "Writes a <size>^3 dataset to <dir> for each access pattern and "
+            "chunk size (0 is the default), and measures write and read "
+            "throughput. Results are written to stdout, one line per "
+            "measurement (CSV with a header line, or JSON Lines).\n";
+    exit(1);
+  }
+
+  output_header();
+  for (const auto &pattern : patterns)
+    for (const auto chunk_bytes : chunk_bytes_list)
+      run_pattern(pattern, chunk_bytes);
+
+  return 0;
+}
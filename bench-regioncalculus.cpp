@@ -0,0 +1,328 @@
+#include "RegionCalculus.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace RegionCalculus;
+
+using namespace std;
+
+typedef long long T;
+
+// Options
+string format = "csv";
+int repeat = 5;
+int nboxes = 1000;
+vector<int> dims = {1, 2, 3, 4};
+vector<string> workloads = {"random", "amr", "checkerboard"};
+
+mt19937_64 rng;
+T irand(T imax) { return uniform_int_distribution<T>(0, imax - 1)(rng); }
+
+vector<string> split(const string &str) {
+  vector<string> strs;
+  istringstream is(str);
+  string s;
+  while (getline(is, s, ','))
+    if (!s.empty())
+      strs.push_back(s);
+  return strs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Workloads
+////////////////////////////////////////////////////////////////////////////////
+
+// Two box lists; the benchmarked operations combine the resulting regions
+template <int D> struct workload_t {
+  vector<box<T, D>> boxes0, boxes1;
+};
+
+// Random boxes in a cube. The cube grows with the number of boxes so that the
+// boxes overlap partially, independent of the dimension.
+template <int D> vector<box<T, D>> random_boxes(int n) {
+  const T maxsize = 10;
+  const T extent = 2 * maxsize * T(ceil(pow(double(n), 1.0 / D)));
+  vector<box<T, D>> bs;
+  for (int i = 0; i < n; ++i) {
+    array<T, D> lo, hi;
+    for (int d = 0; d < D; ++d) {
+      lo[d] = irand(extent);
+      hi[d] = lo[d] + 1 + irand(maxsize);
+    }
+    bs.push_back(box<T, D>(point<T, D>(lo), point<T, D>(hi)));
+  }
+  return bs;
+}
+
+template <int D> workload_t<D> random_workload() {
+  return {random_boxes<D>(nboxes), random_boxes<D>(nboxes)};
+}
+
+// Nested refinement: each level consists of boxes placed inside the boxes of
+// the next coarser level, refined by a factor 2. The workload consists of the
+// finest level and its parent level, both in the finest index space.
+template <int D> workload_t<D> amr_workload() {
+  const int nlevels = 4;
+  vector<vector<box<T, D>>> levels(nlevels);
+  levels[0].push_back(
+      box<T, D>(point<T, D>(T(0)), point<T, D>(T(16 * nlevels))));
+  for (int l = 1; l < nlevels; ++l) {
+    const int nlevelboxes = max(1, nboxes >> (2 * (nlevels - 1 - l)));
+    for (int i = 0; i < nlevelboxes; ++i) {
+      const auto &parent = levels[l - 1][irand(levels[l - 1].size())];
+      array<T, D> lo, hi;
+      for (int d = 0; d < D; ++d) {
+        const T plo = 2 * parent.lower()[d], phi = 2 * parent.upper()[d];
+        lo[d] = plo + irand(phi - plo);
+        hi[d] = min(phi, lo[d] + 1 + irand(8));
+      }
+      levels[l].push_back(box<T, D>(point<T, D>(lo), point<T, D>(hi)));
+    }
+  }
+  workload_t<D> w;
+  w.boxes0 = levels[nlevels - 1];
+  for (const auto &b : levels[nlevels - 2])
+    w.boxes1.push_back(box<T, D>(b.lower() * point<T, D>(T(2)),
+                                 b.upper() * point<T, D>(T(2))));
+  return w;
+}
+
+// A checkerboard of cells, and the same checkerboard shifted by half a cell.
+// This leads to maximally fragmented regions.
+template <int D> workload_t<D> checkerboard_workload() {
+  int ncells = 1;
+  while (SimulationIO::ipow(ncells + 1, D) <= 2 * nboxes)
+    ++ncells;
+  const T width = 4;
+  workload_t<D> w;
+  array<int, D> idx;
+  idx.fill(0);
+  while (true) {
+    int parity = 0;
+    array<T, D> lo, hi;
+    for (int d = 0; d < D; ++d) {
+      parity += idx[d];
+      lo[d] = idx[d] * width;
+      hi[d] = lo[d] + width;
+    }
+    if (parity % 2 == 0) {
+      const box<T, D> b{point<T, D>(lo), point<T, D>(hi)};
+      w.boxes0.push_back(b);
+      w.boxes1.push_back(b >> point<T, D>(width / 2));
+    }
+    int d = 0;
+    for (; d < D; ++d) {
+      if (++idx[d] < ncells)
+        break;
+      idx[d] = 0;
+    }
+    if (d == D)
+      break;
+  }
+  return w;
+}
+
+template <> workload_t<1> checkerboard_workload<1>() {
+  // A 1D checkerboard is just a sequence of intervals
+  workload_t<1> w;
+  const T width = 4;
+  for (int i = 0; i < nboxes; ++i) {
+    const box<T, 1> b(point<T, 1>(2 * i * width),
+                      point<T, 1>((2 * i + 1) * width));
+    w.boxes0.push_back(b);
+    w.boxes1.push_back(b >> point<T, 1>(width / 2));
+  }
+  return w;
+}
+
+template <int D> workload_t<D> make_workload(const string &name) {
+  if (name == "random")
+    return random_workload<D>();
+  if (name == "amr")
+    return amr_workload<D>();
+  if (name == "checkerboard")
+    return checkerboard_workload<D>();
+  cerr << "Unknown workload " << name << "\n";
+  exit(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timing
+////////////////////////////////////////////////////////////////////////////////
+
+template <int D> size_t count_boxes(const vector<box<T, D>> &bs) {
+  return bs.size();
+}
+size_t count_boxes(const vector<dbox<T>> &bs) { return bs.size(); }
+template <int D> size_t count_boxes(const region<T, D> &r) {
+  return vector<box<T, D>>(r).size();
+}
+size_t count_boxes(const dregion<T> &r) {
+  return vector<dbox<T>>(r).size();
+}
+
+void output_header() {
+  if (format == "csv")
+    cout << "impl,workload,dim,op,nboxes0,nboxes1,nresult,repeat,min_s,"
+            "mean_s\n";
+}
+
+void output_result(const string &impl, const string &workload, int dim,
+                   const string &op, size_t nboxes0, size_t nboxes1,
+                   size_t nresult, double tmin, double tavg) {
+  if (format == "csv") {
+    cout << impl << "," << workload << "," << dim << "," << op << ","
+         << nboxes0 << "," << nboxes1 << "," << nresult << "," << repeat
+         << "," << tmin << "," << tavg << "\n";
+  } else {
+    cout << "{\"impl\":\"" << impl << "\",\"workload\":\"" << workload
+         << "\",\"dim\":" << dim << ",\"op\":\"" << op
+         << "\",\"nboxes0\":" << nboxes0 << ",\"nboxes1\":" << nboxes1
+         << ",\"nresult\":" << nresult << ",\"repeat\":" << repeat
+         << ",\"min_s\":" << tmin << ",\"mean_s\":" << tavg << "}\n";
+  }
+  cout.flush();
+}
+
+template <typename F>
+void time_op(const string &impl, const string &workload, int dim,
+             const string &op, size_t nboxes0, size_t nboxes1, const F &f) {
+  double tmin = HUGE_VAL, tsum = 0;
+  size_t nresult = 0;
+  for (int r = 0; r < repeat; ++r) {
+    const auto t0 = chrono::steady_clock::now();
+    const auto res = f();
+    const auto t1 = chrono::steady_clock::now();
+    const chrono::duration<double> dt = t1 - t0;
+    tmin = min(tmin, dt.count());
+    tsum += dt.count();
+    if (r == 0)
+      nresult = count_boxes(res);
+  }
+  output_result(impl, workload, dim, op, nboxes0, nboxes1, nresult, tmin,
+                tsum / repeat);
+}
+
+template <int D> void run_workload(const string &name) {
+  typedef region<T, D> R;
+  const auto w = make_workload<D>(name);
+  const size_t n0 = w.boxes0.size(), n1 = w.boxes1.size();
+
+  // Static regions
+  {
+    const R r0(w.boxes0), r1(w.boxes1);
+    const auto time = [&](const string &op, const function<R()> &f) {
+      time_op("region", name, D, op, n0, n1, f);
+    };
+    time("construct", [&]() { return R(w.boxes0); });
+    time("union", [&]() { return r0 | r1; });
+    time("intersection", [&]() { return r0 & r1; });
+    time("difference", [&]() { return r0 - r1; });
+    time("symmetric_difference", [&]() { return r0 ^ r1; });
+    time("grow", [&]() { return r0.grow(T(1)); });
+    time("shrink", [&]() { return r0.shrink(T(1)); });
+    time_op("region", name, D, "boxes", n0, n1,
+            [&]() { return vector<box<T, D>>(r0); });
+    time_op("region", name, D, "boxes_merged", n0, n1,
+            [&]() { return r0.decompose(decomposition::merged); });
+    time_op("region", name, D, "boxes_best", n0, n1,
+            [&]() { return r0.decompose(decomposition::best); });
+  }
+
+  // Type-erased regions
+  {
+    typedef dregion<T> DR;
+    vector<dbox<T>> dboxes0;
+    for (const auto &b : w.boxes0)
+      dboxes0.push_back(dbox<T>(b));
+    const DR r0(R(w.boxes0)), r1(R(w.boxes1));
+    const auto time = [&](const string &op, const function<DR()> &f) {
+      time_op("dregion", name, D, op, n0, n1, f);
+    };
+    time("construct", [&]() { return DR(dboxes0); });
+    time("union", [&]() { return r0 | r1; });
+    time("intersection", [&]() { return r0 & r1; });
+    time("difference", [&]() { return r0 - r1; });
+    time("symmetric_difference", [&]() { return r0 ^ r1; });
+    time("grow", [&]() { return r0.grow(T(1)); });
+    time("shrink", [&]() { return r0.shrink(T(1)); });
+    time_op("dregion", name, D, "boxes", n0, n1,
+            [&]() { return vector<dbox<T>>(r0); });
+  }
+}
+
+void run_workload(int dim, const string &name) {
+  switch (dim) {
+  case 1:
+    return run_workload<1>(name);
+  case 2:
+    return run_workload<2>(name);
+  case 3:
+    return run_workload<3>(name);
+  case 4:
+    return run_workload<4>(name);
+  default:
+    cerr << "Unsupported dimension " << dim << "\n";
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv) {
+
+  bool have_error = false;
+  for (int argi = 1; argi < argc; ++argi) {
+    string arg = argv[argi];
+    if (arg.find("--format=") == 0) {
+      format = arg.substr(string("--format=").length());
+      if (format != "csv" && format != "json")
+        have_error = true;
+    } else if (arg.find("--repeat=") == 0) {
+      repeat = stoi(arg.substr(string("--repeat=").length()));
+      if (repeat <= 0)
+        have_error = true;
+    } else if (arg.find("--nboxes=") == 0) {
+      nboxes = stoi(arg.substr(string("--nboxes=").length()));
+      if (nboxes <= 0)
+        have_error = true;
+    } else if (arg.find("--dims=") == 0) {
+      dims.clear();
+      for (const auto &s : split(arg.substr(string("--dims=").length())))
+        dims.push_back(stoi(s));
+    } else if (arg.find("--workloads=") == 0) {
+      workloads = split(arg.substr(string("--workloads=").length()));
+    } else if (arg.find("--seed=") == 0) {
+      rng.seed(stoull(arg.substr(string("--seed=").length())));
+    } else {
+      have_error = true;
+    }
+  }
+
+  if (have_error) {
+    cerr << "Synopsis:\n"
+         << argv[0]
+         << " [--format=csv|json] [--repeat=<n>] [--nboxes=<n>] "
+            "[--dims=<d>{,<d>}] [--workloads=random|amr|checkerboard{,...}] "
+            "[--seed=<n>]\n"
+         << "Results are written to stdout, one line per benchmark (CSV with "
+            "a header line, or JSON Lines).\n";
+    exit(1);
+  }
+
+  output_header();
+  for (int dim : dims)
+    for (const auto &workload : workloads)
+      run_workload(dim, workload);
+
+  return 0;
+}
@@ -820,6 +820,324 @@ template <int D> void test_region() {
   }
 }
 
+template <int D> void test_region_parallel() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+
+  vector<B> bs;
+  for (int n = 0; n < 1000; ++n) {
+    array<int, D> xs, ys;
+    for (int d = 0; d < D; ++d) {
+      xs[d] = irand(20);
+      ys[d] = xs[d] + irand(5);
+    }
+    bs.push_back(B(P(xs), P(ys)));
+  }
+
+  const R rser = R::from_boxes(bs, bs.size(), 1);
+  for (int nthreads : {2, 3, 8}) {
+    for (size_t cutoff : {size_t(1), size_t(10), size_t(100)}) {
+      const R rpar = R::from_boxes(bs, cutoff, nthreads);
+      EXPECT_TRUE(rpar.invariant());
+      EXPECT_TRUE(equal_to<R>()(rpar, rser));
+    }
+  }
+  EXPECT_TRUE(equal_to<R>()(R(bs), rser));
+}
+
+template <int D> void test_region_grow_shrink() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+
+  for (int n = 0; n < 20; ++n) {
+    vector<B> bs;
+    const int nboxes = irand(50);
+    for (int i = 0; i < nboxes; ++i) {
+      array<int, D> xs, ys;
+      for (int d = 0; d < D; ++d) {
+        xs[d] = irand(20);
+        ys[d] = xs[d] + irand(5);
+      }
+      bs.push_back(B(P(xs), P(ys)));
+    }
+    const R r(bs);
+
+    P plo, phi;
+    while (1) {
+      array<int, D> xs, ys;
+      for (int d = 0; d < D; ++d) {
+        xs[d] = irand(5) - 2;
+        ys[d] = irand(5) - 2;
+      }
+      plo = P(xs);
+      phi = P(ys);
+      if (all(plo + phi >= P(0)))
+        break;
+    }
+    const R rgro = r.grow(plo, phi);
+    const R rred = r.shrink(plo, phi);
+    EXPECT_TRUE(rgro.invariant());
+    EXPECT_TRUE(rred.invariant());
+    EXPECT_TRUE(equal_to<R>()(rgro, r.grow_reduce(plo, phi)));
+    EXPECT_TRUE(equal_to<R>()(rred, r.shrink_reduce(plo, phi)));
+  }
+}
+
+TEST(RegionCalculus, region_grow_shrink_2d) { test_region_grow_shrink<2>(); }
+TEST(RegionCalculus, region_grow_shrink_3d) { test_region_grow_shrink<3>(); }
+TEST(RegionCalculus, region_grow_shrink_4d) { test_region_grow_shrink<4>(); }
+
+template <int D> void test_region_inplace() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+
+  const auto random_region = [](int offset) {
+    vector<B> bs;
+    const int nboxes = irand(20);
+    for (int n = 0; n < nboxes; ++n) {
+      array<int, D> xs, ys;
+      for (int d = 0; d < D; ++d) {
+        xs[d] = irand(20);
+        ys[d] = xs[d] + irand(5);
+      }
+      xs[D - 1] += offset;
+      ys[D - 1] += offset;
+      bs.push_back(B(P(xs), P(ys)));
+    }
+    return R(bs);
+  };
+
+  for (int n = 0; n < 100; ++n) {
+    // Regions are shifted in the outermost direction so that they are
+    // sometimes disjoint, sometimes touching, and sometimes overlapping
+    const R r1 = random_region(0);
+    const R r2 = random_region(irand(3) * 12 - 12);
+    R rint = r1, runi = r1, rsym = r1, rdif = r1;
+    rint &= r2;
+    runi |= r2;
+    rsym ^= r2;
+    rdif -= r2;
+    EXPECT_TRUE(rint.invariant());
+    EXPECT_TRUE(runi.invariant());
+    EXPECT_TRUE(rsym.invariant());
+    EXPECT_TRUE(rdif.invariant());
+    EXPECT_TRUE(equal_to<R>()(rint, r1 & r2));
+    EXPECT_TRUE(equal_to<R>()(runi, r1 | r2));
+    EXPECT_TRUE(equal_to<R>()(rsym, r1 ^ r2));
+    EXPECT_TRUE(equal_to<R>()(rdif, r1 - r2));
+    R rself = r1;
+    rself ^= rself;
+    EXPECT_TRUE(rself.empty());
+  }
+
+  vector<B> bs;
+  region_builder<int, D> builder(7);
+  R reg;
+  for (int n = 0; n < 100; ++n) {
+    array<int, D> xs, ys;
+    for (int d = 0; d < D; ++d) {
+      xs[d] = irand(20);
+      ys[d] = xs[d] + irand(5);
+    }
+    const B b{P(xs), P(ys)};
+    bs.push_back(b);
+    builder |= b;
+    reg |= b;
+    if (n % 10 == 0)
+      builder |= R(b);
+    if (n % 30 == 0)
+      EXPECT_TRUE(equal_to<R>()(builder.build(), reg));
+  }
+  EXPECT_TRUE(equal_to<R>()(builder.build(), R(bs)));
+  EXPECT_TRUE(equal_to<R>()(reg, R(bs)));
+}
+
+TEST(RegionCalculus, region_inplace_1d) { test_region_inplace<1>(); }
+TEST(RegionCalculus, region_inplace_2d) { test_region_inplace<2>(); }
+TEST(RegionCalculus, region_inplace_3d) { test_region_inplace<3>(); }
+
+template <int D> void test_region_combine_all() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+
+  for (int n = 0; n < 20; ++n) {
+    vector<R> rs;
+    const int nregions = irand(10);
+    for (int i = 0; i < nregions; ++i) {
+      vector<B> bs;
+      const int nboxes = irand(10);
+      for (int j = 0; j < nboxes; ++j) {
+        array<int, D> xs, ys;
+        for (int d = 0; d < D; ++d) {
+          xs[d] = irand(10);
+          ys[d] = xs[d] + irand(8);
+        }
+        bs.push_back(B(P(xs), P(ys)));
+      }
+      rs.push_back(R(bs));
+    }
+    R runi, rint;
+    for (size_t i = 0; i < rs.size(); ++i) {
+      runi |= rs[i];
+      rint = i == 0 ? rs[i] : rint & rs[i];
+    }
+    const R runi_all = R::union_all(rs);
+    EXPECT_TRUE(runi_all.invariant());
+    EXPECT_TRUE(equal_to<R>()(runi_all, runi));
+    if (!rs.empty()) {
+      const R rint_all = R::intersect_all(rs);
+      EXPECT_TRUE(rint_all.invariant());
+      EXPECT_TRUE(equal_to<R>()(rint_all, rint));
+    }
+  }
+}
+
+TEST(RegionCalculus, region_combine_all_1d) { test_region_combine_all<1>(); }
+TEST(RegionCalculus, region_combine_all_2d) { test_region_combine_all<2>(); }
+TEST(RegionCalculus, region_combine_all_3d) { test_region_combine_all<3>(); }
+
+template <int D> void test_region_decompose() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+
+  for (int n = 0; n < 20; ++n) {
+    vector<B> bs;
+    const int nboxes = irand(20);
+    for (int j = 0; j < nboxes; ++j) {
+      array<int, D> xs, ys;
+      for (int d = 0; d < D; ++d) {
+        xs[d] = irand(10);
+        ys[d] = xs[d] + irand(8);
+      }
+      bs.push_back(B(P(xs), P(ys)));
+    }
+    const R r(bs);
+    const vector<B> sweep(r);
+    EXPECT_EQ(sweep, r.decompose(decomposition::sweep));
+    size_t last_size = sweep.size();
+    for (const auto mode : {decomposition::merged, decomposition::best}) {
+      const auto rbs = r.decompose(mode);
+      // The boxes are sorted, disjoint, and cover the region
+      EXPECT_TRUE(is_sorted(rbs.begin(), rbs.end(), less<B>()));
+      R rr;
+      for (const auto &b : rbs) {
+        EXPECT_FALSE(b.empty());
+        EXPECT_TRUE(rr.isdisjoint(R(b)));
+        rr |= b;
+      }
+      EXPECT_TRUE(equal_to<R>()(rr, r));
+      EXPECT_LE(rbs.size(), last_size);
+      last_size = rbs.size();
+    }
+  }
+}
+
+TEST(RegionCalculus, region_decompose_2d) {
+  test_region_decompose<2>();
+
+  // A column with teeth on every other row. Sweeping along y cuts the column
+  // at every row; sweeping along x does not.
+  typedef point<int, 2> P;
+  typedef box<int, 2> B;
+  typedef region<int, 2> R;
+  R r(B(P(0, 0), P(1, 10)));
+  for (int y = 1; y < 10; y += 2)
+    r |= B(P(1, y), P(2, y + 1));
+  EXPECT_EQ(10, r.decompose(decomposition::sweep).size());
+  EXPECT_EQ(10, r.decompose(decomposition::merged).size());
+  EXPECT_EQ(6, r.decompose(decomposition::best).size());
+}
+TEST(RegionCalculus, region_decompose_3d) { test_region_decompose<3>(); }
+TEST(RegionCalculus, region_decompose_4d) { test_region_decompose<4>(); }
+
+TEST(RegionCalculus, region1_merge) {
+  typedef point<int, 1> P;
+  typedef box<int, 1> B;
+  typedef region<int, 1> R;
+
+  const auto random_region = []() {
+    vector<B> bs;
+    const int nboxes = irand(20);
+    for (int n = 0; n < nboxes; ++n) {
+      const int x = irand(100);
+      bs.push_back(B(P(x), P(x + 1 + irand(10))));
+    }
+    return R(bs);
+  };
+
+  for (int n = 0; n < 100; ++n) {
+    const R r1 = random_region();
+    const R r2 = random_region();
+    const R rint = r1 & r2;
+    const R runi = r1 | r2;
+    const R rsym = r1 ^ r2;
+    const R rdif = r1 - r2;
+    for (int x = -1; x <= 111; ++x) {
+      const P p(x);
+      const bool in1 = r1.contains(p);
+      const bool in2 = r2.contains(p);
+      EXPECT_EQ(in1 && in2, rint.contains(p));
+      EXPECT_EQ(in1 || in2, runi.contains(p));
+      EXPECT_EQ(in1 != in2, rsym.contains(p));
+      EXPECT_EQ(in1 && !in2, rdif.contains(p));
+    }
+  }
+}
+
+template <int D> void test_flat_region() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef region<int, D> R;
+  typedef flat_region<int, D> FR;
+
+  const auto random_region = []() {
+    vector<B> bs;
+    const int nboxes = irand(10);
+    for (int n = 0; n < nboxes; ++n) {
+      array<int, D> xs, ys;
+      for (int d = 0; d < D; ++d) {
+        xs[d] = irand(10);
+        ys[d] = xs[d] + irand(5);
+      }
+      bs.push_back(B(P(xs), P(ys)));
+    }
+    return R(bs);
+  };
+
+  EXPECT_TRUE(FR().empty());
+  EXPECT_TRUE(FR().invariant());
+  EXPECT_TRUE(R(FR()) == R());
+
+  const int niters = 100;
+  for (int n = 0; n < niters; ++n) {
+    const R r1 = random_region();
+    const R r2 = random_region();
+    const FR f1(r1), f2(r2);
+    EXPECT_TRUE(f1.invariant());
+    EXPECT_TRUE(f2.invariant());
+    EXPECT_TRUE(R(f1) == r1);
+    EXPECT_EQ(r1.empty(), f1.empty());
+    EXPECT_EQ(r1.size(), f1.size());
+    EXPECT_TRUE(R(f1 & f2) == (r1 & r2));
+    EXPECT_TRUE(R(f1 | f2) == (r1 | r2));
+    EXPECT_TRUE(R(f1 ^ f2) == (r1 ^ r2));
+    EXPECT_TRUE(R(f1 - f2) == (r1 - r2));
+    EXPECT_TRUE((f1 & f2) == FR(r1 & r2));
+    EXPECT_TRUE((f1 | f2) == FR(r1 | r2));
+    EXPECT_EQ(r1 <= r2, f1 <= f2);
+    EXPECT_EQ(r1.isdisjoint(r2), f1.isdisjoint(f2));
+    FR f3(f1);
+    f3 |= f2;
+    f3 -= f1;
+    EXPECT_TRUE(R(f3) == (r2 - r1));
+  }
+}
+
 TEST(RegionCalculus, point_1d) { test_point<1>(); }
 TEST(RegionCalculus, point_2d) { test_point<2>(); }
 TEST(RegionCalculus, point_3d) { test_point<3>(); }
@@ -835,6 +1153,14 @@ TEST(RegionCalculus, region_2d) { test_region<2>(); }
 TEST(RegionCalculus, region_3d) { test_region<3>(); }
 TEST(RegionCalculus, region_4d) { test_region<4>(); }
 
+TEST(RegionCalculus, flat_region_1d) { test_flat_region<1>(); }
+TEST(RegionCalculus, flat_region_2d) { test_flat_region<2>(); }
+TEST(RegionCalculus, flat_region_3d) { test_flat_region<3>(); }
+TEST(RegionCalculus, flat_region_4d) { test_flat_region<4>(); }
+
+TEST(RegionCalculus, region_parallel_2d) { test_region_parallel<2>(); }
+TEST(RegionCalculus, region_parallel_3d) { test_region_parallel<3>(); }
+
 TEST(RegionCalculus, dpoint) {
   const int dim = 3;
   typedef dpoint<int> dpoint;
@@ -1202,6 +1528,81 @@ TEST(RegionCalculus, dbox_dim) {
   }
 }
 
+template <int D> void test_dbox_typed() {
+  typedef point<int, D> P;
+  typedef box<int, D> B;
+  typedef ::dpoint<int> DP;
+  typedef ::dbox<int> DB;
+
+  const auto randbox = []() {
+    array<int, D> xs, ys;
+    for (int d = 0; d < D; ++d) {
+      xs[d] = irand(10);
+      ys[d] = irand(10);
+    }
+    return B(P(xs), P(ys));
+  };
+
+  const int niters = 100;
+  for (int n = 0; n < niters; ++n) {
+    const B b1 = randbox(), b2 = randbox();
+    const DB db1(b1), db2(b2);
+    const P p = b2.lower();
+    const DP dp(p);
+
+    EXPECT_EQ(D, db1.rank());
+    EXPECT_TRUE(B(db1) == b1);
+    EXPECT_TRUE(dp.equal_to(DP(p)));
+    EXPECT_EQ(b1.empty(), db1.empty());
+    EXPECT_EQ(b1.size(), db1.size());
+    EXPECT_TRUE(db1.shape().equal_to(DP(b1.shape())));
+
+    // Point operations agree with the typed points
+    EXPECT_TRUE((dp + DP(b1.upper())).equal_to(DP(p + b1.upper())));
+    EXPECT_TRUE(dp.min(DP(b1.upper())).equal_to(DP(p.min(b1.upper()))));
+    EXPECT_TRUE((-dp).equal_to(DP(-p)));
+    EXPECT_EQ(p.sum(), dp.sum());
+    EXPECT_EQ(p.prod(), dp.prod());
+    EXPECT_EQ(p.hash(), dp.hash());
+    EXPECT_EQ(p.less(b1.upper()), dp.less(DP(b1.upper())));
+
+    // Box operations agree with the typed boxes
+    EXPECT_TRUE(B(db1 & db2) == (b1 & b2));
+    EXPECT_TRUE(B(db1.bounding_box(db2)) == b1.bounding_box(b2));
+    EXPECT_TRUE(B(db1.grow(dp, DP(D, 1))) == b1.grow(p, P(1)));
+    EXPECT_TRUE(B(db1.shrink(1)) == b1.shrink(1));
+    EXPECT_TRUE(B(db1 >> dp) == (b1 >> p));
+    EXPECT_EQ(b1 == b2, db1 == db2);
+    EXPECT_EQ(b1 <= b2, db1 <= db2);
+    EXPECT_EQ(b1 < b2, db1 < db2);
+    EXPECT_EQ(b1.less(b2), db1.less(db2));
+    EXPECT_EQ(b1.contains(p), db1.contains(dp));
+    EXPECT_EQ(b1.isdisjoint(b2), db1.isdisjoint(db2));
+    EXPECT_EQ(b1.hash(), db1.hash());
+
+    ostringstream buf, dbuf;
+    buf << b1;
+    dbuf << db1;
+    EXPECT_EQ(buf.str(), dbuf.str());
+  }
+
+  // Regions accept inline points and boxes
+  const B b = randbox();
+  const ::dregion<int> r(DB{b});
+  typedef region<int, D> R;
+  EXPECT_TRUE(R(r) == R(b));
+  const vector<DB> dbs(r);
+  EXPECT_EQ(vector<B>(R(b)).size(), dbs.size());
+}
+
+TEST(RegionCalculus, dbox_typed) {
+  test_dbox_typed<0>();
+  test_dbox_typed<1>();
+  test_dbox_typed<2>();
+  test_dbox_typed<3>();
+  test_dbox_typed<4>();
+}
+
 TEST(RegionCalculus, dregion_dim) {
   typedef dpoint<int> dpoint;
   typedef dbox<int> dbox;
@@ -1633,4 +2034,150 @@ TEST(RegionCalculus, benchmark_region_strict_subset) {
   auto rlt = regs[0] < regs[1];
 }
 
+TEST(RegionCalculus, benchmark_region_grow) {
+  using namespace benchmark;
+  auto rgro = regs[0].grow(P(1), P(2));
+}
+TEST(RegionCalculus, benchmark_region_grow_reduce) {
+  using namespace benchmark;
+  auto rgro = regs[0].grow_reduce(P(1), P(2));
+}
+TEST(RegionCalculus, benchmark_region_shrink) {
+  using namespace benchmark;
+  auto rred = regs[0].shrink(P(1), P(0));
+}
+TEST(RegionCalculus, benchmark_region_shrink_reduce) {
+  using namespace benchmark;
+  auto rred = regs[0].shrink_reduce(P(1), P(0));
+}
+
+namespace benchmark {
+vector<B> incremental_boxes() {
+  vector<B> bs;
+  for (int n = 0; n < 500; ++n) {
+    array<int, D> xs, ys;
+    for (int d = 0; d < D; ++d) {
+      xs[d] = irand(100);
+      ys[d] = xs[d] + irand(10);
+    }
+    bs.push_back(B(P(xs), P(ys)));
+  }
+  return bs;
+}
+} // namespace benchmark
+
+TEST(RegionCalculus, benchmark_region_incremental) {
+  using namespace benchmark;
+  R reg;
+  for (const auto &b : incremental_boxes())
+    reg |= b;
+}
+TEST(RegionCalculus, benchmark_region_builder) {
+  using namespace benchmark;
+  region_builder<T, D> builder;
+  for (const auto &b : incremental_boxes())
+    builder |= b;
+  auto reg = builder.build();
+}
+
+namespace benchmark {
+// Many small, mostly disjoint regions, as in a refinement level
+vector<R> many_regions() {
+  vector<R> rs;
+  for (int n = 0; n < 1000; ++n) {
+    array<int, D> xs, ys;
+    for (int d = 0; d < D; ++d) {
+      xs[d] = irand(100);
+      ys[d] = xs[d] + irand(10);
+    }
+    rs.push_back(R(B(P(xs), P(ys))) | R(B(P(ys), P(ys) + P(3))));
+  }
+  return rs;
+}
+} // namespace benchmark
+
+TEST(RegionCalculus, benchmark_region_union_pairwise) {
+  using namespace benchmark;
+  auto rs = many_regions();
+  auto runi = reduce([](const R &r) { return r; },
+                     [](const R &x, const R &y) { return x | y; }, rs);
+}
+TEST(RegionCalculus, benchmark_region_union_all) {
+  using namespace benchmark;
+  auto rs = many_regions();
+  auto runi = R::union_all(rs);
+}
+
+namespace benchmark {
+typedef region<T, 1> R1;
+array<R1, 2> regs1;
+} // namespace benchmark
+
+TEST(RegionCalculus, benchmark_region1_setup) {
+  using namespace benchmark;
+
+  // One fine and one coarse region
+  constexpr int niters = 1000000;
+  for (int i = 0; i < 2; ++i) {
+    const int spacing = i == 0 ? 10 : 1000;
+    vector<box<T, 1>> bs;
+    bs.reserve(niters);
+    for (int n = 0; n < niters; ++n) {
+      const T x = T(n) * spacing + irand(spacing / 2);
+      const T y = x + 1 + irand(spacing / 2 - 1);
+      bs.push_back(box<T, 1>(point<T, 1>(x), point<T, 1>(y)));
+    }
+    regs1[i] = R1(bs);
+  }
+}
+
+TEST(RegionCalculus, benchmark_region1_intersection) {
+  using namespace benchmark;
+  for (int n = 0; n < 10; ++n)
+    auto rint = regs1[0] & regs1[1];
+}
+TEST(RegionCalculus, benchmark_region1_union) {
+  using namespace benchmark;
+  for (int n = 0; n < 10; ++n)
+    auto runi = regs1[0] | regs1[1];
+}
+TEST(RegionCalculus, benchmark_region1_symmetric_difference) {
+  using namespace benchmark;
+  for (int n = 0; n < 10; ++n)
+    auto rsym = regs1[0] ^ regs1[1];
+}
+TEST(RegionCalculus, benchmark_region1_difference) {
+  using namespace benchmark;
+  for (int n = 0; n < 10; ++n)
+    auto rdif = regs1[1] - regs1[0];
+}
+
+namespace benchmark {
+typedef flat_region<T, D> FR;
+array<FR, 2> flat_regs;
+} // namespace benchmark
+
+TEST(RegionCalculus, benchmark_flat_region_setup) {
+  using namespace benchmark;
+  for (int i = 0; i < 2; ++i)
+    flat_regs[i] = FR(regs[i]);
+}
+
+TEST(RegionCalculus, benchmark_flat_region_intersection) {
+  using namespace benchmark;
+  auto rint = flat_regs[0] & flat_regs[1];
+}
+TEST(RegionCalculus, benchmark_flat_region_union) {
+  using namespace benchmark;
+  auto runi = flat_regs[0] | flat_regs[1];
+}
+TEST(RegionCalculus, benchmark_flat_region_symmetric_difference) {
+  using namespace benchmark;
+  auto rsym = flat_regs[0] ^ flat_regs[1];
+}
+TEST(RegionCalculus, benchmark_flat_region_difference) {
+  using namespace benchmark;
+  auto rdif = flat_regs[0] - flat_regs[1];
+}
+
 #include "src/gtest_main.cc"
@@ -2,6 +2,7 @@
 #include "SimulationIO.hpp"
 
 #ifdef SIMULATIONIO_HAVE_HDF5
+#include "H5Filters.hpp"
 #include "H5Helpers.hpp"
 #endif
 
@@ -11,21 +12,31 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <complex>
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <limits>
 #include <memory>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 using std::array;
 using std::complex;
 using std::ifstream;
 using std::int64_t;
+using std::invalid_argument;
 using std::ios;
 using std::numeric_limits;
 using std::ofstream;
@@ -48,6 +59,310 @@ TEST(ipow, ipow) {
   EXPECT_EQ(4, ipow(2, 2));
 }
 
+TEST(HyperSlab, copy) {
+  std::mt19937 gen;
+  const auto irand = [&](int n) {
+    return std::uniform_int_distribution<int>(0, n - 1)(gen);
+  };
+  const auto old_settings = HyperSlab::copy_settings();
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    if (parallel) {
+      // Force the multi-threaded and non-temporal code paths
+      HyperSlab::copy_settings().cutoff = 0;
+      HyperSlab::copy_settings().nthreads = 3;
+      HyperSlab::copy_settings().nontemporal_cutoff = 0;
+    }
+    for (const int type_size : {1, 4, 8, 12, 16}) {
+      for (int rank = 1; rank <= 3; ++rank) {
+        // Copy a random sub-box between two different layouts
+        point_t inlo(rank), inhi(rank), lo(rank), hi(rank), outlo(rank),
+            outhi(rank);
+        for (int d = 0; d < rank; ++d) {
+          inlo[d] = irand(3);
+          lo[d] = inlo[d] + irand(3);
+          hi[d] = lo[d] + 1 + irand(20);
+          inhi[d] = hi[d] + irand(3);
+          outlo[d] = lo[d] - irand(3);
+          outhi[d] = hi[d] + irand(3);
+        }
+        const box_t inlayout(inlo, inhi), outlayout(outlo, outhi),
+            box(lo, hi);
+        vector<unsigned char> in(inlayout.size() * type_size);
+        for (size_t i = 0; i < in.size(); ++i)
+          in[i] = (unsigned char)(i * 7 + 1);
+        vector<unsigned char> out(outlayout.size() * type_size, 0);
+        HyperSlab::copy(out.data(), outlayout.size(), outlayout, box,
+                        in.data(), inlayout.size(), inlayout, box, type_size);
+
+        const auto offset = [&](const box_t &layout, const point_t &p) {
+          ptrdiff_t off = 0, stride = type_size;
+          for (int d = 0; d < rank; ++d) {
+            off += (p[d] - layout.lower()[d]) * stride;
+            stride *= layout.shape()[d];
+          }
+          return off;
+        };
+        size_t ncopied = 0;
+        for (long long k = 0; k < outlayout.size(); ++k) {
+          point_t p(rank);
+          long long k1 = k;
+          for (int d = 0; d < rank; ++d) {
+            p[d] = outlayout.lower()[d] + k1 % outlayout.shape()[d];
+            k1 /= outlayout.shape()[d];
+          }
+          const auto outoff = offset(outlayout, p);
+          if (box.contains(p)) {
+            const auto inoff = offset(inlayout, p);
+            EXPECT_TRUE(std::equal(&out[outoff], &out[outoff + type_size],
+                              &in[inoff]));
+            ++ncopied;
+          } else {
+            EXPECT_TRUE(std::all_of(&out[outoff], &out[outoff + type_size],
+                               [](unsigned char c) { return c == 0; }));
+          }
+        }
+        EXPECT_EQ(box.size(), ncopied);
+
+        // Transpose the innermost two dimensions while copying; this uses C
+        // rather than Fortran order for the output
+        if (rank >= 2) {
+          const point_t shape = box.shape();
+          point_t instrides(rank), outstrides(rank);
+          ptrdiff_t instride = type_size, outstride = type_size;
+          for (int d = 0; d < rank; ++d) {
+            instrides[d] = instride;
+            instride *= shape[d];
+          }
+          for (int d = rank - 1; d >= 0; --d) {
+            outstrides[d] = outstride;
+            outstride *= shape[d];
+          }
+          vector<unsigned char> tin(box.size() * type_size),
+              tout(box.size() * type_size);
+          for (size_t i = 0; i < tin.size(); ++i)
+            tin[i] = (unsigned char)(i * 3 + 5);
+          HyperSlab::copy(tout.data(), tout.size(), 0, outstrides, tin.data(),
+                          tin.size(), 0, instrides, shape, type_size);
+          for (long long k = 0; k < box.size(); ++k) {
+            long long k1 = k;
+            ptrdiff_t inoff = 0, outoff = 0;
+            for (int d = 0; d < rank; ++d) {
+              const auto i = k1 % shape[d];
+              k1 /= shape[d];
+              inoff += i * instrides[d];
+              outoff += i * outstrides[d];
+            }
+            EXPECT_TRUE(std::equal(&tout[outoff], &tout[outoff + type_size],
+                              &tin[inoff]));
+          }
+        }
+      }
+    }
+  }
+  HyperSlab::copy_settings() = old_settings;
+}
+
+TEST(HyperSlab, serial_copies) {
+  const auto old_settings = HyperSlab::copy_settings();
+  HyperSlab::copy_settings().nthreads = 3;
+  EXPECT_EQ(3, HyperSlab::copy_nthreads());
+  {
+    HyperSlab::serial_copies serial;
+    EXPECT_EQ(1, HyperSlab::copy_nthreads());
+    {
+      HyperSlab::serial_copies nested;
+      EXPECT_EQ(1, HyperSlab::copy_nthreads());
+    }
+    EXPECT_EQ(1, HyperSlab::copy_nthreads());
+    // Other threads are not affected
+    EXPECT_EQ(3, std::async(std::launch::async, [] {
+                   return HyperSlab::copy_nthreads();
+                 }).get());
+  }
+  EXPECT_EQ(3, HyperSlab::copy_nthreads());
+  HyperSlab::copy_settings() = old_settings;
+}
+
+TEST(HyperSlab, copy_high_rank) {
+  std::mt19937 gen;
+  const auto irand = [&](int n) {
+    return std::uniform_int_distribution<int>(0, n - 1)(gen);
+  };
+  for (int iter = 0; iter < 20; ++iter) {
+    const int rank = 5 + irand(3);
+    const int type_size = std::vector<int>{1, 4, 8, 12}[irand(4)];
+    // Pad the input, and permute the dimensions of the output, so that the
+    // strides cannot be compressed to rank 4 or lower
+    vector<ptrdiff_t> shape(rank), instrides(rank), outstrides(rank);
+    vector<int> perm(rank);
+    for (int d = 0; d < rank; ++d) {
+      shape[d] = 1 + irand(4);
+      perm[d] = d;
+    }
+    std::shuffle(perm.begin(), perm.end(), gen);
+    ptrdiff_t instride = type_size, outstride = type_size;
+    for (int d = 0; d < rank; ++d) {
+      instrides[d] = instride;
+      instride *= shape[d] + irand(2);
+      outstrides[perm[d]] = outstride;
+      outstride *= shape[perm[d]];
+    }
+    vector<unsigned char> in(instride), out(outstride, 0);
+    for (size_t i = 0; i < in.size(); ++i)
+      in[i] = (unsigned char)(i * 7 + 1);
+    HyperSlab::copy(out.data(), out.size(), 0, outstrides, in.data(),
+                    in.size(), 0, instrides, shape, type_size);
+    vector<ptrdiff_t> idx(rank, 0);
+    while (true) {
+      ptrdiff_t inoff = 0, outoff = 0;
+      for (int d = 0; d < rank; ++d) {
+        inoff += idx[d] * instrides[d];
+        outoff += idx[d] * outstrides[d];
+      }
+      EXPECT_TRUE(
+          std::equal(&out[outoff], &out[outoff + type_size], &in[inoff]));
+      int d = 0;
+      for (; d < rank; ++d) {
+        if (++idx[d] < shape[d])
+          break;
+        idx[d] = 0;
+      }
+      if (d == rank)
+        break;
+    }
+  }
+}
+
+TEST(HyperSlab, convert) {
+  const box_t layout(point_t(vector<int>{0, 0}), point_t(vector<int>{5, 4}));
+  const box_t box(point_t(vector<int>{1, 1}), point_t(vector<int>{4, 3}));
+  vector<double> din(layout.size());
+  for (size_t i = 0; i < din.size(); ++i)
+    din[i] = 0.5 + i;
+  vector<float> fout(box.size());
+  HyperSlab::copy(fout.data(), fout.size(), box, box,
+                  HyperSlab::get_elttype(float{}), din.data(), din.size(),
+                  layout, box, HyperSlab::get_elttype(double{}));
+  EXPECT_EQ((vector<float>{6.5, 7.5, 8.5, 11.5, 12.5, 13.5}), fout);
+
+  vector<int> iin{-2, -1, 0, 1, 2, std::numeric_limits<int>::max()};
+  const box_t box1(point_t(vector<int>{0}), point_t(vector<int>{6}));
+  vector<int64_t> lout(iin.size());
+  HyperSlab::copy(lout.data(), lout.size(), box1, box1,
+                  HyperSlab::get_elttype(int64_t{}), iin.data(), iin.size(),
+                  box1, box1, HyperSlab::get_elttype(int{}));
+  EXPECT_EQ((vector<int64_t>{-2, -1, 0, 1, 2, std::numeric_limits<int>::max()}),
+            lout);
+
+  // Out-of-range values are clamped
+  vector<uint8_t> bout(iin.size());
+  HyperSlab::copy(bout.data(), bout.size(), box1, box1,
+                  HyperSlab::get_elttype(uint8_t{}), iin.data(), iin.size(),
+                  box1, box1, HyperSlab::get_elttype(int{}));
+  EXPECT_EQ((vector<uint8_t>{0, 0, 0, 1, 2, 255}), bout);
+  vector<double> fin{-1.0e10, -1.5, std::nan(""), 1.5, 1.0e10, 1.0e20};
+  vector<int> iout(fin.size());
+  HyperSlab::copy(iout.data(), iout.size(), box1, box1,
+                  HyperSlab::get_elttype(int{}), fin.data(), fin.size(), box1,
+                  box1, HyperSlab::get_elttype(double{}));
+  EXPECT_EQ((vector<int>{std::numeric_limits<int>::min(), -1, 0, 1,
+                         std::numeric_limits<int>::max(),
+                         std::numeric_limits<int>::max()}),
+            iout);
+}
+
+TEST(norm_t, reduction) {
+  vector<double> xs(1000);
+  for (size_t i = 0; i < xs.size(); ++i)
+    xs[i] = i % 7 == 0 ? 0 : double(i % 13) - 6.5;
+  norm_t<double> expected;
+  for (const double x : xs)
+    expected += x;
+  for (const ptrdiff_t n : {0, 1, 7, 8, 9, 1000}) {
+    norm_t<double> partial;
+    for (ptrdiff_t i = 0; i < n; ++i)
+      partial += xs[i];
+    const norm_t<double> norm(xs.data(), n);
+    EXPECT_EQ(partial.count(), norm.count());
+    EXPECT_EQ(partial.zeros(), norm.zeros());
+    EXPECT_EQ(partial.min(), norm.min());
+    EXPECT_EQ(partial.max(), norm.max());
+    EXPECT_DOUBLE_EQ(partial.sum(), norm.sum());
+    EXPECT_DOUBLE_EQ(partial.sum_abs(), norm.sum_abs());
+    EXPECT_DOUBLE_EQ(partial.sum_abs_squared(), norm.sum_abs_squared());
+  }
+
+  // Force splitting over threads
+  auto &settings = HyperSlab::copy_settings();
+  const auto old_settings = settings;
+  settings.cutoff = 0;
+  settings.nthreads = 3;
+  const auto norm = parallel_norm(xs.data(), xs.size());
+  EXPECT_EQ(expected.count(), norm.count());
+  EXPECT_EQ(expected.zeros(), norm.zeros());
+  EXPECT_DOUBLE_EQ(expected.sum_abs_squared(), norm.sum_abs_squared());
+
+  // Copy the interior of a 2D array, calculating the norm while copying
+  const box_t inlayout(point_t(vector<int>{0, 0}),
+                       point_t(vector<int>{40, 25}));
+  const box_t box(point_t(vector<int>{3, 2}), point_t(vector<int>{37, 21}));
+  vector<double> out(box.size());
+  norm_t<double> copy_norm;
+  HyperSlab::copy(out.data(), out.size(), box, box, xs.data(), xs.size(),
+                  inlayout, box, copy_norm);
+  norm_t<double> box_norm;
+  for (int j = 2; j < 21; ++j)
+    for (int i = 3; i < 37; ++i) {
+      const double x = xs[i + 40 * j];
+      EXPECT_EQ(x, out[(i - 3) + 34 * (j - 2)]);
+      box_norm += x;
+    }
+  EXPECT_EQ(box_norm.count(), copy_norm.count());
+  EXPECT_EQ(box_norm.zeros(), copy_norm.zeros());
+  EXPECT_EQ(box_norm.min(), copy_norm.min());
+  EXPECT_EQ(box_norm.max(), copy_norm.max());
+  EXPECT_DOUBLE_EQ(box_norm.sum_abs(), copy_norm.sum_abs());
+
+  // Convert while copying; the norm is that of the original elements
+  vector<float> fout(box.size());
+  norm_t<double> convert_norm;
+  HyperSlab::copy(fout.data(), fout.size(), box, box,
+                  HyperSlab::elttype_t::float32, xs.data(), xs.size(),
+                  inlayout, box, convert_norm);
+  for (size_t i = 0; i < out.size(); ++i)
+    EXPECT_EQ(float(out[i]), fout[i]);
+  EXPECT_EQ(box_norm.count(), convert_norm.count());
+  EXPECT_DOUBLE_EQ(box_norm.sum_abs(), convert_norm.sum_abs());
+  settings = old_settings;
+}
+
+TEST(WriteOptions, chunk_shape) {
+  typedef WriteOptions::access_pattern_t pattern_t;
+  const point_t shape(vector<int>{200, 200, 200});
+  WriteOptions write_options;
+  // 2 MByte, as compact as possible
+  EXPECT_TRUE(all(point_t(vector<int>{64, 64, 64}) ==
+                  write_options.chunk_shape(shape, 8)));
+  // A chunk never exceeds the dataset
+  EXPECT_TRUE(all(point_t(vector<int>{3, 5}) ==
+                  write_options.chunk_shape(point_t(vector<int>{3, 5}), 8)));
+  EXPECT_TRUE(all(point_t(vector<int>{0, 5}) ==
+                  write_options.chunk_shape(point_t(vector<int>{0, 5}), 8)));
+  write_options.chunk_bytes = 64 * 1024;
+  EXPECT_TRUE(all(point_t(vector<int>{32, 16, 16}) ==
+                  write_options.chunk_shape(shape, 8)));
+  write_options.chunk_bytes = 0;
+  write_options.access_pattern = pattern_t::slice;
+  EXPECT_TRUE(all(point_t(vector<int>{200, 200, 1}) ==
+                  write_options.chunk_shape(shape, 8)));
+  write_options.slice_dir = 0;
+  EXPECT_TRUE(all(point_t(vector<int>{1, 200, 200}) ==
+                  write_options.chunk_shape(shape, 8)));
+  write_options.access_pattern = pattern_t::point;
+  EXPECT_TRUE(all(point_t(vector<int>{8, 8, 8}) ==
+                  write_options.chunk_shape(shape, 8)));
+}
+
 #ifdef SIMULATIONIO_HAVE_HDF5
 TEST(HDF5, types) {
   auto filename = "types.s5";
@@ -156,6 +471,711 @@ TEST(HDF5, types) {
 }
 #endif
 
+TEST(DataRange, readData) {
+  const box_t box(point_t(vector<int>{2, 3, 4}),
+                  point_t(vector<int>{30, 9, 8}));
+  const vector<double> delta{0.5, -1, 100};
+  const DataRange datarange(WriteOptions(), box, 7, delta);
+  const auto value = [&](int i, int j, int k) {
+    return 7 + 0.5 * (i - 2) - (j - 3) + 100 * (k - 4);
+  };
+  const auto data = datarange.readData<double>();
+  ASSERT_EQ(box.size(), data.size());
+  EXPECT_EQ(value(2, 3, 4), data.at(0));
+  EXPECT_EQ(value(29, 8, 7), data.back());
+  // A sub-box into a larger layout, converted to int
+  const box_t layout(point_t(vector<int>{0, 0, 0}),
+                     point_t(vector<int>{40, 10, 10}));
+  const box_t subbox(point_t(vector<int>{5, 4, 6}),
+                     point_t(vector<int>{25, 7, 8}));
+  vector<int> idata(layout.size(), -1);
+  datarange.readData(idata.data(), layout, subbox);
+  for (int k = 0; k < 10; ++k)
+    for (int j = 0; j < 10; ++j)
+      for (int i = 0; i < 40; ++i) {
+        const bool inside = i >= 5 && i < 25 && j >= 4 && j < 7 && k >= 6 &&
+                            k < 8;
+        EXPECT_EQ(inside ? int(value(i, j, k)) : -1,
+                  idata.at(i + 40 * (j + 10 * k)));
+      }
+  // Integer values are clamped
+  const DataRange large(WriteOptions(), box, 1.0e+10, delta);
+  EXPECT_EQ(numeric_limits<int>::max(), large.readData<int>().at(0));
+}
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+TEST(DataSet, attachData_borrowed) {
+  auto filename = "attachdata.s5";
+  const box_t layout(point_t(vector<int>{0, 0}), point_t(vector<int>{4, 3}));
+  // A contiguous box (written directly), a strided box (repacked), and a
+  // contiguous box with a different type (converted)
+  const vector<box_t> boxes{
+      box_t(point_t(vector<int>{0, 1}), point_t(vector<int>{4, 3})),
+      box_t(point_t(vector<int>{1, 0}), point_t(vector<int>{3, 3})),
+      box_t(point_t(vector<int>{0, 0}), point_t(vector<int>{4, 2}))};
+  for (size_t n = 0; n < boxes.size(); ++n) {
+    const auto &box = boxes[n];
+    auto data = std::make_shared<vector<float>>(layout.size());
+    for (size_t i = 0; i < data->size(); ++i)
+      (*data)[i] = i;
+    bool released = false;
+    std::shared_ptr<vector<float>> owner(
+        data.get(), [data, &released](vector<float> *) { released = true; });
+    data.reset();
+    const auto ds =
+        n == 2 ? std::make_shared<DataSet>(double{}, WriteOptions(), box)
+               : std::make_shared<DataSet>(float{}, WriteOptions(), box);
+    ds->attachData(owner, layout, box);
+    owner.reset();
+    EXPECT_FALSE(released);
+    {
+      auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+      ds->write(file.openGroup("/"), "data");
+      EXPECT_TRUE(released);
+      vector<double> result(box.size());
+      file.openDataSet("data").read(result.data(),
+                                    H5::PredType::NATIVE_DOUBLE);
+      vector<double> expected;
+      for (int j = box.lower()[1]; j < box.upper()[1]; ++j)
+        for (int i = box.lower()[0]; i < box.upper()[0]; ++i)
+          expected.push_back(i + 4 * j);
+      EXPECT_EQ(expected, result);
+    }
+  }
+  remove(filename);
+}
+#endif
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+TEST(DataSet, attachData_norm) {
+  auto filename = "attachnorm.s5";
+  const box_t box(point_t(vector<int>{0, 0}), point_t(vector<int>{30, 20}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i % 5 == 0 ? 0 : double(i) - 100;
+  const norm_t<double> expected(data);
+  for (int mode = 0; mode < 4; ++mode) {
+    // Attach or write data; the norm is calculated while the data are
+    // copied, converted to float, or repacked for parallel filtering
+    const bool attach = mode == 1 || mode == 2;
+    WriteOptions write_options;
+    write_options.parallel_filters = mode == 3;
+    write_options.compress = mode == 3;
+    const auto ds =
+        mode == 2 ? std::make_shared<DataSet>(float{}, write_options, box)
+                  : std::make_shared<DataSet>(double{}, write_options, box);
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    if (attach) {
+      ds->attachData(data);
+      ds->write(file.openGroup("/"), "data");
+    } else {
+      ds->write(file.openGroup("/"), "data");
+      ds->writeData(data);
+    }
+    vector<double> result(box.size());
+    ds->dataset().read(result.data(), H5::PredType::NATIVE_DOUBLE);
+    EXPECT_EQ(data, result);
+    long long num_zeros;
+    double minimum, maximum, sum_abs;
+    H5::readAttribute(ds->dataset(), "num_zeros", num_zeros);
+    H5::readAttribute(ds->dataset(), "minimum", minimum);
+    H5::readAttribute(ds->dataset(), "maximum", maximum);
+    H5::readAttribute(ds->dataset(), "sum_abs", sum_abs);
+    EXPECT_EQ(expected.zeros(), num_zeros);
+    EXPECT_EQ(expected.min(), minimum);
+    EXPECT_EQ(expected.max(), maximum);
+    EXPECT_DOUBLE_EQ(expected.sum_abs(), sum_abs);
+  }
+  remove(filename);
+}
+
+TEST(DataSet, parallel_filters) {
+  auto filename = "parallelfilters.s5";
+  // Large enough for several chunks, and not a multiple of the chunk size
+  const box_t box(point_t(vector<int>{1, 2, 3}),
+                  point_t(vector<int>{1 + 70, 2 + 90, 3 + 110}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i % 1000;
+  // The chunk copies would be split over threads if they were not serial
+  const auto old_settings = HyperSlab::copy_settings();
+  HyperSlab::copy_settings().cutoff = 0;
+  HyperSlab::copy_settings().nthreads = 3;
+  for (const bool checksum : {false, true}) {
+    WriteOptions write_options;
+    write_options.checksum = checksum;
+    write_options.parallel_filters = true;
+    const DataSet ds(double{}, write_options, box);
+    {
+      auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+      ds.write(file.openGroup("/"), "data");
+      ds.writeData(data, box);
+      EXPECT_LT(ds.dataset().getStorageSize(), data.size() * sizeof(double));
+    }
+    {
+      // Read with plain HDF5, which applies (and checks) the filters
+      auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+      vector<double> result(box.size());
+      file.openDataSet("data").read(result.data(),
+                                    H5::PredType::NATIVE_DOUBLE);
+      EXPECT_EQ(data, result);
+    }
+  }
+  HyperSlab::copy_settings() = old_settings;
+  remove(filename);
+}
+
+TEST(DataSet, compression_methods) {
+  auto filename = "compressionmethods.s5";
+  const box_t box(point_t(vector<int>{0, 0}), point_t(vector<int>{300, 200}));
+  vector<int> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = (i * i) % 1237;
+  typedef WriteOptions::compression_method_t method_t;
+  const vector<std::pair<method_t, H5Z_filter_t>> methods{
+      {method_t::bzip2, H5::H5Z_FILTER_BZIP2},
+      {method_t::lz4, H5::H5Z_FILTER_LZ4},
+      {method_t::szip, H5Z_FILTER_SZIP},
+      {method_t::zlib, H5Z_FILTER_DEFLATE}};
+  for (const auto &method : methods) {
+    for (const bool parallel_filters : {false, true}) {
+      WriteOptions write_options;
+      write_options.compression_method = method.first;
+      write_options.parallel_filters = parallel_filters;
+      const DataSet ds(int{}, write_options, box);
+      {
+        auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+        ds.write(file.openGroup("/"), "data");
+        ds.writeData(data, box);
+        EXPECT_LT(ds.dataset().getStorageSize(), data.size() * sizeof(int));
+        // The requested method is used if it is available, and deflate
+        // otherwise
+        const auto proplist = ds.dataset().getCreatePlist();
+        const int nfilters = proplist.getNfilters();
+        ASSERT_GT(nfilters, 0);
+        unsigned int flags;
+        size_t cd_nelmts = 0;
+        unsigned int filter_config;
+        const H5Z_filter_t filter =
+            proplist.getFilter(nfilters - 1, flags, cd_nelmts, nullptr, 0,
+                               nullptr, filter_config);
+        EXPECT_EQ(H5::filterCanEncode(method.second) ? method.second
+                                                     : H5Z_FILTER_DEFLATE,
+                  filter);
+      }
+      {
+        auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+        vector<int> result(box.size());
+        file.openDataSet("data").read(result.data(), H5::PredType::NATIVE_INT);
+        EXPECT_EQ(data, result);
+      }
+    }
+  }
+  remove(filename);
+}
+#endif
+
+#ifdef SIMULATIONIO_HAVE_HDF5
+TEST(CopyObj, dataset_cache) {
+  auto filename = "datasetcache.s5";
+  // 4 MByte, with 2 MByte chunks
+  const box_t box(point_t(vector<int>{0, 0, 0}),
+                  point_t(vector<int>{128, 64, 64}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i;
+  {
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    for (const string name : {"a", "b", "c"}) {
+      const DataSet ds(double{}, WriteOptions(), box);
+      ds.write(file.openGroup("/"), name);
+      ds.writeData(data, box);
+    }
+  }
+  auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+  const auto group = file.openGroup("/");
+  const auto cache = DataSetCache::get(group);
+  EXPECT_EQ(cache, DataSetCache::get(group));
+  EXPECT_EQ(0, cache->size());
+  const CopyObj copyobj(WriteOptions(), box, group, "a");
+  for (int k = 0; k < 64; k += 16) {
+    const box_t slice(point_t(vector<int>{0, 0, k}),
+                      point_t(vector<int>{128, 64, k + 1}));
+    const auto result = copyobj.readData<double>(slice);
+    for (int j = 0; j < 64; ++j)
+      for (int i = 0; i < 128; ++i)
+        EXPECT_EQ(i + 128 * (j + 64 * k), result[i + 128 * j]);
+  }
+  EXPECT_EQ(1, cache->size());
+  // The chunk cache holds a layer of chunks
+  const auto entry = cache->open(group, "a", WriteOptions().access_pattern);
+  const auto dapl = H5::take_hid(H5Dget_access_plist(entry.dataset.getId()));
+  size_t nslots, nbytes;
+  double w0;
+  H5Pget_chunk_cache(dapl, &nslots, &nbytes, &w0);
+  EXPECT_GE(nbytes, size_t(4) << 20);
+  // The chunk cache is counted against the global budget
+  const size_t layer_bytes = nbytes;
+  const size_t used = DataSetCache::total_chunk_cache_bytes();
+  EXPECT_GE(used, layer_bytes);
+  // Other access patterns open the dataset with their own chunk cache
+  cache->open(group, "a", WriteOptions::access_pattern_t::point);
+  EXPECT_EQ(2, cache->size());
+  EXPECT_GT(DataSetCache::total_chunk_cache_bytes(), used);
+  cache->clear();
+  EXPECT_EQ(used - layer_bytes, DataSetCache::total_chunk_cache_bytes());
+  // Datasets opened beyond the budget use HDF5's default chunk cache
+  auto &settings = DataSetCache::settings();
+  const auto old_settings = settings;
+  settings.max_total_chunk_cache_bytes =
+      DataSetCache::total_chunk_cache_bytes();
+  const auto entry2 = cache->open(group, "b", WriteOptions().access_pattern);
+  const auto dapl2 =
+      H5::take_hid(H5Dget_access_plist(entry2.dataset.getId()));
+  H5Pget_chunk_cache(dapl2, &nslots, &nbytes, &w0);
+  EXPECT_EQ(size_t(1) << 20, nbytes);
+  settings = old_settings;
+  // Least recently used datasets are closed
+  settings.max_datasets = 2;
+  cache->open(group, "a", WriteOptions().access_pattern);
+  cache->open(group, "c", WriteOptions().access_pattern);
+  EXPECT_EQ(2, cache->size());
+  EXPECT_EQ(data, copyobj.readData<double>());
+  settings = old_settings;
+  cache->clear();
+  EXPECT_EQ(0, cache->size());
+  EXPECT_EQ(used - layer_bytes, DataSetCache::total_chunk_cache_bytes());
+  remove(filename);
+}
+
+TEST(CopyObj, access_pattern) {
+  // Readers state how they will read a dataset from a project, which sizes
+  // its chunk cache
+  auto filename = "accesspattern.s5";
+  // 8 MByte, with 64 kByte chunks in 4 layers
+  const box_t box(point_t(vector<int>{0, 0, 0}),
+                  point_t(vector<int>{128, 128, 64}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i;
+  {
+    auto p = createProject("accesspattern");
+    auto conf = p->createConfiguration("conf");
+    p->createStandardTensorTypes();
+    auto scalar3d = p->tensortypes().at("Scalar3D");
+    auto m = p->createManifold("m", conf, 3);
+    auto ts = p->createTangentSpace("ts", conf, 3);
+    auto d = m->createDiscretization("d", conf);
+    auto basis = ts->createBasis("basis", conf);
+    auto f = p->createField("f", conf, m, ts, scalar3d);
+    auto df = f->createDiscreteField("df", conf, d, basis);
+    auto db = d->createDiscretizationBlock("db");
+    db->setBox(box);
+    auto dfb = df->createDiscreteFieldBlock("dfb", db);
+    auto dfbc = dfb->createDiscreteFieldBlockComponent(
+        "scalar", scalar3d->storage_indices().at(0));
+    WriteOptions write_options;
+    write_options.chunk_bytes = 64 * 1024;
+    auto ds = dfbc->createDataSet<double>(write_options);
+    ds->attachData(data);
+    p->writeHDF5(filename);
+  }
+  size_t block_bytes = 0;
+  for (const auto pattern : {WriteOptions::access_pattern_t::block,
+                             WriteOptions::access_pattern_t::point}) {
+    auto p = readProjectHDF5(filename);
+    const auto copyobj = p->fields()
+                             .at("f")
+                             ->discretefields()
+                             .at("df")
+                             ->discretefieldblocks()
+                             .at("dfb")
+                             ->discretefieldblockcomponents()
+                             .at("scalar")
+                             ->copyobj();
+    ASSERT_TRUE(bool(copyobj));
+    EXPECT_EQ(WriteOptions::access_pattern_t::block,
+              copyobj->access_pattern());
+    copyobj->setAccessPattern(pattern);
+    EXPECT_EQ(data, copyobj->readData<double>());
+    const auto entry = copyobj->open_dataset();
+    const auto dapl =
+        H5::take_hid(H5Dget_access_plist(entry.dataset.getId()));
+    size_t nslots, nbytes;
+    double w0;
+    H5Pget_chunk_cache(dapl, &nslots, &nbytes, &w0);
+    if (pattern == WriteOptions::access_pattern_t::block) {
+      // A layer of chunks
+      EXPECT_EQ(size_t(2) << 20, nbytes);
+      block_bytes = nbytes;
+    } else {
+      // All chunks
+      EXPECT_EQ(size_t(8) << 20, nbytes);
+      EXPECT_GT(nbytes, block_bytes);
+    }
+  }
+  remove(filename);
+}
+
+TEST(CopyObj, batched_read) {
+  auto filename = "batchedread.s5";
+  const box_t box(point_t(vector<int>{10, 20}), point_t(vector<int>{74, 84}));
+  const auto value = [&](const point_t &p, int c) {
+    return p[0] + 1000 * p[1] + 1000000 * c;
+  };
+  {
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    for (int c = 0; c < 2; ++c) {
+      vector<double> data;
+      for (int j = box.lower()[1]; j < box.upper()[1]; ++j)
+        for (int i = box.lower()[0]; i < box.upper()[0]; ++i)
+          data.push_back(value(point_t(vector<int>{i, j}), c));
+      const DataSet ds(double{}, WriteOptions(), box);
+      ds.write(file.openGroup("/"), "c" + to_string(c));
+      ds.writeData(data, box);
+    }
+  }
+  auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+  const auto group = file.openGroup("/");
+  vector<shared_ptr<const DataBlock>> datablocks;
+  for (int c = 0; c < 2; ++c)
+    datablocks.push_back(
+        make_shared<CopyObj>(WriteOptions(), box, group, "c" + to_string(c)));
+  // A third component is a data range
+  datablocks.push_back(make_shared<DataRange>(
+      WriteOptions(), box, value(box.lower(), 2), vector<double>{1, 1000}));
+  // Overlapping boxes from all components, and scattered single points
+  vector<box_t> boxes;
+  const auto make_box = [](int i0, int j0, int i1, int j1) {
+    return box_t(point_t(vector<int>{i0, j0}), point_t(vector<int>{i1, j1}));
+  };
+  boxes.push_back(make_box(10, 20, 30, 40));
+  boxes.push_back(make_box(20, 30, 40, 50));
+  boxes.push_back(make_box(12, 45, 16, 47));
+  vector<box_t> points;
+  for (int n = 0; n < 5; ++n) {
+    const point_t p(vector<int>{10 + 13 * n, 20 + 11 * n});
+    points.push_back(box_t(p, p + point_t(2, 1)));
+  }
+  vector<vector<double>> results;
+  vector<vector<float>> fresults;
+  results.reserve(3 * boxes.size());
+  fresults.reserve(points.size());
+  vector<DataBlock::read_request_t> requests;
+  for (int c = 0; c < 3; ++c) {
+    for (const auto &b : boxes) {
+      results.push_back(vector<double>(b.size()));
+      requests.push_back({datablocks[c], results.back().data(),
+                          H5::getType(double{}), b, b});
+    }
+  }
+  for (const auto &b : points) {
+    fresults.push_back(vector<float>(b.size()));
+    requests.push_back(
+        {datablocks[1], fresults.back().data(), H5::getType(float{}), b, b});
+  }
+  DataBlock::readData(requests);
+  const auto check = [&](const vector<double> &result, const box_t &b, int c) {
+    size_t n = 0;
+    for (int j = b.lower()[1]; j < b.upper()[1]; ++j)
+      for (int i = b.lower()[0]; i < b.upper()[0]; ++i)
+        EXPECT_EQ(value(point_t(vector<int>{i, j}), c), result.at(n++));
+  };
+  for (int c = 0; c < 3; ++c)
+    for (size_t n = 0; n < boxes.size(); ++n)
+      check(results.at(c * boxes.size() + n), boxes[n], c);
+  for (size_t n = 0; n < points.size(); ++n)
+    check(vector<double>(fresults.at(n).begin(), fresults.at(n).end()),
+          points[n], 1);
+  // Blocks that cannot be read, and types that data ranges cannot generate
+  vector<double> unused(box.size());
+  const auto dataset = make_shared<DataSet>(double{}, WriteOptions(), box);
+  EXPECT_THROW(DataBlock::readData(
+                   {{dataset, unused.data(), H5::getType(double{}), box, box}}),
+               invalid_argument);
+  EXPECT_THROW(DataBlock::readData({{datablocks[2], unused.data(),
+                                     H5::getType(complex<double>{}), box,
+                                     box}}),
+               invalid_argument);
+  remove(filename);
+}
+
+TEST(CopyObj, mapData) {
+  auto filename = "mapdata.s5";
+  const box_t box(point_t(vector<int>{3, 4, 5}),
+                  point_t(vector<int>{13, 14, 15}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i;
+  WriteOptions contiguous;
+  contiguous.chunk = false;
+  contiguous.compress = false;
+  contiguous.shuffle = false;
+  contiguous.checksum = false;
+  {
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    const DataSet ds(double{}, contiguous, box);
+    ds.write(file.openGroup("/"), "contiguous");
+    ds.writeData(data, box);
+    const DataSet ds2(double{}, WriteOptions(), box);
+    ds2.write(file.openGroup("/"), "chunked");
+    ds2.writeData(data, box);
+  }
+  auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+  const CopyObj copyobj(contiguous, box, file, "contiguous");
+  const auto mapped = copyobj.mapData();
+  ASSERT_TRUE(mapped.valid());
+  EXPECT_TRUE(mapped.layout() == box);
+  EXPECT_EQ(data, vector<double>(mapped.data<double>(),
+                                 mapped.data<double>() + box.size()));
+  const ExtLink extlink(contiguous, box, filename, "contiguous");
+  EXPECT_EQ(data[123], extlink.mapData().data<double>()[123]);
+  H5FileCache::get().clear();
+  const CopyObj copyobj2(WriteOptions(), box, file, "chunked");
+  EXPECT_FALSE(copyobj2.mapData().valid());
+  remove(filename);
+}
+
+TEST(ExtLink, readData) {
+  const int nfiles = 3;
+  const auto filename = [](int f) {
+    return "extlinkdata" + to_string(f) + ".s5";
+  };
+  const box_t box(point_t(vector<int>{4, 5}), point_t(vector<int>{14, 12}));
+  const auto make_data = [&](int f) {
+    vector<int> data(box.size());
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = 1000 * f + i;
+    return data;
+  };
+  for (int f = 0; f < nfiles; ++f) {
+    auto file = H5::H5File(filename(f), H5F_ACC_TRUNC);
+    const DataSet ds(int{}, WriteOptions(), box);
+    ds.write(file.createGroup("group"), "data");
+    ds.writeData(make_data(f), box);
+  }
+  auto &cache = H5FileCache::get();
+  auto &settings = H5FileCache::settings();
+  const auto old_settings = settings;
+  settings.max_files = 2;
+  cache.clear();
+  for (int iter = 0; iter < 2; ++iter) {
+    for (int f = 0; f < nfiles; ++f) {
+      const ExtLink extlink(WriteOptions(), box, filename(f), "/group/data");
+      EXPECT_EQ(make_data(f), extlink.readData<int>());
+      const box_t subbox(point_t(vector<int>{5, 6}),
+                         point_t(vector<int>{7, 8}));
+      const auto result = extlink.readData<double>(subbox);
+      EXPECT_EQ(1000 * f + 1 + 10 * 1, result.at(0));
+      EXPECT_EQ(1000 * f + 2 + 10 * 2, result.at(3));
+    }
+  }
+  // Least recently used files are closed
+  EXPECT_EQ(2, cache.size());
+  settings = old_settings;
+  cache.clear();
+  EXPECT_EQ(0, cache.size());
+  for (int f = 0; f < nfiles; ++f)
+    remove(filename(f).c_str());
+}
+
+TEST(ExtLink, readProject) {
+  // The project and the data are in a directory, and the external link
+  // refers to the data file by its bare name, as convert-carpet-output does.
+  // The data are read from the current directory.
+  const string dir = "extlinkproject";
+  const string datafilename = "extlinkdata.s5";
+  const string projectfilename = dir + "/project.s5";
+  mkdir(dir.c_str(), 0755);
+  remove(projectfilename.c_str());
+  const box_t box(point_t(vector<int>{2, 3}), point_t(vector<int>{9, 7}));
+  vector<double> data(box.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = 10 + i;
+  {
+    auto file = H5::H5File(dir + "/" + datafilename, H5F_ACC_TRUNC);
+    const DataSet ds(double{}, WriteOptions(), box);
+    ds.write(file.openGroup("/"), "data");
+    ds.writeData(data, box);
+  }
+  {
+    auto p = createProject("extlink");
+    auto conf = p->createConfiguration("conf");
+    p->createStandardTensorTypes();
+    auto scalar2d = p->tensortypes().at("Scalar2D");
+    auto m = p->createManifold("m", conf, 2);
+    auto ts = p->createTangentSpace("ts", conf, 2);
+    auto d = m->createDiscretization("d", conf);
+    auto basis = ts->createBasis("basis", conf);
+    auto f = p->createField("f", conf, m, ts, scalar2d);
+    auto df = f->createDiscreteField("df", conf, d, basis);
+    auto db = d->createDiscretizationBlock("db");
+    db->setBox(box);
+    auto dfb = df->createDiscreteFieldBlock("dfb", db);
+    auto dfbc = dfb->createDiscreteFieldBlockComponent(
+        "scalar", scalar2d->storage_indices().at(0));
+    dfbc->createExtLink(WriteOptions(), datafilename, "data");
+    p->writeHDF5(projectfilename);
+  }
+  auto &cache = H5FileCache::get();
+  cache.clear();
+  {
+    auto p = readProjectHDF5(projectfilename);
+    const auto copyobj = p->fields()
+                             .at("f")
+                             ->discretefields()
+                             .at("df")
+                             ->discretefieldblocks()
+                             .at("dfb")
+                             ->discretefieldblockcomponents()
+                             .at("scalar")
+                             ->copyobj();
+    ASSERT_TRUE(bool(copyobj));
+    EXPECT_TRUE(copyobj->is_extlink());
+    EXPECT_EQ(H5::canonicalFileName(dir + "/" + datafilename),
+              copyobj->extfilename());
+    EXPECT_EQ(data, copyobj->readData<double>());
+    const box_t subbox(point_t(vector<int>{3, 4}), point_t(vector<int>{5, 6}));
+    EXPECT_EQ(10 + 1 + 7 * 1, copyobj->readData<double>(subbox).at(0));
+    // The data file is kept open in the pool, under its canonical name
+    EXPECT_EQ(1, cache.size());
+    cache.open(dir + "/../" + dir + "/" + datafilename);
+    EXPECT_EQ(1, cache.size());
+  }
+  cache.clear();
+  remove(projectfilename.c_str());
+  remove((dir + "/" + datafilename).c_str());
+  rmdir(dir.c_str());
+}
+
+TEST(DataBufferEntry, HDF5) {
+  auto filename = "databuffer.s5";
+  const int nblocks = 3;
+  const auto block_box = [](int b) {
+    return box_t(point_t(vector<int>{4 * b, 0}),
+                 point_t(vector<int>{4 * b + 4, 3}));
+  };
+  const auto value = [](const point_t &p) { return 100 * p[0] + p[1]; };
+  const auto block_data = [&](int b) {
+    const auto box = block_box(b);
+    vector<double> data;
+    for (int j = box.lower()[1]; j < box.upper()[1]; ++j)
+      for (int i = box.lower()[0]; i < box.upper()[0]; ++i)
+        data.push_back(value(point_t(vector<int>{i, j})));
+    return data;
+  };
+  {
+    auto p = createProject("databuffer");
+    auto conf = p->createConfiguration("conf");
+    p->createStandardTensorTypes();
+    auto scalar2d = p->tensortypes().at("Scalar2D");
+    auto m = p->createManifold("m", conf, 2);
+    auto ts = p->createTangentSpace("ts", conf, 2);
+    auto d = m->createDiscretization("d", conf);
+    auto basis = ts->createBasis("basis", conf);
+    auto f = p->createField("f", conf, m, ts, scalar2d);
+    auto df = f->createDiscreteField("df", conf, d, basis);
+    auto databuffer = make_shared<DataBuffer>(2, H5::getType(double{}));
+    vector<shared_ptr<DataBufferEntry>> entries;
+    for (int b = 0; b < nblocks; ++b) {
+      auto db = d->createDiscretizationBlock("db" + std::to_string(b));
+      db->setBox(block_box(b));
+      auto dfb = df->createDiscreteFieldBlock("dfb" + std::to_string(b), db);
+      auto dfbc = dfb->createDiscreteFieldBlockComponent(
+          "scalar", scalar2d->storage_indices().at(0));
+      entries.push_back(dfbc->createDataBufferEntry(
+          WriteOptions(), H5::getType(double{}), databuffer));
+    }
+    // Data written before the file are collected in memory, data written
+    // afterwards go directly into the dataset
+    entries.at(0)->writeData(block_data(0));
+    entries.at(1)->writeData(block_data(1));
+    auto file = H5::H5File(filename, H5F_ACC_TRUNC);
+    p->write(file);
+    entries.at(2)->writeData(block_data(2));
+  }
+  {
+    auto file = H5::H5File(filename, H5F_ACC_RDONLY);
+    auto p = readProject(file);
+    auto df = p->fields().at("f")->discretefields().at("df");
+    for (int b = 0; b < nblocks; ++b) {
+      auto entry = df->discretefieldblocks()
+                       .at("dfb" + std::to_string(b))
+                       ->discretefieldblockcomponents()
+                       .at("scalar")
+                       ->databufferentry();
+      ASSERT_TRUE(bool(entry));
+      EXPECT_EQ(4 * 3 * b, entry->pos());
+      EXPECT_EQ(block_data(b), entry->readData<double>());
+      // Read part of the block, converting to a different type
+      const auto box = block_box(b);
+      const box_t subbox(box.lower() + point_t(vector<int>{1, 1}),
+                         box.upper());
+      const auto sub = entry->readData<float>(subbox);
+      EXPECT_EQ(subbox.size(), sub.size());
+      EXPECT_EQ(value(subbox.lower()), sub.at(0));
+      EXPECT_EQ(value(subbox.upper() - point_t(vector<int>{1, 1})),
+                sub.back());
+    }
+  }
+  remove(filename);
+}
+
+TEST(DataBufferEntry, shared) {
+  // Many small blocks are stored in one buffer, which all entries share
+  // when they are read back
+  auto filename = "databuffershared.s5";
+  const int nblocks = 1000;
+  const auto block_box = [](int b) {
+    return box_t(point_t(vector<int>{2 * b}), point_t(vector<int>{2 * b + 2}));
+  };
+  {
+    auto p = createProject("databuffershared");
+    auto conf = p->createConfiguration("conf");
+    p->createStandardTensorTypes();
+    auto scalar1d = p->tensortypes().at("Scalar1D");
+    auto m = p->createManifold("m", conf, 1);
+    auto ts = p->createTangentSpace("ts", conf, 1);
+    auto d = m->createDiscretization("d", conf);
+    auto basis = ts->createBasis("basis", conf);
+    auto f = p->createField("f", conf, m, ts, scalar1d);
+    auto df = f->createDiscreteField("df", conf, d, basis);
+    auto databuffer = make_shared<DataBuffer>(1, H5::getType(double{}));
+    for (int b = 0; b < nblocks; ++b) {
+      auto db = d->createDiscretizationBlock("db" + std::to_string(b));
+      db->setBox(block_box(b));
+      auto dfb = df->createDiscreteFieldBlock("dfb" + std::to_string(b), db);
+      auto dfbc = dfb->createDiscreteFieldBlockComponent(
+          "scalar", scalar1d->storage_indices().at(0));
+      auto entry = dfbc->createDataBufferEntry(
+          WriteOptions(), H5::getType(double{}), databuffer);
+      entry->writeData(vector<double>{double(b), b + 0.5});
+    }
+    p->writeHDF5(filename);
+  }
+  auto p = readProjectHDF5(filename);
+  auto df = p->fields().at("f")->discretefields().at("df");
+  shared_ptr<DataBuffer> databuffer;
+  for (int b = 0; b < nblocks; ++b) {
+    auto entry = df->discretefieldblocks()
+                     .at("dfb" + std::to_string(b))
+                     ->discretefieldblockcomponents()
+                     .at("scalar")
+                     ->databufferentry();
+    ASSERT_TRUE(bool(entry));
+    if (b == 0)
+      databuffer = entry->databuffer();
+    EXPECT_EQ(databuffer, entry->databuffer());
+    EXPECT_EQ(b, entry->index());
+    EXPECT_EQ(2 * b, entry->pos());
+    EXPECT_EQ((vector<double>{double(b), b + 0.5}), entry->readData<double>());
+  }
+  // The positions are taken from the buffer's offset table
+  EXPECT_EQ(2 * nblocks, databuffer->offset(nblocks));
+  remove(filename);
+}
+#endif
+
 shared_ptr<Project> project;
 
 TEST(Project, create) {
@@ -187,6 +1207,133 @@ TEST(Project, HDF5) {
   }
   remove(filename);
 }
+
+TEST(Project, HDF5_async) {
+  const vector<string> filenames{"project-async-0.s5", "project-async-1.s5",
+                                 "project-async-2.s5"};
+  for (const auto &filename : filenames)
+    remove(filename.c_str());
+  ostringstream orig;
+  orig << *project;
+  // More writes than the queue holds; the last call waits for the first
+  vector<std::future<void>> writes;
+  for (const auto &filename : filenames)
+    writes.push_back(project->writeHDF5Async(filename));
+  for (auto &write : writes)
+    write.get();
+  for (const auto &filename : filenames) {
+    auto p1 = readProjectHDF5(filename);
+    ostringstream buf;
+    buf << *p1;
+    EXPECT_EQ(orig.str(), buf.str());
+    remove(filename.c_str());
+  }
+  // Errors are reported via the future
+  auto failed = project->writeHDF5Async("nonexistent-directory/project.s5");
+  EXPECT_ANY_THROW(failed.get());
+}
+
+TEST(Project, HDF5_async_overlap) {
+  // Building a project and attaching data to it does not call HDF5, and can
+  // thus proceed while another project is being written. Serialize HDF5
+  // calls (as if HDF5 was not thread-safe), and hold the library lock on
+  // another thread, so that the first write stays pending meanwhile.
+  const bool old_serialized = H5::isLibrarySerialized();
+  H5::setLibrarySerialized(true);
+  const int nprojects = 4;
+  const box_t box(point_t(vector<int>{0, 0}), point_t(vector<int>{20, 30}));
+  const auto step_data = [&](int n) {
+    vector<double> data(box.size());
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = 1000 * n + i;
+    return data;
+  };
+  const auto filename = [](int n) {
+    return "asyncoverlap" + to_string(n) + ".s5";
+  };
+  const auto build = [&](int n) {
+    auto p = createProject("asyncoverlap" + to_string(n));
+    auto conf = p->createConfiguration("conf");
+    p->createStandardTensorTypes();
+    auto scalar2d = p->tensortypes().at("Scalar2D");
+    auto m = p->createManifold("m", conf, 2);
+    auto ts = p->createTangentSpace("ts", conf, 2);
+    auto d = m->createDiscretization("d", conf);
+    auto basis = ts->createBasis("basis", conf);
+    auto f = p->createField("f", conf, m, ts, scalar2d);
+    auto df = f->createDiscreteField("df", conf, d, basis);
+    auto db = d->createDiscretizationBlock("db");
+    db->setBox(box);
+    auto dfb = df->createDiscreteFieldBlock("dfb", db);
+    auto dfbc = dfb->createDiscreteFieldBlockComponent(
+        "scalar", scalar2d->storage_indices().at(0));
+    auto ds = dfbc->createDataSet<double>(WriteOptions());
+    ds->attachData(step_data(n));
+    return p;
+  };
+  const auto component = [](const shared_ptr<Project> &p) {
+    return p->fields()
+        .at("f")
+        ->discretefields()
+        .at("df")
+        ->discretefieldblocks()
+        .at("dfb")
+        ->discretefieldblockcomponents()
+        .at("scalar");
+  };
+
+  vector<shared_ptr<Project>> projects;
+  vector<std::future<void>> writes;
+  projects.push_back(build(0));
+  std::promise<void> locked, release;
+  auto blocker = std::async(std::launch::async, [&]() {
+    H5::library_lock lock;
+    locked.set_value();
+    release.get_future().wait();
+  });
+  locked.get_future().wait();
+  writes.push_back(projects.back()->writeHDF5Async(filename(0)));
+  // This would wait for the blocker if it called HDF5
+  auto next = std::async(std::launch::async, build, 1);
+  const auto next_status = next.wait_for(std::chrono::seconds(60));
+  const auto write_status = writes.at(0).wait_for(std::chrono::seconds(0));
+  release.set_value();
+  blocker.get();
+  ASSERT_EQ(std::future_status::ready, next_status);
+  EXPECT_EQ(std::future_status::timeout, write_status);
+  projects.push_back(next.get());
+  writes.push_back(projects.back()->writeHDF5Async(filename(1)));
+  for (int n = 2; n < nprojects; ++n) {
+    projects.push_back(build(n));
+    writes.push_back(projects.back()->writeHDF5Async(filename(n)));
+  }
+  for (auto &write : writes)
+    write.get();
+  // The I/O thread has released the projects' HDF5 objects
+  for (const auto &p : projects) {
+    const auto ds = component(p)->dataset();
+    ASSERT_TRUE(bool(ds));
+    EXPECT_FALSE(ds->have_dataset());
+  }
+  {
+    // Waiting for a queue slot while holding the lock could deadlock
+    H5::library_lock lock;
+    EXPECT_THROW(projects.at(0)->writeHDF5Async("asyncoverlap.s5"),
+                 std::logic_error);
+  }
+  projects.clear();
+
+  for (int n = 0; n < nprojects; ++n) {
+    {
+      const auto p = readProjectHDF5(filename(n));
+      const auto copyobj = component(p)->copyobj();
+      ASSERT_TRUE(bool(copyobj));
+      EXPECT_EQ(step_data(n), copyobj->readData<double>());
+    }
+    remove(filename(n).c_str());
+  }
+  H5::setLibrarySerialized(old_serialized);
+}
 #endif
 
 #ifdef SIMULATIONIO_HAVE_ASDF_CXX
@@ -1277,6 +2424,72 @@ TEST(DiscretizationBlock, ASDF) {
 }
 #endif
 
+TEST(DiscretizationBlock, spatial_index) {
+  auto p = createProject("p");
+  auto conf = p->createConfiguration("conf");
+  auto m = p->createManifold("m", conf, 2);
+  auto d = m->createDiscretization("d", conf);
+  std::mt19937 gen;
+  std::uniform_int_distribution<long long> coord(0, 99), len(1, 10);
+  for (int i = 0; i < 1000; ++i) {
+    auto db = d->createDiscretizationBlock("db" + std::to_string(i));
+    vector<long long> lo = {coord(gen), coord(gen)};
+    vector<long long> hi = {lo[0] + len(gen), lo[1] + len(gen)};
+    db->setBox(box_t(point_t(lo), point_t(hi)));
+  }
+  d->createDiscretizationBlock("nobox");
+  auto names = [](const vector<shared_ptr<DiscretizationBlock>> &dbs) {
+    vector<string> r;
+    for (const auto &db : dbs)
+      r.push_back(db->name());
+    std::sort(r.begin(), r.end());
+    return r;
+  };
+  for (int n = 0; n < 100; ++n) {
+    vector<long long> lo = {coord(gen) - 10, coord(gen) - 10};
+    vector<long long> hi = {lo[0] + len(gen), lo[1] + len(gen)};
+    box_t b{point_t(lo), point_t(hi)};
+    point_t pt(lo);
+    vector<shared_ptr<DiscretizationBlock>> overlapping, containing;
+    double mindist = HUGE_VAL;
+    for (const auto &kv : d->discretizationblocks()) {
+      const auto &db = kv.second;
+      if (!db->box().valid())
+        continue;
+      if (!(db->box() & b).empty())
+        overlapping.push_back(db);
+      if (db->box().contains(pt))
+        containing.push_back(db);
+      vector<long long> dlo(db->box().lower()), dhi(db->box().upper());
+      double dist = 0;
+      for (int i = 0; i < 2; ++i) {
+        double x = std::max(0LL, std::max(dlo[i] - lo[i], lo[i] - dhi[i] + 1));
+        dist += x * x;
+      }
+      mindist = std::min(mindist, dist);
+    }
+    EXPECT_EQ(names(overlapping), names(d->overlappingBlocks(b)));
+    EXPECT_EQ(names(containing), names(d->containingBlocks(pt)));
+    auto nearest = d->nearestBlock(pt);
+    ASSERT_TRUE(bool(nearest));
+    vector<long long> dlo(nearest->box().lower()), dhi(nearest->box().upper());
+    double dist = 0;
+    for (int i = 0; i < 2; ++i) {
+      double x = std::max(0LL, std::max(dlo[i] - lo[i], lo[i] - dhi[i] + 1));
+      dist += x * x;
+    }
+    EXPECT_EQ(mindist, dist);
+    EXPECT_EQ(containing.empty(), dist != 0);
+  }
+  // Changing a box invalidates the index
+  auto db0 = d->discretizationblocks().at("db0");
+  vector<long long> far = {1000, 1000}, far1 = {1001, 1001};
+  EXPECT_TRUE(d->containingBlocks(point_t(far)).empty());
+  db0->setBox(box_t(point_t(far), point_t(far1)));
+  EXPECT_EQ(vector<string>{"db0"}, names(d->containingBlocks(point_t(far))));
+  EXPECT_EQ(db0, d->nearestBlock(point_t(far1)));
+}
+
 TEST(Basis, create) {
   auto conf1 = project->configurations().at("conf1");
   auto s1 = project->tangentspaces().at("s1");
@@ -1887,6 +3100,9 @@ TEST(DataBlock, HDF5) {
               "457,458,459,460,462,463,464,465,466,467,469,470,471,472,473,474,"
               "476,477,478,479,480,481]",
               bufds.str());
+    // Reading into a different type converts in memory
+    auto fdata = ds->readData<float>();
+    EXPECT_EQ(vector<float>(data.begin(), data.end()), fdata);
   }
   remove(filename);
 }